@@ -0,0 +1,134 @@
+#ifndef ACTION_QUEUE_HPP_HEADER
+#define ACTION_QUEUE_HPP_HEADER
+
+/**
+ * @file action_queue.hpp
+ * Lock-free ingestion of timestamped actions from many threads.
+ *
+ * The queue is a bounded ring where every cell carries a sequence number
+ * (Dmitry Vyukov's bounded queue, used with a single consumer). Producers
+ * claim a cell by compare-and-swapping the tail forward, retrying when
+ * another producer got there first, the consumer never takes a lock, and
+ * nothing is allocated after construction. Each producer's pushes are
+ * drained in the order that producer made them.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "actor_store.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace engine {
+
+/** Every kind of action an actor can be given. */
+enum class action_type : unsigned char {
+    START_GO_FORWARD,
+    STOP_GO_FORWARD,
+    START_GO_BACKWARD,
+    STOP_GO_BACKWARD,
+    START_ROTATE_LEFT,
+    STOP_ROTATE_LEFT,
+    START_ROTATE_RIGHT,
+    STOP_ROTATE_RIGHT,
+    ATTACK,
+    AREA_ATTACK
+};
+
+/** One action in flat form, as it travels through the queue. */
+struct timed_action {
+    double time;
+    actor_handle actor;
+    actor_handle target; // only for ATTACK
+    action_type type;
+    double radius;       // only for AREA_ATTACK
+};
+
+template <typename T>
+class mpsc_queue {
+    struct cell {
+        std::atomic<std::size_t> sequence;
+        T data;
+
+        cell() : sequence(0), data(T{}) {}
+    };
+
+    std::unique_ptr<cell[]> buffer;
+    std::size_t mask;
+
+    // producers and the consumer hammer different ends of the ring
+    alignas(64) std::atomic<std::size_t> tail;
+    alignas(64) std::size_t head;
+
+    public:
+    /** capacity has to be a power of two */
+    explicit mpsc_queue(std::size_t capacity)
+        : buffer(new cell[capacity])
+        , mask(capacity - 1)
+        , tail(0)
+        , head(0)
+    {
+        assert(capacity >= 2 && (capacity & mask) == 0);
+        for (std::size_t i = 0; i < capacity; ++i) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+
+    /** Safe from any thread; returns false if the queue is full. */
+    bool push(const T& value) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = buffer[pos & mask];
+            std::size_t seq = c.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff =
+                static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed)) {
+                    c.data = value;
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Consumer only. Appends up to max published values to out, oldest
+     * first, and returns how many were taken. A producer that has claimed
+     * a cell but not finished writing it holds back everything behind it
+     * until the next drain.
+     */
+    std::size_t drain(std::vector<T>& out, std::size_t max = std::size_t(-1)) {
+        std::size_t taken = 0;
+        while (taken < max) {
+            cell& c = buffer[head & mask];
+            if (c.sequence.load(std::memory_order_acquire) != head + 1) {
+                break;
+            }
+            out.push_back(c.data);
+            c.sequence.store(head + mask + 1, std::memory_order_release);
+            ++head;
+            ++taken;
+        }
+        return taken;
+    }
+};
+
+} /*end namespace*/
+
+#endif
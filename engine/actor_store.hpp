@@ -0,0 +1,312 @@
+#ifndef ACTOR_STORE_HPP_HEADER
+#define ACTOR_STORE_HPP_HEADER
+
+/**
+ * @file actor_store.hpp
+ * Dense struct-of-arrays storage for engine actors.
+ *
+ * Every actor property lives in its own contiguous column, indexed by the
+ * actor's dense index, so the simulation can sweep the columns linearly.
+ * Dense indices change when actors are removed (the last actor is swapped
+ * into the hole), which is why everything outside the store refers to
+ * actors through generational handles instead.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace engine {
+
+/**
+ * Stable reference to an actor.
+ *
+ * The index names a slot in the store and the generation is bumped every
+ * time the slot is freed, so a handle to a removed actor never aliases the
+ * actor that reuses its slot. Generation 0 is never handed out, which makes
+ * a default-constructed handle invalid.
+ */
+struct actor_handle {
+    std::uint32_t index;
+    std::uint32_t generation;
+
+    actor_handle() : index(0), generation(0) {}
+    actor_handle(std::uint32_t index, std::uint32_t generation)
+        : index(index)
+        , generation(generation)
+    {}
+
+    bool valid() const { return generation != 0; }
+
+    bool operator==(const actor_handle& o) const {
+        return index == o.index && generation == o.generation;
+    }
+    bool operator!=(const actor_handle& o) const { return !(*this == o); }
+    bool operator<(const actor_handle& o) const {
+        return index < o.index ||
+            (index == o.index && generation < o.generation);
+    }
+};
+
+struct actor_properties {
+    double speed; // in units per second
+    double angular_velocity; // in radians per second
+
+    double attack_damage;
+    double attack_delay;
+
+    double health;
+};
+
+/** The attack an actor has wound up; it lands attack_delay after it starts. */
+struct ActiveAttack {
+    double time_started;
+    double attack_delay;
+    double damage;
+    actor_handle target;
+    std::uint64_t id; // matches the scheduled event that lands it
+};
+
+class actor_store {
+    struct slot {
+        std::uint32_t dense;
+        std::uint32_t generation;
+    };
+
+    std::vector<slot> slots;
+    std::vector<std::uint32_t> free_slots;
+    std::unordered_map<std::string, actor_handle> by_name;
+
+    public:
+    static const std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /* dense columns, all of them size() long */
+    std::vector<actor_handle> handle;
+    std::vector<std::string> name;
+    std::vector<double> position_x;
+    std::vector<double> position_y;
+    std::vector<double> direction;
+    std::vector<double> heading_x; // cos(direction), kept up to date by turn()
+    std::vector<double> heading_y; // sin(direction)
+    std::vector<double> speed; // in units per second
+    std::vector<double> angular_velocity; // in radians per second
+    std::vector<double> attack_damage;
+    std::vector<double> attack_delay;
+    std::vector<double> health;
+    std::vector<actor_properties> limits;
+    std::vector<ActiveAttack> attack;
+
+    actor_store()
+        : slots()
+        , free_slots()
+        , by_name()
+        , handle()
+        , name()
+        , position_x()
+        , position_y()
+        , direction()
+        , heading_x()
+        , heading_y()
+        , speed()
+        , angular_velocity()
+        , attack_damage()
+        , attack_delay()
+        , health()
+        , limits()
+        , attack()
+    {}
+
+    std::size_t size() const { return handle.size(); }
+    bool empty() const { return handle.empty(); }
+
+    /** Returns the dense index of the actor or npos if the handle is stale. */
+    std::size_t index_of(actor_handle h) const {
+        if (h.index >= slots.size() || slots[h.index].generation != h.generation
+                || !h.valid()) {
+            return npos;
+        }
+        return slots[h.index].dense;
+    }
+
+    bool contains(actor_handle h) const { return index_of(h) != npos; }
+
+    /** Sets the direction of the actor at dense index i and its heading. */
+    void turn(std::size_t i, double d) {
+        direction[i] = d;
+        heading_x[i] = std::cos(d);
+        heading_y[i] = std::sin(d);
+    }
+
+    /** Looks an actor up by name; returns an invalid handle if unknown. */
+    actor_handle find(const std::string& actor_name) const {
+        auto it = by_name.find(actor_name);
+        return it == by_name.end() ? actor_handle() : it->second;
+    }
+
+    /**
+     * Appends a new actor and returns its handle. Only the name and the
+     * handle columns are filled in, the caller sets the rest through
+     * the returned dense index (which is always size()-1).
+     */
+    actor_handle insert(const std::string& actor_name) {
+        assert(by_name.find(actor_name) == by_name.end());
+
+        std::uint32_t dense = static_cast<std::uint32_t>(size());
+        std::uint32_t index;
+        if (free_slots.empty()) {
+            index = static_cast<std::uint32_t>(slots.size());
+            slots.push_back(slot{dense, 1});
+        } else {
+            index = free_slots.back();
+            free_slots.pop_back();
+            slots[index].dense = dense;
+        }
+        actor_handle h(index, slots[index].generation);
+
+        handle.push_back(h);
+        name.push_back(actor_name);
+        position_x.push_back(0);
+        position_y.push_back(0);
+        direction.push_back(0);
+        heading_x.push_back(1);
+        heading_y.push_back(0);
+        speed.push_back(0);
+        angular_velocity.push_back(0);
+        attack_damage.push_back(0);
+        attack_delay.push_back(0);
+        health.push_back(0);
+        limits.push_back(actor_properties());
+        attack.push_back(ActiveAttack{0, 0, 0, actor_handle(), 0});
+        if (!actor_name.empty()) {
+            by_name[actor_name] = h;
+        }
+        return h;
+    }
+
+    /** Removes the actor; the last actor takes over its dense index. */
+    void erase(actor_handle h) {
+        std::size_t i = index_of(h);
+        assert(i != npos);
+        std::size_t last = size() - 1;
+
+        if (!name[i].empty()) {
+            by_name.erase(name[i]);
+        }
+        if (i != last) {
+            move_dense(last, i);
+            slots[handle[i].index].dense = static_cast<std::uint32_t>(i);
+        }
+        pop_dense();
+
+        if (++slots[h.index].generation == 0) {
+            // never hand out generation 0, it marks invalid handles
+            slots[h.index].generation = 1;
+        }
+        free_slots.push_back(h.index);
+    }
+
+    void clear() {
+        for (auto h : std::vector<actor_handle>(handle)) {
+            erase(h);
+        }
+    }
+
+    /** Current generation of every slot and the order slots get reused in. */
+    void export_slots(std::vector<std::uint32_t>& generations,
+                      std::vector<std::uint32_t>& free_order) const {
+        generations.resize(slots.size());
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+            generations[i] = slots[i].generation;
+        }
+        free_order = free_slots;
+    }
+
+    /**
+     * Throws everything away and recreates the store with the given slot
+     * table and the given live actors, in that dense order. Only the
+     * handle and name columns are filled in. Together with export_slots
+     * this makes a copy hand out the same handles as the original.
+     */
+    void reset(const std::vector<std::uint32_t>& generations,
+               const std::vector<std::uint32_t>& free_order,
+               const std::vector<actor_handle>& live,
+               const std::vector<std::string>& names) {
+        assert(live.size() == names.size());
+        while (!empty()) { pop_dense(); }
+        by_name.clear();
+
+        slots.resize(generations.size());
+        for (std::size_t i = 0; i < generations.size(); ++i) {
+            slots[i] = slot{0, generations[i]};
+        }
+        free_slots = free_order;
+        for (std::size_t i = 0; i < live.size(); ++i) {
+            assert(live[i].index < slots.size());
+            assert(slots[live[i].index].generation == live[i].generation);
+            slots[live[i].index].dense = static_cast<std::uint32_t>(i);
+            handle.push_back(live[i]);
+            name.push_back(names[i]);
+            position_x.push_back(0);
+            position_y.push_back(0);
+            direction.push_back(0);
+            heading_x.push_back(1);
+            heading_y.push_back(0);
+            speed.push_back(0);
+            angular_velocity.push_back(0);
+            attack_damage.push_back(0);
+            attack_delay.push_back(0);
+            health.push_back(0);
+            limits.push_back(actor_properties());
+            attack.push_back(ActiveAttack{0, 0, 0, actor_handle(), 0});
+            if (!names[i].empty()) {
+                by_name[names[i]] = live[i];
+            }
+        }
+    }
+
+    private:
+    void move_dense(std::size_t from, std::size_t to) {
+        handle[to]           = handle[from];
+        name[to].swap(name[from]);
+        position_x[to]       = position_x[from];
+        position_y[to]       = position_y[from];
+        direction[to]        = direction[from];
+        heading_x[to]        = heading_x[from];
+        heading_y[to]        = heading_y[from];
+        speed[to]            = speed[from];
+        angular_velocity[to] = angular_velocity[from];
+        attack_damage[to]    = attack_damage[from];
+        attack_delay[to]     = attack_delay[from];
+        health[to]           = health[from];
+        limits[to]           = limits[from];
+        attack[to]           = attack[from];
+    }
+
+    void pop_dense() {
+        handle.pop_back();
+        name.pop_back();
+        position_x.pop_back();
+        position_y.pop_back();
+        direction.pop_back();
+        heading_x.pop_back();
+        heading_y.pop_back();
+        speed.pop_back();
+        angular_velocity.pop_back();
+        attack_damage.pop_back();
+        attack_delay.pop_back();
+        health.pop_back();
+        limits.pop_back();
+        attack.pop_back();
+    }
+};
+
+} /*end namespace*/
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef BINARY_IO_HPP_HEADER
+#define BINARY_IO_HPP_HEADER
+
+/**
+ * @file binary_io.hpp
+ * Byte level readers and writers for the engine's binary formats.
+ *
+ * Integers are written as LEB128 varints (zigzagged if signed), doubles
+ * as their raw IEEE bits in little-endian order, so the formats are the
+ * same on every platform we build for. The bit writer and reader pack
+ * fields tighter than bytes, least significant bit first.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+inline std::uint64_t zigzag(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t v) {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+class byte_writer {
+    std::vector<unsigned char>& out;
+
+    public:
+    explicit byte_writer(std::vector<unsigned char>& out)
+        : out(out)
+    {}
+
+    void u8(unsigned char v) {
+        out.push_back(v);
+    }
+
+    void varint(std::uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(v));
+    }
+
+    void svarint(std::int64_t v) {
+        varint(zigzag(v));
+    }
+
+    void fixed64(std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<unsigned char>(v >> (8*i)));
+        }
+    }
+
+    void f64(double v) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        fixed64(bits);
+    }
+
+    void bytes(const void* data, std::size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        out.insert(out.end(), p, p + size);
+    }
+
+    void string(const std::string& s) {
+        varint(s.size());
+        bytes(s.data(), s.size());
+    }
+};
+
+class byte_reader {
+    const unsigned char* p;
+    const unsigned char* end;
+
+    void need(std::size_t n) {
+        if (static_cast<std::size_t>(end - p) < n) {
+            throw err::bad_format() << err::reason("unexpected end of data");
+        }
+    }
+
+    public:
+    byte_reader(const void* data, std::size_t size)
+        : p(static_cast<const unsigned char*>(data))
+        , end(static_cast<const unsigned char*>(data) + size)
+    {}
+
+    byte_reader(const byte_reader&) = default;
+    byte_reader& operator=(const byte_reader&) = default;
+
+    bool done() const { return p == end; }
+    std::size_t remaining() const { return end - p; }
+    /** Where the next read starts. */
+    const unsigned char* position() const { return p; }
+
+    unsigned char u8() {
+        need(1);
+        return *p++;
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            unsigned char b = u8();
+            v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) { return v; }
+        }
+        throw err::bad_format() << err::reason("varint too long");
+    }
+
+    std::int64_t svarint() {
+        return unzigzag(varint());
+    }
+
+    std::uint64_t fixed64() {
+        need(8);
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) {
+            v |= static_cast<std::uint64_t>(*p++) << (8*i);
+        }
+        return v;
+    }
+
+    double f64() {
+        std::uint64_t bits = fixed64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    void bytes(void* data, std::size_t size) {
+        need(size);
+        std::memcpy(data, p, size);
+        p += size;
+    }
+
+    std::string string() {
+        std::size_t size = varint();
+        need(size);
+        std::string s(reinterpret_cast<const char*>(p), size);
+        p += size;
+        return s;
+    }
+};
+
+class bit_writer {
+    std::vector<unsigned char>& out;
+    std::uint64_t acc;
+    unsigned used; // bits waiting in acc, always < 64
+
+    public:
+    explicit bit_writer(std::vector<unsigned char>& out)
+        : out(out)
+        , acc(0)
+        , used(0)
+    {}
+
+    ~bit_writer() {
+        flush();
+    }
+
+    bit_writer(const bit_writer&) = delete;
+    bit_writer& operator=(const bit_writer&) = delete;
+
+    /** Writes the low count bits of v, count <= 64. */
+    void bits(std::uint64_t v, unsigned count) {
+        if (count < 64) {
+            v &= (std::uint64_t(1) << count) - 1;
+        }
+        acc |= v << used;
+        unsigned total = used + count;
+        if (total >= 64) {
+            put(acc, 8);
+            acc = used ? v >> (64 - used) : 0;
+            total -= 64;
+        }
+        used = total;
+    }
+
+    void bit(bool b) {
+        bits(b ? 1 : 0, 1);
+    }
+
+    /**
+     * Unsigned number of any size: 6 bits of length, then the bits. Length
+     * 63 stands for a full 64-bit value.
+     */
+    void varbits(std::uint64_t v) {
+        unsigned n = v ? 64 - __builtin_clzll(v) : 0;
+        if (n >= 63) {
+            bits(63, 6);
+            bits(v, 64);
+        } else {
+            bits(n, 6);
+            bits(v, n);
+        }
+    }
+
+    void svarbits(std::int64_t v) {
+        varbits(zigzag(v));
+    }
+
+    void f64(double v) {
+        std::uint64_t b;
+        std::memcpy(&b, &v, sizeof(b));
+        bits(b, 64);
+    }
+
+    void string(const std::string& s) {
+        varbits(s.size());
+        for (char c : s) {
+            bits(static_cast<unsigned char>(c), 8);
+        }
+    }
+
+    /** Pads to a whole byte; done automatically on destruction. */
+    void flush() {
+        put(acc, (used + 7) / 8);
+        acc = 0;
+        used = 0;
+    }
+
+    private:
+    void put(std::uint64_t v, unsigned bytes) {
+        for (unsigned i = 0; i < bytes; ++i) {
+            out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+        }
+    }
+};
+
+class bit_reader {
+    const unsigned char* data;
+    std::size_t size;
+    std::uint64_t pos; // in bits
+
+    public:
+    bit_reader(const void* data, std::size_t size)
+        : data(static_cast<const unsigned char*>(data))
+        , size(size)
+        , pos(0)
+    {}
+
+    bit_reader(const bit_reader&) = default;
+    bit_reader& operator=(const bit_reader&) = default;
+
+    /** Bits left to read. */
+    std::uint64_t remaining() const { return std::uint64_t(size) * 8 - pos; }
+
+    std::uint64_t bits(unsigned count) {
+        if (count > 32) {
+            std::uint64_t low = bits(32);
+            return low | bits(count - 32) << 32;
+        }
+        if (count > remaining()) {
+            throw err::bad_format() << err::reason("unexpected end of data");
+        }
+        // at most 32 bits starting anywhere in a byte span 5 bytes
+        const std::size_t first = pos >> 3;
+        const unsigned shift = pos & 7;
+        const std::size_t last = (pos + count + 7) >> 3;
+        std::uint64_t w = 0;
+        for (std::size_t b = first; b < last; ++b) {
+            w |= std::uint64_t(data[b]) << (8 * (b - first));
+        }
+        pos += count;
+        return (w >> shift) & ((std::uint64_t(1) << count) - 1);
+    }
+
+    bool bit() {
+        return bits(1) != 0;
+    }
+
+    std::uint64_t varbits() {
+        unsigned n = static_cast<unsigned>(bits(6));
+        return n == 63 ? bits(64) : bits(n);
+    }
+
+    std::int64_t svarbits() {
+        return unzigzag(varbits());
+    }
+
+    double f64() {
+        std::uint64_t b = bits(64);
+        double v;
+        std::memcpy(&v, &b, sizeof(v));
+        return v;
+    }
+
+    std::string string() {
+        std::uint64_t size = varbits();
+        if (size > remaining() / 8) {
+            throw err::bad_format() << err::reason("string too long");
+        }
+        std::string s;
+        s.reserve(size);
+        for (std::uint64_t i = 0; i < size; ++i) {
+            s.push_back(static_cast<char>(bits(8)));
+        }
+        return s;
+    }
+};
+
+} /*end namespace*/
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef COLLISION_HPP_HEADER
+#define COLLISION_HPP_HEADER
+
+/**
+ * @file collision.hpp
+ * Swept movement of points through the maze grid.
+ *
+ * Cell (i, j) covers [i, i+1) x [j, j+1). A move is traced cell by cell
+ * with the Amanatides & Woo grid traversal, so no wall is skipped however
+ * long the step is, and a move that runs into a wall keeps the part of it
+ * that is parallel to the wall.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "../maps/maze.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace engine {
+
+/**
+ * Whether an actor may stand in the cell; everything off the maze is solid.
+ * Anything with an isOpen(long, long) const will do for a maze, a Maze or a
+ * chunked_maze.
+ */
+template <typename Grid>
+inline bool
+is_open(const Grid& maze, long x, long y)
+{
+    return maze.isOpen(x, y);
+}
+
+namespace detail {
+
+enum class blocked_axis { NONE, X, Y };
+
+/**
+ * Where a point stopped by the boundary of cell c ends up: the double next
+ * to the boundary on c's side. A fixed distance would round onto the
+ * boundary once the coordinates are large, as a chunked_maze's can be.
+ */
+inline double
+inside(long c, long step)
+{
+    return step > 0 ? std::nextafter(double(c + 1), double(c))
+                    : std::nextafter(double(c), double(c + 1));
+}
+
+/**
+ * Moves (x, y) along (dx, dy) up to the first solid cell. On a hit the point
+ * is left just inside the last open cell and the axis whose cell boundary
+ * it could not cross is returned.
+ */
+template <typename Grid>
+inline blocked_axis
+trace(const Grid& maze, double& x, double& y, double dx, double dy)
+{
+    static const double inf = std::numeric_limits<double>::infinity();
+
+    long cx = static_cast<long>(std::floor(x));
+    long cy = static_cast<long>(std::floor(y));
+    const long step_x = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
+    const long step_y = dy > 0 ? 1 : (dy < 0 ? -1 : 0);
+
+    // parameter t in [0, 1] along the move at which the next x / y cell
+    // boundary is crossed, and how much t it takes to cross a whole cell
+    double t_x = step_x > 0 ? (cx + 1 - x) / dx
+               : step_x < 0 ? (x - cx) / -dx : inf;
+    double t_y = step_y > 0 ? (cy + 1 - y) / dy
+               : step_y < 0 ? (y - cy) / -dy : inf;
+    const double delta_x = step_x ? 1 / std::abs(dx) : inf;
+    const double delta_y = step_y ? 1 / std::abs(dy) : inf;
+
+    for (;;) {
+        if (t_x > 1 && t_y > 1) { break; }
+        if (t_x < t_y) {
+            if (!is_open(maze, cx + step_x, cy)) {
+                x = inside(cx, step_x);
+                y += dy * t_x;
+                return blocked_axis::X;
+            }
+            cx += step_x;
+            t_x += delta_x;
+        } else if (t_y < t_x) {
+            if (!is_open(maze, cx, cy + step_y)) {
+                x += dx * t_y;
+                y = inside(cy, step_y);
+                return blocked_axis::Y;
+            }
+            cy += step_y;
+            t_y += delta_y;
+        } else {
+            // exactly through a corner: both neighbours have to be open,
+            // otherwise the point would squeeze between two walls
+            if (!is_open(maze, cx + step_x, cy)) {
+                x = inside(cx, step_x);
+                y += dy * t_x;
+                return blocked_axis::X;
+            }
+            if (!is_open(maze, cx, cy + step_y) ||
+                    !is_open(maze, cx + step_x, cy + step_y)) {
+                x += dx * t_y;
+                y = inside(cy, step_y);
+                return blocked_axis::Y;
+            }
+            cx += step_x;
+            cy += step_y;
+            t_x += delta_x;
+            t_y += delta_y;
+        }
+    }
+    x += dx;
+    y += dy;
+    return blocked_axis::NONE;
+}
+
+} // end namespace detail
+
+/**
+ * Moves the point (x, y) by (dx, dy) through the maze. It stops at the first
+ * wall on the way and slides along it with whatever movement is left along
+ * the wall. A point that starts inside a wall can only move out of it.
+ * Returns whether a wall got in the way.
+ */
+template <typename Grid>
+inline bool
+sweep(const Grid& maze, double& x, double& y, double dx, double dy)
+{
+    using detail::blocked_axis;
+
+    double start_x = x, start_y = y;
+    blocked_axis hit = detail::trace(maze, x, y, dx, dy);
+    if (hit == blocked_axis::NONE) { return false; }
+
+    // slide: keep the component of the unspent movement along the wall
+    if (hit == blocked_axis::X && dy != 0) {
+        double rest_y = start_y + dy - y;
+        detail::trace(maze, x, y, 0, rest_y);
+    } else if (hit == blocked_axis::Y && dx != 0) {
+        double rest_x = start_x + dx - x;
+        detail::trace(maze, x, y, rest_x, 0);
+    }
+    return true;
+}
+
+} /*end namespace*/
+
+#endif
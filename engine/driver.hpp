@@ -0,0 +1,145 @@
+#ifndef DRIVER_HPP_HEADER
+#define DRIVER_HPP_HEADER
+
+/**
+ * @file driver.hpp
+ * Runs an engine at a fixed tick rate off a variable wall clock.
+ *
+ * Wall-clock time is fed into an accumulator and spent in whole engine
+ * ticks. The poses after the last two ticks are kept, so a renderer running
+ * at any frame rate can draw actors interpolated between them with
+ * alpha() = leftover time / tick length.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "engine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace engine {
+
+class fixed_step_driver {
+    engine& e;
+    double accumulator;
+    std::size_t max_ticks; // per advance(), so a stall cannot snowball
+    double dropped;        // simulation time given up to stay real time
+
+    std::vector<actor_snapshot> previous;
+    std::vector<actor_snapshot> current;
+    std::unordered_map<std::uint32_t, std::size_t> previous_index;
+
+    public:
+    explicit fixed_step_driver(engine& e, std::size_t max_ticks_per_advance = 5)
+        : e(e)
+        , accumulator(0)
+        , max_ticks(max_ticks_per_advance)
+        , dropped(0)
+        , previous()
+        , current()
+        , previous_index()
+    {
+        e.captureSnapshot(current);
+        previous = current;
+    }
+
+    fixed_step_driver(const fixed_step_driver&) = delete;
+    fixed_step_driver& operator=(const fixed_step_driver&) = delete;
+
+    /**
+     * Adds wall_dt seconds to the accumulator and runs as many ticks as fit,
+     * at most max_ticks_per_advance. Time beyond that is dropped: after a
+     * long stall the simulation slows down instead of trying to catch up.
+     *
+     * @return the number of ticks run
+     */
+    std::size_t advance(double wall_dt) {
+        const double dt = e.getTimeStep();
+        accumulator += wall_dt;
+
+        std::size_t ticks = std::min(max_ticks,
+                static_cast<std::size_t>(accumulator / dt));
+        if (ticks > 0) {
+            for (std::size_t i = 1; i < ticks; ++i) {
+                e.simulate();
+            }
+            // previous has to hold the state one tick before current
+            if (ticks == 1) {
+                previous.swap(current);
+            } else {
+                e.captureSnapshot(previous);
+            }
+            e.simulate();
+            e.captureSnapshot(current);
+            previous_index.clear();
+            accumulator -= ticks * dt;
+        }
+        if (accumulator >= dt) {
+            double excess = accumulator - std::fmod(accumulator, dt);
+            dropped += excess;
+            accumulator -= excess;
+        }
+        return ticks;
+    }
+
+    /** How far the renderer is from getPrevious() to getCurrent(), in [0,1). */
+    double alpha() const {
+        return accumulator / e.getTimeStep();
+    }
+
+    double droppedTime() const { return dropped; }
+
+    const std::vector<actor_snapshot>& getPrevious() const { return previous; }
+    const std::vector<actor_snapshot>& getCurrent() const { return current; }
+
+    /**
+     * Writes the pose of every current actor, blended between the previous
+     * and the current tick. Actors that only exist in the current tick are
+     * drawn where they are.
+     */
+    void interpolate(std::vector<actor_snapshot>& out) {
+        const double a = alpha();
+        out.clear();
+        out.reserve(current.size());
+        for (std::size_t i = 0; i < current.size(); ++i) {
+            const actor_snapshot& cur = current[i];
+            const actor_snapshot* prev = find_previous(i);
+            if (!prev) {
+                out.push_back(cur);
+                continue;
+            }
+            out.push_back(actor_snapshot{cur.handle,
+                prev->x + (cur.x - prev->x) * a,
+                prev->y + (cur.y - prev->y) * a,
+                prev->direction + (cur.direction - prev->direction) * a});
+        }
+    }
+
+    private:
+    const actor_snapshot* find_previous(std::size_t i) {
+        const actor_handle h = current[i].handle;
+        // dense order only changes when actors come and go
+        if (i < previous.size() && previous[i].handle == h) {
+            return &previous[i];
+        }
+        if (previous_index.empty()) {
+            for (std::size_t j = 0; j < previous.size(); ++j) {
+                previous_index[previous[j].handle.index] = j;
+            }
+        }
+        auto it = previous_index.find(h.index);
+        if (it == previous_index.end() || previous[it->second].handle != h) {
+            return nullptr;
+        }
+        return &previous[it->second];
+    }
+};
+
+} /*end namespace*/
+
+#endif
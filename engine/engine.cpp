@@ -7,18 +7,1350 @@
  */
 
 #include "engine.hpp"
+#include "driver.hpp"
+#include "interest.hpp"
+#include "match_host.hpp"
+#include "monster_ai.hpp"
+#include "replay.hpp"
+#include "snapshot.hpp"
+#include "../maps/chunked_maze.hpp"
+#include "../maps/pathfinding.hpp"
+#include "../maps/visibility.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 static const double TAU = 2*M_PI;
 
+/* count every heap allocation, for test_no_allocations_per_tick */
+static std::atomic<size_t> allocations(0);
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+/** Fills the engine with a crowd that moves, turns and fights. */
+static std::vector<engine::actor_handle>
+populate(engine::engine& e, const maps::Maze& maze, size_t per_cell)
+{
+    std::vector<engine::actor_handle> crowd;
+    for (size_t x = 1; x < maze.getWidth(); ++x) {
+        for (size_t y = 1; y < maze.getHeight(); ++y) {
+            if (!maze.isPath(x, y)) { continue; }
+            for (size_t k = 0; k < per_cell; ++k) {
+                auto h = e.addActor(engine::actor(
+                            "", osg::Vec2d(x + 0.5, y + 0.5),
+                            k * TAU / per_cell, 100,
+                            engine::actor_properties{
+                                0.5 + 0.1*k, TAU/8, 1, 0.5, 100}));
+                if (k % 2) {
+                    e.applyActionToActor(h,
+                            engine::StartRotateLeftAction{e.getCurrentTime()});
+                }
+                crowd.push_back(h);
+            }
+        }
+    }
+    for (size_t i = 0; i < crowd.size(); ++i) {
+        e.applyActionToActor(crowd[i], engine::Attack{
+                e.getCurrentTime(), crowd[(i * 7) % crowd.size()]});
+    }
+    return crowd;
+}
+
+static bool
+same_bits(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/** An attack lands exactly once, attack_delay after it was started. */
+static void
+test_attack_lands_once()
+{
+    engine::engine e;
+    engine::actor_properties props{0, 0, 15, 0.5, 60};
+    auto a = e.addActor(engine::actor("a", osg::Vec2d(5.5,1.5), 0, 60, props));
+    auto b = e.addActor(engine::actor("b", osg::Vec2d(6.5,1.5), 0, 60, props));
+    e.applyActionToActor(a, engine::StopGoForwardAction{e.getCurrentTime()});
+    e.applyActionToActor(b, engine::StopGoForwardAction{e.getCurrentTime()});
+    e.applyActionToActor(a, engine::Attack{e.getCurrentTime(), b});
+
+    for (size_t i = 0; i < 49; ++i) { e.simulate(); }
+    assert(e.getActor(b).health == 60);
+    for (size_t i = 0; i < 200; ++i) { e.simulate(); }
+    assert(e.getActor(b).health == 45);
+    assert(!e.getActor(a).attack.target.valid());
+}
+
+/** A fast actor stops at a one cell thick wall instead of tunneling. */
+static void
+test_no_tunneling()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1);
+    // find path, path, wall, path along a row
+    size_t wx = 0, wy = 0;
+    for (size_t y = 1; y + 1 < maze->getHeight() && !wx; ++y) {
+        for (size_t x = 3; x + 1 < maze->getWidth(); ++x) {
+            if (maze->isPath(x-2, y) && maze->isPath(x-1, y) &&
+                    maze->isWall(x, y) && maze->isPath(x+1, y)) {
+                wx = x;
+                wy = y;
+                break;
+            }
+        }
+    }
+    assert(wx);
+
+    engine::engine e(maze);
+    e.setTimeStep(0.1);
+    auto runner = e.addActor(engine::actor("runner",
+                osg::Vec2d(wx - 1.5, wy + 0.5), 0, 60,
+                engine::actor_properties{30, 0, 0, 0, 60}));
+    e.applyActionToActor(runner, engine::StartGoForwardAction{0});
+    e.simulate(); // 3 cells in one tick, the wall is 1.5 away
+    auto pos = e.getActor(runner).position;
+    assert(pos.x() < wx && pos.x() > wx - 1e-6);
+    assert(pos.y() == wy + 0.5);
+}
+
+/** Running into a wall at an angle slides along it. */
+static void
+test_wall_sliding()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1);
+    // an open cell with a wall to the right and open space above
+    size_t cx = 0, cy = 0;
+    for (size_t y = 1; y + 1 < maze->getHeight() && !cx; ++y) {
+        for (size_t x = 1; x + 1 < maze->getWidth(); ++x) {
+            if (maze->isPath(x, y) && maze->isWall(x+1, y) &&
+                    maze->isPath(x, y+1)) {
+                cx = x;
+                cy = y;
+                break;
+            }
+        }
+    }
+    assert(cx);
+
+    engine::engine e(maze);
+    e.setTimeStep(0.1);
+    auto slider = e.addActor(engine::actor("slider",
+                osg::Vec2d(cx + 0.5, cy + 0.5), TAU/8, 60,
+                engine::actor_properties{10, 0, 0, 0, 60}));
+    e.applyActionToActor(slider, engine::StartGoForwardAction{0});
+    e.simulate(); // about 0.7 cells along each axis
+    auto pos = e.getActor(slider).position;
+    assert(pos.x() < cx + 1);
+    assert(pos.y() > cy + 1.2);
+}
+
+/**
+ * Moves sweep the same through a chunked maze: through the doors between
+ * chunks, but not into chunks that are not there, and not into walls
+ * however far out.
+ */
+static void
+test_chunked_sweep()
+{
+    maps::chunked_maze_params params;
+    params.chunk_size = 21;
+    params.seed = 4;
+    maps::chunked_maze world(params);
+    const long s = world.getChunkSize();
+    long door = 0;
+    for (long y = 1; y < s && !door; y += 2) {
+        if (world.isPath(s - 1, y)) { door = y; }
+    }
+    assert(door && world.isPath(s - 2, door) && world.isPath(s + 1, door));
+
+    double x = s - 1.5, y = door + 0.5;
+    assert(!engine::sweep(world, x, y, 3, 0));
+    assert(x == s + 1.5 && y == door + 0.5);
+
+    // a door out of that chunk leads nowhere until the next one is made
+    long next = 0;
+    for (long y = 1; y < s && !next; y += 2) {
+        if (world.isPath(2 * s - 1, y)) { next = y; }
+    }
+    assert(next && !world.hasChunk(2, 0));
+    x = 2 * s - 1.5;
+    y = next + 0.5;
+    assert(engine::sweep(world, x, y, 2, 0));
+    assert(x < 2 * s && x > 2 * s - 1e-6);
+    world.getChunk(2, 0);
+    assert(!engine::sweep(world, x, y, 1, 0));
+    assert(x > 2 * s);
+
+    // far enough out that a double has fewer than 9 decimals to spare, a
+    // point stopped by a wall still stays in its own cell
+    const long far = ((1L << 25) / s + 1) * s;
+    long wall = 0, row = 0;
+    for (long y = 1; y < s && !wall; y += 2) {
+        for (long x = far + 1; x + 1 < far + s && !wall; ++x) {
+            if (world.isPath(x, y) && !world.isPath(x + 1, y)) {
+                wall = x + 1;
+                row = y;
+            }
+        }
+    }
+    assert(wall);
+    long open = wall - 1;
+    while (world.isOpen(open - 1, row)) { --open; }
+    x = wall - 0.5;
+    y = row + 0.5;
+    assert(engine::sweep(world, x, y, 3, 0));
+    assert(x < wall && std::floor(x) == wall - 1);
+    assert(engine::sweep(world, x, y, -double(wall - open + 2), 0));
+    assert(x >= open && std::floor(x) == open);
+}
+
+/** Many producers, one consumer: nothing is lost and nothing reordered. */
+static void
+test_action_queue_ordering()
+{
+    const size_t producers = 4, per_producer = 20000;
+    engine::mpsc_queue<engine::timed_action> q(1024);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.push_back(std::thread([&q, p]{
+            for (size_t i = 0; i < per_producer; ++i) {
+                engine::timed_action a{double(i),
+                    engine::actor_handle(p, 1), engine::actor_handle(),
+                    engine::action_type::ATTACK, 0};
+                while (!q.push(a)) { std::this_thread::yield(); }
+            }
+        }));
+    }
+
+    std::vector<double> last(producers, -1);
+    std::vector<engine::timed_action> batch;
+    size_t seen = 0;
+    while (seen < producers * per_producer) {
+        batch.clear();
+        seen += q.drain(batch, 256);
+        for (auto& a : batch) {
+            assert(a.time == last[a.actor.index] + 1);
+            last[a.actor.index] = a.time;
+        }
+    }
+    for (auto& t : threads) { t.join(); }
+    batch.clear();
+    assert(q.drain(batch) == 0);
+}
+
+/** Actions submitted from another thread are applied on the next tick. */
+static void
+test_submitted_actions()
+{
+    engine::engine e;
+    auto mojca = e.addActor(engine::actor("mojca", osg::Vec2d(5,1), 0, 60,
+                engine::actor_properties{1, TAU/2.0, 15, 0.5, 60}));
+    std::thread input([&]{
+        e.submitAction(mojca, engine::StopGoForwardAction{0});
+    });
+    input.join();
+    // stamped for later, so it has to wait for its tick
+    e.submitAction(mojca, engine::StartGoForwardAction{0.5});
+
+    for (size_t i = 0; i < 100; ++i) { e.simulate(); }
+    auto pos = e.getActor(mojca).position;
+    assert(pos.x() > 5.49 && pos.x() < 5.52);
+}
+
+/** Wall-clock frames turn into whole ticks plus an interpolation alpha. */
+static void
+test_fixed_step_driver()
+{
+    engine::engine e;
+    auto mojca = e.addActor(engine::actor("mojca", osg::Vec2d(5,1), 0, 60,
+                engine::actor_properties{1, TAU/2.0, 15, 0.5, 60}));
+    engine::fixed_step_driver driver(e, 5);
+
+    assert(driver.advance(0.025) == 2);
+    assert(std::abs(driver.alpha() - 0.5) < 1e-9);
+
+    std::vector<engine::actor_snapshot> poses;
+    driver.interpolate(poses);
+    assert(poses.size() == 1 && poses[0].handle == mojca);
+    // halfway between the poses after tick 1 and tick 2
+    assert(std::abs(poses[0].x - 5.015) < 1e-9);
+
+    // a long stall runs at most 5 ticks and drops the rest
+    assert(driver.advance(1.0) == 5);
+    assert(driver.alpha() < 1);
+    assert(driver.droppedTime() > 0.9);
+    assert(std::abs(e.getCurrentTime() - 0.07) < 1e-9);
+}
+
+/** A forged log header, as action_recorder writes it. */
+static void
+forge_log_header(engine::byte_writer& w, std::uint64_t width, double dt)
+{
+    w.bytes(engine::replay_format::magic, sizeof(engine::replay_format::magic));
+    w.varint(engine::replay_format::version);
+    w.varint(width);
+    w.varint(43);
+    w.f64(1);
+    w.varint(7);
+    w.string("random-walk");
+    w.f64(dt);
+    w.varint(0);
+}
+
+/** Whether replaying the log throws E. */
+template <typename E>
+static bool
+replay_throws(const std::vector<unsigned char>& bytes)
+{
+    std::istringstream in(std::string(bytes.begin(), bytes.end()));
+    try {
+        engine::replay(in);
+    } catch (E&) {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * A recorded match replays to the same state, and tampering is caught;
+ * a damaged log fails cleanly rather than taking the engine with it.
+ */
+static void
+test_record_and_replay()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 7);
+    engine::engine e(maze);
+    std::stringstream log;
+    engine::action_recorder recorder(e, log, 10);
+
+    auto crowd = populate(e, *maze, 2);
+    e.removeActor(crowd[3]);
+    for (size_t i = 0; i < 120; ++i) {
+        if (i == 40) {
+            e.submitAction(crowd[0], engine::StartRotateRightAction{0.45});
+            e.submitAction(crowd[1], engine::Attack{0.5, crowd[2]});
+            e.submitAction(crowd[4], engine::AreaAttack{0.42, 2.5});
+        }
+        e.simulate();
+    }
+    recorder.finish();
+
+    std::string bytes = log.str();
+    std::istringstream in(bytes);
+    engine::replay_result r = engine::replay(in);
+    assert(r.ticks == 120);
+    assert(r.hashes_checked == 12);
+    assert(r.final_hash == e.stateHash());
+
+    // the same log on another maze has to be caught diverging
+    std::string tampered = bytes;
+    const size_t seed_offset = 4 + 1 + 1 + 1 + 8; // magic, version, w, h, diff
+    assert(tampered[seed_offset] == 7);
+    tampered[seed_offset] = 8;
+    std::istringstream bad(tampered);
+    bool caught = false;
+    try {
+        engine::replay(bad);
+    } catch (engine::err::diverged&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // the log says which generator made the maze
+    auto winding = std::make_shared<const maps::Maze>(41, 43, 1, 7,
+            maps::generators::find_generator("backtracker"));
+    engine::engine w(winding);
+    std::stringstream winding_log;
+    engine::action_recorder winding_recorder(w, winding_log, 10);
+    populate(w, *winding, 2);
+    for (size_t i = 0; i < 60; ++i) { w.simulate(); }
+    winding_recorder.finish();
+    r = engine::replay(winding_log);
+    assert(r.hashes_checked == 6 && r.final_hash == w.stateHash());
+
+    using namespace engine::replay_format;
+    std::vector<unsigned char> forged;
+    engine::byte_writer f(forged);
+    forge_log_header(f, std::uint64_t(1) << 40, 0.01);
+    assert(replay_throws<engine::err::bad_format>(forged));
+    for (double dt : {0.0, -0.01, std::numeric_limits<double>::quiet_NaN()}) {
+        forged.clear();
+        forge_log_header(f, 41, dt);
+        assert(replay_throws<engine::err::bad_format>(forged));
+    }
+
+    forged.clear();
+    forge_log_header(f, 41, 0.01);
+    f.u8(REMOVE);
+    f.varint(0);
+    write_handle(f, engine::actor_handle(5, 1));
+    assert(replay_throws<engine::err::diverged>(forged));
+
+    forged.clear();
+    forge_log_header(f, 41, 0.01);
+    f.u8(END);
+    f.varint(std::uint64_t(1) << 60);
+    assert(replay_throws<engine::err::bad_format>(forged));
+}
+
+/** The same crowd simulated on 1 and on 4 threads must agree bit for bit. */
+static void
+test_thread_count_determinism()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1);
+    engine::engine serial(maze);
+    engine::engine parallel(maze, std::make_shared<utility::thread_pool>(4));
+
+    auto a = populate(serial, *maze, 5);
+    auto b = populate(parallel, *maze, 5);
+    assert(a.size() == b.size());
+    assert(a.size() > 2048); // spans several chunks
+
+    for (size_t i = 0; i < 100; ++i) {
+        serial.simulate();
+        parallel.simulate();
+    }
+    size_t hurt = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        auto x = serial.getActor(a[i]);
+        auto y = parallel.getActor(b[i]);
+        assert(same_bits(x.position.x(), y.position.x()));
+        assert(same_bits(x.position.y(), y.position.y()));
+        assert(same_bits(x.direction, y.direction));
+        assert(same_bits(x.health, y.health));
+        hurt += x.health < 100;
+    }
+    assert(hurt > 0);
+}
+
+static bool
+same_snapshot(const engine::snapshot& a, const engine::snapshot& b)
+{
+    if (a.tick != b.tick || !same_bits(a.time, b.time) ||
+            a.next_event_id != b.next_event_id ||
+            a.slot_generations != b.slot_generations ||
+            a.free_slots != b.free_slots ||
+            a.actors.size() != b.actors.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.actors.size(); ++i) {
+        const engine::snapshot_actor& x = a.actors[i];
+        const engine::snapshot_actor& y = b.actors[i];
+        if (x.handle != y.handle || x.x != y.x || x.y != y.y ||
+                x.direction != y.direction ||
+                !x.same_motion(y) || !x.same_static(y) ||
+                !x.same_attack(y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Snapshots survive encoding, restored engines carry on identically and
+ * deltas against a recent baseline are small.
+ */
+static void
+test_snapshots()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 3);
+    engine::engine e(maze);
+    auto crowd = populate(e, *maze, 12);
+    assert(crowd.size() > 5000);
+    e.removeActor(crowd[5]);
+    for (size_t i = 0; i < 10; ++i) { e.simulate(); }
+
+    engine::snapshot key;
+    engine::take_snapshot(e, key);
+    std::vector<unsigned char> bytes;
+    engine::encode_snapshot(key, nullptr, bytes);
+    engine::snapshot decoded;
+    engine::decode_snapshot(bytes.data(), bytes.size(), nullptr, decoded);
+    assert(same_snapshot(key, decoded));
+    assert(bytes.size() < crowd.size() * 128);
+
+    // two engines restored from the same snapshot stay in lockstep, and a
+    // restored handle still refers to the same actor
+    engine::engine copy(engine::snapshot_maze(decoded));
+    engine::restore_snapshot(copy, decoded);
+    // actions still on their way in are thrown away with the old state
+    e.submitAction(crowd[100],
+            engine::StartGoForwardAction{e.getCurrentTime()});
+    e.submitAction(crowd[100],
+            engine::StartRotateRightAction{e.getCurrentTime()});
+    engine::restore_snapshot(e, key);
+    assert(copy.getActor(crowd[100]).name == e.getActor(crowd[100]).name);
+    assert(!copy.hasActor(crowd[5]));
+    for (size_t i = 0; i < 60; ++i) {
+        e.simulate();
+        copy.simulate();
+    }
+    assert(copy.stateHash() == e.stateHash());
+    auto revived = copy.addActor(engine::actor("late"));
+    assert(revived == e.addActor(engine::actor("late")));
+
+    // only what changed since the baseline is sent: a walking crowd costs
+    // a fraction of a keyframe, idle actors a bit each
+    engine::snapshot base, next, rebuilt;
+    engine::take_snapshot(e, base);
+    e.simulate();
+    engine::take_snapshot(e, next);
+    std::vector<unsigned char> delta;
+    engine::encode_snapshot(next, &base, delta);
+    assert(delta.size() * 4 < bytes.size());
+    engine::decode_snapshot(delta.data(), delta.size(), &base, rebuilt);
+    assert(same_snapshot(next, rebuilt));
+
+    for (size_t i = 0; i < crowd.size(); ++i) {
+        if (e.hasActor(crowd[i])) {
+            e.applyActionToActor(crowd[i],
+                    engine::StopRotateLeftAction{e.getCurrentTime()});
+            e.applyActionToActor(crowd[i],
+                    engine::StopGoForwardAction{e.getCurrentTime()});
+        }
+    }
+    e.simulate();
+    engine::take_snapshot(e, base);
+    e.removeActor(crowd[7]);
+    e.applyActionToActor(crowd[8],
+            engine::StartGoForwardAction{e.getCurrentTime()});
+    e.addActor(engine::actor("newcomer", osg::Vec2d(1.5, 1.5)));
+    e.simulate();
+    engine::take_snapshot(e, next);
+
+    delta.clear();
+    engine::encode_snapshot(next, &base, delta);
+    assert(delta.size() < crowd.size() / 8 + 256);
+    engine::decode_snapshot(delta.data(), delta.size(), &base, rebuilt);
+    assert(same_snapshot(next, rebuilt));
+
+    bool caught = false;
+    try {
+        engine::decode_snapshot(delta.data(), delta.size(), nullptr, rebuilt);
+    } catch (engine::err::bad_format&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // the maze is built again with the generator that made it
+    auto rows = std::make_shared<const maps::Maze>(41, 43, 1, 3,
+            maps::generators::find_generator("eller"));
+    engine::engine on_rows(rows);
+    engine::take_snapshot(on_rows, key);
+    bytes.clear();
+    engine::encode_snapshot(key, nullptr, bytes);
+    engine::decode_snapshot(bytes.data(), bytes.size(), nullptr, decoded);
+    assert(decoded.maze_generator == "eller");
+    auto again = engine::snapshot_maze(decoded);
+    assert(again->getGenerator() == "eller");
+    for (size_t x = 0; x < rows->getWidth(); ++x) {
+        for (size_t y = 0; y < rows->getHeight(); ++y) {
+            assert(again->isPath(x, y) == rows->isPath(x, y));
+        }
+    }
+    decoded.maze_generator = "prim";
+    caught = false;
+    try {
+        engine::snapshot_maze(decoded);
+    } catch (engine::err::bad_format&) {
+        caught = true;
+    }
+    assert(caught);
+}
+
+static bool
+rejects_snapshot(const std::vector<unsigned char>& bytes)
+{
+    engine::snapshot s;
+    try {
+        engine::decode_snapshot(bytes.data(), bytes.size(), nullptr, s);
+    } catch (engine::err::bad_format&) {
+        return true;
+    }
+    return false;
+}
+
+/** A forged keyframe header up to the slot table, as encode_snapshot writes it. */
+static void
+forge_snapshot_header(engine::bit_writer& w)
+{
+    for (char c : engine::detail::snapshot_magic) {
+        w.bits(static_cast<unsigned char>(c), 8);
+    }
+    w.varbits(engine::detail::snapshot_version);
+    w.bit(false);   // keyframe
+    w.bits(16, 6);
+    w.bits(16, 6);
+    w.varbits(0);   // tick
+    w.f64(0);
+    w.f64(0.01);
+    w.varbits(0);   // next event id
+    w.varbits(41);
+    w.varbits(43);
+    w.f64(1);
+    w.varbits(3);
+    w.string("random-walk");
+}
+
+/**
+ * Damaged snapshots are turned away with bad_format, never half decoded,
+ * and a count nobody could have sent is not allocated.
+ */
+static void
+test_damaged_snapshots()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 3);
+    engine::engine e(maze);
+    populate(e, *maze, 1);
+    e.simulate();
+    engine::snapshot key;
+    engine::take_snapshot(e, key);
+    std::vector<unsigned char> bytes;
+    engine::encode_snapshot(key, nullptr, bytes);
+    assert(!rejects_snapshot(bytes));
+    for (size_t n = 0; n < bytes.size(); ++n) {
+        assert(rejects_snapshot(std::vector<unsigned char>(
+                        bytes.begin(), bytes.begin() + n)));
+    }
+
+    std::vector<unsigned char> forged;
+    {
+        engine::bit_writer w(forged);
+        forge_snapshot_header(w);
+        w.bit(false);            // same slots
+        w.varbits(1ull << 40);   // actors
+    }
+    assert(rejects_snapshot(forged));
+
+    forged.clear();
+    {
+        engine::bit_writer w(forged);
+        forge_snapshot_header(w);
+        w.bit(true);
+        w.varbits(0);            // changed slots
+        w.varbits(1ull << 40);   // slot table
+    }
+    assert(rejects_snapshot(forged));
+}
+
+/** Every integration kernel gives the same bits, alone and in the engine. */
+static void
+test_integration_kernels()
+{
+    const size_t n = 1027; // not a multiple of any vector width
+    std::vector<double> hx(n), hy(n), speed(n), turn(n), start(n);
+    for (size_t i = 0; i < n; ++i) {
+        hx[i] = std::cos(i * 0.37);
+        hy[i] = std::sin(i * 0.37);
+        speed[i] = (i % 5) * 0.3 - 0.6;
+        turn[i] = (i % 3) * TAU / 7;
+        start[i] = i * 0.011;
+    }
+    auto all = engine::kernels::available_integrate_kernels();
+    std::vector<double> ref_x(n), ref_y(n), ref_dir(start);
+    engine::kernels::integrate_scalar(hx.data(), hy.data(), speed.data(),
+            turn.data(), ref_dir.data(), ref_x.data(), ref_y.data(), n, 0.01);
+    for (const auto& k : all) {
+        std::vector<double> x(n), y(n), dir(start);
+        k.run(hx.data(), hy.data(), speed.data(), turn.data(), dir.data(),
+                x.data(), y.data(), n, 0.01);
+        for (size_t i = 0; i < n; ++i) {
+            assert(same_bits(x[i], ref_x[i]));
+            assert(same_bits(y[i], ref_y[i]));
+            assert(same_bits(dir[i], ref_dir[i]));
+        }
+    }
+
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1);
+    engine::engine best(maze), plain(maze);
+    plain.setIntegrationKernel(engine::kernels::find_integrate_kernel("scalar"));
+    populate(best, *maze, 3);
+    populate(plain, *maze, 3);
+    for (size_t i = 0; i < 50; ++i) {
+        best.simulate();
+        plain.simulate();
+    }
+    assert(best.stateHash() == plain.stateHash());
+}
+
+/**
+ * Matches on a host share their maze and tick exactly like engines run on
+ * their own; run() keeps them at their tick rate.
+ */
+static void
+test_match_host()
+{
+    engine::match_host host(3);
+    std::vector<std::size_t> ids;
+    for (unsigned i = 0; i < 12; ++i) {
+        ids.push_back(host.addMatch(41, 43, 1, 1 + i % 2));
+        populate(host.getMatch(ids.back()), *host.getMatch(ids.back()).getMaze(), 1);
+    }
+    assert(host.getMazeCache().size() == 2);
+    assert(host.getMatch(ids[0]).getMaze() == host.getMatch(ids[2]).getMaze());
+    assert(host.getMatch(ids[0]).getMaze() != host.getMatch(ids[1]).getMaze());
+    auto wilson = host.getMazeCache().get(41, 43, 1, 1, "wilson");
+    assert(wilson != host.getMatch(ids[0]).getMaze());
+    assert(wilson->getGenerator() == "wilson");
+
+    host.runTicks(40);
+    for (unsigned i = 0; i < 2; ++i) {
+        engine::engine alone(std::make_shared<const maps::Maze>(41, 43, 1, 1 + i));
+        populate(alone, *alone.getMaze(), 1);
+        for (size_t t = 0; t < 40; ++t) { alone.simulate(); }
+        for (size_t k = i; k < ids.size(); k += 2) {
+            assert(host.getMatch(ids[k]).getTick() == 40);
+            assert(host.getMatch(ids[k]).stateHash() == alone.stateHash());
+        }
+    }
+
+    host.removeMatch(ids[1]);
+    assert(host.getMatchCount() == 11);
+    assert(host.addMatch(41, 43, 1, 5, 1./50) == ids[1]);
+
+    // how many ticks fit in depends on the machine; that every match got
+    // some and none ran ahead of the clock does not
+    std::vector<std::uint64_t> ticks_before;
+    for (auto id : ids) { ticks_before.push_back(host.getMatch(id).getTick()); }
+    host.run(0.2);
+    engine::latency_report r = host.latencyReport();
+    for (size_t k = 0; k < ids.size(); ++k) {
+        assert(host.getMatch(ids[k]).getTick() > ticks_before[k]);
+    }
+    // 11 matches at 100 ticks/s and one at 50, at most
+    assert(r.ticks >= ids.size() && r.ticks <= 11 * 21 + 11);
+    assert(r.p50 <= r.p99 && r.p99 <= r.max);
+    assert(host.latencyReport().ticks == 0);
+}
+
+/**
+ * Incrementally kept interest sets match the ones worked out from scratch,
+ * and a client's filtered snapshots are a fraction of the full ones.
+ */
+static void
+test_interest_management()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 9);
+    for (long ax = 0; ax < 41; ax += 3) {
+        for (long ay = 0; ay < 43; ay += 2) {
+            for (long bx = 0; bx < 41; bx += 5) {
+                for (long by = 1; by < 43; by += 4) {
+                    assert(maps::line_of_sight(*maze, ax, ay, bx, by) ==
+                           maps::line_of_sight(*maze, bx, by, ax, ay));
+                }
+            }
+        }
+    }
+
+    engine::engine e(maze);
+    auto crowd = populate(e, *maze, 2);
+    engine::interest_manager interest(maze, engine::interest_params(8, 1.5));
+    for (size_t i = 0; i < crowd.size(); i += 50) {
+        interest.addObserver(crowd[i]);
+    }
+
+    std::vector<engine::actor_snapshot> poses;
+    for (size_t tick = 0; tick < 120; ++tick) {
+        if (tick == 30) {
+            e.removeActor(crowd[100]); // an observer
+            e.removeActor(crowd[101]);
+            e.addActor(engine::actor("visitor", osg::Vec2d(1.5, 1.5)));
+        }
+        if (tick == 60) {
+            interest.removeObserver(crowd[50]);
+        }
+        e.simulate();
+        e.captureSnapshot(poses);
+        interest.update(poses);
+        if (tick % 20 != 19) { continue; }
+
+        for (size_t i = 0; i < crowd.size(); i += 50) {
+            if (!interest.isObserver(crowd[i])) { continue; }
+            std::vector<engine::actor_handle> expected;
+            if (e.hasActor(crowd[i])) {
+                osg::Vec2d me = e.getActor(crowd[i]).position;
+                for (const auto& p : poses) {
+                    if (interest.sees(static_cast<size_t>(me.x()),
+                                static_cast<size_t>(me.y()),
+                                static_cast<size_t>(p.x),
+                                static_cast<size_t>(p.y))) {
+                        expected.push_back(p.handle);
+                    }
+                }
+            }
+            std::sort(expected.begin(), expected.end());
+            assert(interest.interestOf(crowd[i]) == expected);
+        }
+    }
+    assert(!interest.isObserver(crowd[50]));
+    assert(interest.interestOf(crowd[100]).empty());
+
+    // what one client is sent, against what everybody would be
+    engine::snapshot full_before, full_after, mine_before, mine_after;
+    engine::take_snapshot(e, full_before);
+    filter_snapshot(full_before, interest.interestOf(crowd[0]), mine_before);
+    e.simulate();
+    e.captureSnapshot(poses);
+    interest.update(poses);
+    engine::take_snapshot(e, full_after);
+    filter_snapshot(full_after, interest.interestOf(crowd[0]), mine_after);
+    assert(!mine_after.actors.empty());
+
+    std::vector<unsigned char> full, mine;
+    engine::encode_snapshot(full_after, &full_before, full);
+    engine::encode_snapshot(mine_after, &mine_before, mine);
+    assert(mine.size() * 10 < full.size());
+    engine::snapshot decoded;
+    engine::decode_snapshot(mine.data(), mine.size(), &mine_before, decoded);
+    assert(same_snapshot(decoded, mine_after));
+}
+
+/**
+ * Flow fields repaired as their goal wanders stay equal to fresh ones, and
+ * agree with A* on how far everything is.
+ */
+static void
+test_pathfinding()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 5);
+    maps::pathfinder paths(maze, 2);
+    auto finish = paths.towards(maze->getFinish());
+    assert(paths.towards(maze->getFinish()) == finish);
+    assert(finish->distance(maze->getFinish().first,
+                            maze->getFinish().second) == 0);
+
+    // walking the field gets there in as many steps as it says
+    auto start = maze->getStart();
+    std::uint32_t d = finish->distance(start.first, start.second);
+    assert(d != maps::flow_field::unreachable);
+    maps::cell at = start;
+    for (std::uint32_t i = 0; i < d; ++i) {
+        at = finish->next(at.first, at.second);
+    }
+    assert(at == maze->getFinish());
+    auto route = paths.path(start, maze->getFinish());
+    assert(route.size() == d + 1);
+    assert(route.front() == start && route.back() == maze->getFinish());
+    for (size_t i = 1; i < route.size(); ++i) {
+        assert(std::labs(long(route[i].first) - long(route[i-1].first)) +
+               std::labs(long(route[i].second) - long(route[i-1].second)) == 1);
+        assert(maze->isPath(route[i].first, route[i].second));
+    }
+
+    // the least recently used fixed goal makes way
+    for (auto& t : maze->getTreasure()) {
+        paths.towards(t.position);
+    }
+    assert(paths.getFieldCount() <= 2);
+
+    // a target wandering about, repaired step by step
+    std::mt19937 rng(3);
+    maps::cell target = start;
+    auto chase = paths.follow(7, target);
+    size_t repaired = 0, searched = 0;
+    for (int step = 0; step < 300; ++step) {
+        static const long dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        const long* dir = dirs[rng() % 4];
+        const long nx = long(target.first) + dir[0];
+        const long ny = long(target.second) + dir[1];
+        if (!maps::is_open_cell(*maze, nx, ny)) { continue; }
+        target = maps::cell(nx, ny);
+        assert(paths.follow(7, target) == chase);
+        repaired += chase->getTouched();
+
+        maps::flow_field fresh(maze, target);
+        searched += fresh.getTouched();
+        for (size_t x = 0; x < maze->getWidth(); ++x) {
+            for (size_t y = 0; y < maze->getHeight(); ++y) {
+                assert(chase->distance(x, y) == fresh.distance(x, y));
+            }
+        }
+        if (step % 50 == 0) {
+            maps::cell from(maze->getFinish());
+            auto way = paths.path(from, target);
+            assert(way.size() == chase->distance(from.first, from.second) + 1);
+        }
+    }
+    assert(repaired < searched);
+    paths.forget(7);
+
+    // no way through a wall
+    assert(paths.path(start, maps::cell(0, 0)).empty());
+}
+
+/**
+ * Monsters come out of the maze, go after a player they see and make no
+ * more decisions per tick, nor path searches, than they are allowed; far
+ * ones think less.
+ */
+static void
+test_monster_ai()
+{
+    auto maze = std::make_shared<const maps::Maze>(61, 61, 1, 4);
+    engine::engine e(maze);
+    engine::ai_params params;
+    params.budget = 8;
+    params.search_budget = 500;
+    engine::monster_ai ai(e, params, 2);
+    const size_t count = ai.spawnMonsters();
+    assert(count == maze->getMonsters().size() && count > 10);
+    assert(ai.getMonsterCount() == count);
+    size_t guards = 0;
+    for (size_t i = 0; i < count; ++i) {
+        osg::Vec2d at = e.getActor(ai.getMonster(i)).position;
+        assert(maze->isPath(size_t(at.x()), size_t(at.y())));
+        if (ai.getState(i) == engine::monster_state::GUARD) { ++guards; }
+    }
+    assert(guards > 0 && guards < count);
+
+    // with nobody around everyone is far, and thinks every far_interval
+    for (int tick = 0; tick < 64; ++tick) {
+        ai.think();
+        e.simulate();
+    }
+    assert(ai.getStats().busiest <= params.budget);
+    assert(ai.getStats().decisions <= count * (64 / params.far_interval + 1));
+    assert(ai.getStats().decisions >= count * (64 / params.far_interval - 1));
+
+    // a player turns up in a corridor near a wandering monster
+    size_t hunter = 0;
+    while (ai.getState(hunter) == engine::monster_state::GUARD) { ++hunter; }
+    osg::Vec2d m = e.getActor(ai.getMonster(hunter)).position;
+    maps::cell spot(size_t(m.x()), size_t(m.y()));
+    for (int i = 0; i < 3; ++i) {
+        maps::cell further = spot;
+        for (auto n : {maps::cell(spot.first + 1, spot.second),
+                       maps::cell(spot.first - 1, spot.second),
+                       maps::cell(spot.first, spot.second + 1),
+                       maps::cell(spot.first, spot.second - 1)}) {
+            if (maze->isPath(n.first, n.second) &&
+                    (osg::Vec2d(n.first + .5, n.second + .5) - m).length() >
+                    (osg::Vec2d(further.first + .5, further.second + .5) - m).length()) {
+                further = n;
+            }
+        }
+        spot = further;
+    }
+    auto player = e.addActor(engine::actor("player",
+                osg::Vec2d(spot.first + 0.5, spot.second + 0.5), 0, 100,
+                engine::actor_properties{1, TAU/4, 1, 0.25, 100}));
+    e.applyActionToActor(player, engine::StopGoForwardAction{e.getCurrentTime()});
+    ai.addPlayer(player);
+
+    engine::ai_stats before = ai.getStats();
+    const size_t cells = maze->getWidth() * maze->getHeight();
+    for (int tick = 0; tick < 600; ++tick) {
+        const std::uint64_t searched = ai.getStats().searched;
+        ai.think();
+        e.simulate();
+        assert(ai.getStats().busiest <= params.budget);
+        // over by one search at most
+        assert(ai.getStats().searched - searched < params.search_budget + cells);
+    }
+    assert(ai.getStats().searched > before.searched);
+    assert(e.getActor(player).health < 100);
+    assert(ai.getStats().decisions - before.decisions > 600);
+
+    // and all of it again gives the same match
+    engine::engine again(maze);
+    engine::monster_ai ai2(again, params, 2);
+    ai2.spawnMonsters();
+    for (int tick = 0; tick < 64; ++tick) {
+        ai2.think();
+        again.simulate();
+    }
+    auto player2 = again.addActor(engine::actor("player",
+                osg::Vec2d(spot.first + 0.5, spot.second + 0.5), 0, 100,
+                engine::actor_properties{1, TAU/4, 1, 0.25, 100}));
+    again.applyActionToActor(player2,
+            engine::StopGoForwardAction{again.getCurrentTime()});
+    ai2.addPlayer(player2);
+    for (int tick = 0; tick < 600; ++tick) {
+        ai2.think();
+        again.simulate();
+    }
+    assert(again.stateHash() == e.stateHash());
+}
+
+/**
+ * A guard lured off its post by a player goes back once the player is
+ * gone, and then stays put: nothing it planned while chasing is left to
+ * move it afterwards.
+ */
+static void
+test_guard_returns()
+{
+    auto maze = std::make_shared<const maps::Maze>(61, 61, 1, 4);
+    engine::engine e(maze);
+    engine::monster_ai ai(e);
+    ai.spawnMonsters();
+    size_t guard = 0;
+    while (ai.getState(guard) != engine::monster_state::GUARD) { ++guard; }
+    const osg::Vec2d post = e.getActor(ai.getMonster(guard)).position;
+
+    // a player the guard can see, a few steps from the post
+    const maps::cell at(size_t(post.x()), size_t(post.y()));
+    std::vector<maps::cell> seen(1, at), ring(1, at);
+    maps::cell spot = at;
+    for (int step = 0; step < 6 && spot == at; ++step) {
+        std::vector<maps::cell> next;
+        for (auto c : ring) {
+            for (auto n : {maps::cell(c.first + 1, c.second),
+                           maps::cell(c.first - 1, c.second),
+                           maps::cell(c.first, c.second + 1),
+                           maps::cell(c.first, c.second - 1)}) {
+                if (!maze->isPath(n.first, n.second) ||
+                        std::find(seen.begin(), seen.end(), n) != seen.end()) {
+                    continue;
+                }
+                seen.push_back(n);
+                next.push_back(n);
+                if (step >= 2 && maze->isVisible(at.first, at.second,
+                            n.first, n.second)) {
+                    spot = n;
+                }
+            }
+        }
+        ring.swap(next);
+    }
+    assert(spot != at);
+    // lured a cell away, and then lost as soon as it starts to move
+    for (int round = 0; round < 2; ++round) {
+        auto player = e.addActor(engine::actor("player",
+                    osg::Vec2d(spot.first + 0.5, spot.second + 0.5), 0, 1000,
+                    engine::actor_properties{1, TAU/4, 1, 0.25, 1000}));
+        e.applyActionToActor(player,
+                engine::StopGoForwardAction{e.getCurrentTime()});
+        ai.addPlayer(player);
+        for (size_t tick = 0; tick < 600; ++tick) {
+            ai.think();
+            e.simulate();
+            const engine::actor g = e.getActor(ai.getMonster(guard));
+            if (round == 0 ? (g.position - post).length() >= 1
+                           : g.speed != 0 || g.angular_velocity != 0) {
+                break;
+            }
+        }
+        assert(ai.getState(guard) == engine::monster_state::CHASE);
+        ai.removePlayer(player);
+        e.removeActor(player);
+
+        // once it is back on guard and still, it never moves again
+        bool still = false;
+        osg::Vec2d rest;
+        for (int t = 0; t < 1500; ++t) {
+            ai.think();
+            e.simulate();
+            const engine::actor g = e.getActor(ai.getMonster(guard));
+            if (still) {
+                assert(g.position == rest);
+            } else if (ai.getState(guard) == engine::monster_state::GUARD &&
+                    g.speed == 0 && g.angular_velocity == 0) {
+                still = true;
+                rest = g.position;
+            }
+        }
+        assert(still);
+        assert(size_t(rest.x()) == at.first && size_t(rest.y()) == at.second);
+    }
+}
+
+/** The stats add up to what happened, or stay zero when compiled out. */
+static void
+test_engine_stats()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 3);
+    engine::engine e(maze, std::make_shared<utility::thread_pool>(2));
+    auto crowd = populate(e, *maze, 2); // everyone attacks once
+    std::ostringstream dump;
+    e.setStatsDump(&dump, 25);
+    for (int tick = 0; tick < 100; ++tick) { e.simulate(); }
+
+    const engine::engine_stats& s = e.getStats();
+    if (!engine::engine_stats::enabled) {
+        assert(s.ticks == 0 && s.actions_applied == 0 && dump.str().empty());
+        return;
+    }
+    assert(s.ticks == 100);
+    assert(s.attacks_started == crowd.size());
+    assert(s.target_lookups == crowd.size());
+    assert(s.attacks_landed > 0 && s.attacks_landed <= crowd.size());
+    assert(s.actors_moved == 100 * crowd.size()); // speed stays at 1
+    assert(s.wall_hits > 0 && s.wall_hits < s.actors_moved);
+    std::uint64_t histogram = 0;
+    for (auto b : s.tick_histogram) { histogram += b; }
+    assert(histogram == 100);
+    assert(s.tickPercentile(0.5) > 0);
+    assert(s.tickPercentile(0.5) <= s.tickPercentile(0.99));
+    std::uint64_t phases = 0;
+    for (auto p : s.phase_ns) { phases += p; }
+    assert(phases > 0);
+    size_t lines = 0;
+    for (char c : dump.str()) { lines += c == '\n'; }
+    assert(lines == 4);
+
+    e.resetStats();
+    e.setStatsDump(nullptr, 0);
+    e.applyActionToActor(crowd[0], engine::Attack{e.getCurrentTime(), crowd[1]});
+    e.simulate();
+    assert(e.getStats().ticks == 1);
+    assert(e.getStats().attacks_started == 1);
+    assert(e.getStats().actions_applied == 1);
+}
+
+/**
+ * Once the engine has seen a few ticks like it, a tick full of moving,
+ * turning, fighting actors and submitted actions allocates nothing.
+ */
+static void
+test_no_allocations_per_tick()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 3);
+    engine::engine e(maze, std::make_shared<utility::thread_pool>(2));
+    auto crowd = populate(e, *maze, 3);
+
+    auto tick = [&](size_t t) {
+        // a wave of attacks and orders, some for later ticks
+        for (size_t i = t % 5; i < crowd.size(); i += 5) {
+            double now = e.getCurrentTime();
+            e.submitAction(crowd[i], engine::Attack{now, crowd[(i * 13 + t) % crowd.size()]});
+            e.submitAction(crowd[i], engine::StopGoForwardAction{now + 0.05});
+            e.submitAction(crowd[i], engine::StartGoForwardAction{now + 0.02});
+            e.applyActionToActor(crowd[(i + 1) % crowd.size()],
+                    engine::StartRotateRightAction{now});
+        }
+        e.simulate();
+    };
+    for (size_t t = 0; t < 200; ++t) { tick(t); }
+
+    size_t before = allocations.load();
+    for (size_t t = 200; t < 400; ++t) { tick(t); }
+    assert(allocations.load() == before);
+}
+
+/**
+ * Blows landing in the same tick are added up before they hurt, area
+ * attacks hit everyone in range, and every death is reported once.
+ */
+static void
+test_batched_damage()
+{
+    engine::engine e;
+    engine::actor_properties props{0, 0, 10, 0.5, 100};
+    auto still = [&](engine::actor_handle h) {
+        e.applyActionToActor(h, engine::StopGoForwardAction{e.getCurrentTime()});
+        return h;
+    };
+    auto victim = still(e.addActor(engine::actor("victim", osg::Vec2d(5.5, 1.5), 0, 25, props)));
+    std::vector<engine::actor_handle> gang;
+    for (int i = 0; i < 4; ++i) {
+        gang.push_back(still(e.addActor(engine::actor("",
+                            osg::Vec2d(6.5 + 0.1*i, 1.5), 0, 100, props))));
+    }
+    auto far = still(e.addActor(engine::actor("far", osg::Vec2d(30.5, 1.5), 0, 100, props)));
+
+    // four swings land on the same tick: 40 damage off 25 health, one death
+    for (auto g : gang) {
+        e.applyActionToActor(g, engine::Attack{e.getCurrentTime(), victim});
+    }
+    for (int i = 0; i < 49; ++i) { e.simulate(); }
+    assert(e.getActor(victim).health == 25);
+    e.simulate();
+    assert(e.getActor(victim).health == -15);
+    assert(e.getDeaths().size() == 1 && e.getDeaths()[0] == victim);
+    e.simulate();
+    assert(e.getDeaths().empty());
+
+    // an area attack hits the gang but neither the attacker nor the far one,
+    // and does not cancel the attacker's swing
+    e.applyActionToActor(gang[0], engine::Attack{e.getCurrentTime(), gang[1]});
+    e.applyActionToActor(gang[0], engine::AreaAttack{e.getCurrentTime(), 1});
+    assert(e.getActor(gang[0]).health == 100);
+    assert(e.getActor(gang[1]).health == 90);
+    assert(e.getActor(gang[3]).health == 90);
+    assert(e.getActor(far).health == 100);
+    assert(e.getActor(victim).health == -15); // dead already
+    for (int i = 0; i < 50; ++i) { e.simulate(); }
+    assert(e.getActor(gang[1]).health == 80);
+
+    // a hundred thousand blows a tick come out the same on any thread count
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 2);
+    engine::engine serial(maze);
+    engine::engine parallel(maze, std::make_shared<utility::thread_pool>(3));
+    auto a = populate(serial, *maze, 60);
+    auto b = populate(parallel, *maze, 60);
+    assert(a.size() > 50000);
+    for (size_t i = 0; i < a.size(); ++i) {
+        serial.applyActionToActor(a[i], engine::Attack{0, a[(i * 31) % 97]});
+        parallel.applyActionToActor(b[i], engine::Attack{0, b[(i * 31) % 97]});
+    }
+    size_t died = 0, dying_ticks = 0;
+    for (int i = 0; i < 60; ++i) {
+        serial.simulate();
+        parallel.simulate();
+        assert(serial.getDeaths() == parallel.getDeaths());
+        died += serial.getDeaths().size();
+        dying_ticks += !serial.getDeaths().empty();
+    }
+    assert(died == 97 && dying_ticks == 1);
+    assert(serial.stateHash() == parallel.stateHash());
+}
+
+/**
+ * Radius, box and nearest-neighbour queries answer what a scan over every
+ * actor would, while the crowd walks about, loses members and gets
+ * restored from a snapshot.
+ */
+static void
+test_spatial_grid()
+{
+    auto maze = std::make_shared<const maps::Maze>(41, 43, 1, 6);
+    engine::engine e(maze, std::make_shared<utility::thread_pool>(2));
+    auto crowd = populate(e, *maze, 4);
+    assert(crowd.size() > 2048); // spans several chunks
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<double> across(-2, 45);
+
+    auto check = [&](engine::engine& e) {
+        std::vector<engine::actor_handle> all, found, expected;
+        std::vector<engine::actor> state;
+        for (auto h : crowd) {
+            if (e.hasActor(h)) {
+                all.push_back(h);
+                state.push_back(e.getActor(h));
+            }
+        }
+        for (int q = 0; q < 50; ++q) {
+            const osg::Vec2d p(across(rng), across(rng));
+            const double r = 0.1 * (rng() % 40);
+
+            expected.clear();
+            for (size_t i = 0; i < all.size(); ++i) {
+                if ((state[i].position - p).length2() <= r * r) {
+                    expected.push_back(all[i]);
+                }
+            }
+            e.findActorsInRadius(p, r, found);
+            std::sort(found.begin(), found.end());
+            std::sort(expected.begin(), expected.end());
+            assert(found == expected);
+
+            const osg::Vec2d high = p + osg::Vec2d(r, 2 * r);
+            expected.clear();
+            for (size_t i = 0; i < all.size(); ++i) {
+                const osg::Vec2d& a = state[i].position;
+                if (a.x() >= p.x() && a.y() >= p.y() &&
+                        a.x() <= high.x() && a.y() <= high.y()) {
+                    expected.push_back(all[i]);
+                }
+            }
+            e.findActorsInBox(p, high, found);
+            std::sort(found.begin(), found.end());
+            std::sort(expected.begin(), expected.end());
+            assert(found == expected);
+
+            // distances match the k nearest of the scan; ties may differ
+            const size_t k = 1 + rng() % 20;
+            std::vector<double> d;
+            for (size_t i = 0; i < all.size(); ++i) {
+                d.push_back((state[i].position - p).length2());
+            }
+            std::sort(d.begin(), d.end());
+            e.findNearestActors(p, k, found);
+            assert(found.size() == k);
+            for (size_t i = 0; i < k; ++i) {
+                assert((e.getActor(found[i]).position - p).length2() == d[i]);
+            }
+        }
+    };
+
+    for (size_t i = 0; i < crowd.size(); i += 2) {
+        e.applyActionToActor(crowd[i],
+                engine::StartGoForwardAction{e.getCurrentTime()});
+    }
+    check(e);
+    for (int tick = 0; tick < 120; ++tick) {
+        e.simulate();
+        if (tick % 10 == 0) {
+            e.removeActor(crowd[(tick * 37) % crowd.size()]);
+        }
+    }
+    check(e);
+    if (engine::engine_stats::enabled) {
+        assert(e.getStats().cell_changes > crowd.size() / 4);
+    }
+
+    // an actor put somewhere else is found there, in a cell of its own
+    std::vector<engine::actor_handle> found;
+    e.placeActor(crowd[1], osg::Vec2d(-3, 50), 0, 0, 0);
+    e.findNearestActors(osg::Vec2d(-3, 50), 1, found);
+    assert(found.size() == 1 && found[0] == crowd[1]);
+    e.findActorsInRadius(osg::Vec2d(-3, 50), 0.5, found);
+    assert(found.size() == 1 && found[0] == crowd[1]);
+    check(e);
+
+    // once the buffers have grown, queries allocate nothing
+    engine::engine::nearest_scratch scratch;
+    e.findNearestActors(osg::Vec2d(20, 20), 16, found, scratch);
+    const size_t before = allocations.load();
+    for (int q = 0; q < 100; ++q) {
+        e.findNearestActors(osg::Vec2d(5 + q % 30, 7 + q % 29), 16, found,
+                scratch);
+    }
+    assert(allocations.load() == before);
+
+    engine::snapshot s;
+    engine::take_snapshot(e, s);
+    engine::engine copy(maze);
+    engine::restore_snapshot(copy, s);
+    check(copy);
+}
+
 int main( int argc, char *argv[] )
 {
     engine::engine e;
-    e.addActor(
+    // the first corridor long enough to walk ten cells along
+    osg::Vec2d from;
+    for (size_t y = 1; from.x() == 0; ++y) {
+        size_t run = 0;
+        for (size_t x = 1; x < e.getMaze()->getWidth(); ++x) {
+            run = e.getMaze()->isPath(x, y) ? run + 1 : 0;
+            if (run == 11) {
+                from = osg::Vec2d(x - 10, y);
+                break;
+            }
+        }
+    }
+    auto mojca = e.addActor(
             engine::actor(
                 "mojca", //name
-                osg::Vec2d(1,1), //position
+                from, //position
                 0, // direction
                 60, // health
                 engine::actor_properties{
@@ -28,26 +1360,54 @@ int main( int argc, char *argv[] )
                     0.5, // attack delay
                     60
                 }));
-    e.applyActionToActor("mojca",
+    e.applyActionToActor(mojca,
             engine::StartGoForwardAction{
                 e.getCurrentTime()
                 }
             );
     // add actors
+    auto ghost = e.addActor(engine::actor("ghost", osg::Vec2d(5,3)));
+    e.removeActor(ghost);
+    assert(!e.hasActor(ghost));
+    assert(e.hasActor(mojca));
     // add some events
     // simulate the shit out of it
     for (size_t i = 0; i < 1000; ++i) {
         e.simulate();
     }
 
-    e.applyActionToActor("mojca",
+    e.applyActionToActor(mojca,
             engine::StopGoForwardAction{
                 e.getCurrentTime()
             }
             );
 
+    assert(e.findActor("mojca") == mojca);
+
     // check if everybody is where he/she is supposed to be
-    assert(abs((e.getActor("mojca").position - osg::Vec2d(11,1)).length()) < 0.1);
+    assert(abs((e.getActor(mojca).position - from - osg::Vec2d(10,0)).length()) < 0.1);
+
+    test_attack_lands_once();
+    test_no_tunneling();
+    test_wall_sliding();
+    test_chunked_sweep();
+    test_action_queue_ordering();
+    test_submitted_actions();
+    test_fixed_step_driver();
+    test_record_and_replay();
+    test_thread_count_determinism();
+    test_snapshots();
+    test_damaged_snapshots();
+    test_integration_kernels();
+    test_match_host();
+    test_interest_management();
+    test_pathfinding();
+    test_monster_ai();
+    test_guard_returns();
+    test_engine_stats();
+    test_no_allocations_per_tick();
+    test_batched_damage();
+    test_spatial_grid();
 
     return EXIT_SUCCESS;
 }               /* --------  end of function main  ---------- */
@@ -9,43 +9,29 @@
  * @since 2012-04-24
  */
 
+#include "action_queue.hpp"
+#include "actor_store.hpp"
+#include "collision.hpp"
+#include "integrate.hpp"
+#include "scheduler.hpp"
+#include "spatial_grid.hpp"
+#include "stats.hpp"
 #include "../maps/maze.hpp"
+#include "../misc/thread_pool.hpp"
 
 #include <osg/Vec2d>
 #include <string>
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
-#include <map>
+#include <new>
+#include <ostream>
+#include <vector>
 
 namespace engine {
 
 static const double TAU = 2*M_PI;
 
-struct actor_properties {
-    double speed; // in units per second
-    double angular_velocity; // in radians per second
-
-    double attack_damage;
-    double attack_delay;
-
-    double health;
-
-    osg::Vec2d
-    getSpeedAsVector(double direction) const {
-        return osg::Vec2d(cos(direction) * speed, sin(direction) * speed);
-    }
-};
-
-struct ActiveAttack {
-    double time_started;
-    double attack_delay;
-    double damage;
-    std::string target;
-
-    bool is_attack_now(double time, double epsilon) {
-        return (abs(time_started + attack_delay - time) < epsilon);
-    }
-};
-
 struct actor {
     std::string name;
     osg::Vec2d position;
@@ -85,7 +71,8 @@ struct actor {
             0,
             0,
             0,
-            "",
+            actor_handle(),
+            0,
         }
     {}
 };
@@ -116,28 +103,266 @@ struct StopRotateRightAction {
 };
 struct Attack{
     double time;
-    std::string targetId;
+    actor_handle target;
+};
+/**
+ * Hits everyone else within radius of the attacker with its attack damage,
+ * straight away; it does not interrupt an Attack being wound up.
+ */
+struct AreaAttack{
+    double time;
+    double radius;
+};
+
+inline timed_action make_action(actor_handle a, StartGoForwardAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::START_GO_FORWARD, 0};
+}
+inline timed_action make_action(actor_handle a, StopGoForwardAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::STOP_GO_FORWARD, 0};
+}
+inline timed_action make_action(actor_handle a, StartGoBackwardAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::START_GO_BACKWARD, 0};
+}
+inline timed_action make_action(actor_handle a, StopGoBackwardAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::STOP_GO_BACKWARD, 0};
+}
+inline timed_action make_action(actor_handle a, StartRotateLeftAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::START_ROTATE_LEFT, 0};
+}
+inline timed_action make_action(actor_handle a, StopRotateLeftAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::STOP_ROTATE_LEFT, 0};
+}
+inline timed_action make_action(actor_handle a, StartRotateRightAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::START_ROTATE_RIGHT, 0};
+}
+inline timed_action make_action(actor_handle a, StopRotateRightAction x) {
+    return timed_action{x.time, a, actor_handle(), action_type::STOP_ROTATE_RIGHT, 0};
+}
+inline timed_action make_action(actor_handle a, Attack x) {
+    return timed_action{x.time, a, x.target, action_type::ATTACK, 0};
+}
+inline timed_action make_action(actor_handle a, AreaAttack x) {
+    return timed_action{x.time, a, actor_handle(), action_type::AREA_ATTACK,
+        x.radius};
+}
+
+
+
+/** Where an actor is at the end of a tick, as the renderer needs it. */
+struct actor_snapshot {
+    actor_handle handle;
+    double x;
+    double y;
+    double direction;
+};
+
+/** Something the engine has to do to an actor at a given time. */
+struct timed_event {
+    enum class kind {
+        ATTACK_LANDS
+    };
+    kind type;
+    actor_handle actor;
+    std::uint64_t id;
 };
 
+/**
+ * Gets told about everything that changes an engine from the outside, in
+ * the order it happens, which is all that is needed to replay a match.
+ *
+ * tick is the number of ticks simulated so far. Queued actions are the ones
+ * applied while draining the action queue inside the next tick; the others
+ * were applied directly between ticks.
+ */
+class engine_listener {
+    public:
+    virtual ~engine_listener() {}
+    virtual void actorAdded(std::uint64_t tick, actor_handle handle,
+                            const actor& act) = 0;
+    virtual void actorRemoved(std::uint64_t tick, actor_handle handle) = 0;
+    virtual void actionApplied(std::uint64_t tick, bool queued,
+                               const timed_action& action) = 0;
+    virtual void tickSimulated(std::uint64_t tick) = 0;
+};
 
+struct snapshot;
+struct snapshot_precision;
 
 class engine {
-    std::map<std::string, actor> actors;
-    std::shared_ptr<maps::Maze> maze;
+    // actors per parallel chunk
+    static const std::size_t chunk_size = 1024;
+
+    actor_store actors;
+    std::shared_ptr<const maps::Maze> maze;
+    spatial_grid grid; // follows actors, see spatial_grid.hpp
+    std::shared_ptr<utility::thread_pool> pool;
+    event_scheduler<timed_event> events;
+    std::uint64_t next_event_id;
+
+    // actions submitted from other threads, and the ones drained from
+    // there that are stamped for a later tick
+    mpsc_queue<timed_action> inbox;
+    std::vector<timed_action> pending;
+    // drain_actions() scratch, kept so that a tick allocates nothing
+    std::vector<std::pair<double, std::size_t>> drain_order;
+    std::vector<timed_action> drained;
+
+    // damage dealt but not yet taken, see resolve_damage()
+    struct damage_event {
+        std::uint32_t target; // dense index
+        double amount;
+    };
+    std::vector<damage_event> damage;
+    std::vector<damage_event> damage_sorted;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> damage_keys;
+    std::vector<std::uint32_t> damage_ends;
+    std::vector<std::vector<actor_handle>> chunk_deaths;
+    std::vector<actor_handle> deaths;
+    // actors that left their grid cell, per parallel chunk
+    std::vector<std::vector<std::uint32_t>> chunk_crossings;
+
+    engine_listener* listener;
+    kernels::integrate_kernel kernel;
+
+    // see stats.hpp; the parallel phase counts per chunk and is summed up
+    // after, so the chunks never share a counter
+    struct chunk_stats {
+        std::uint64_t integrate_ns;
+        std::uint64_t collide_ns;
+        std::uint64_t moved;
+        std::uint64_t wall_hits;
+    };
+    engine_stats stats;
+    std::vector<chunk_stats> chunk_counts;
+    std::ostream* stats_out;
+    std::uint64_t stats_every;
 
     double dt;
     double time;
+    std::uint64_t ticks;
 
     public:
-    engine()
+    /**
+     * Actions that can be waiting to be drained when none is given; a
+     * queued action takes 48 bytes, so this many cost about 3 MB.
+     */
+    static const std::size_t default_inbox_capacity = 1 << 16;
+
+    explicit engine(std::size_t threads = 1)
         : actors()
         , maze(std::make_shared<maps::Maze>(41, 43, 1))
+        , grid(maze->getWidth(), maze->getHeight())
+        , pool(std::make_shared<utility::thread_pool>(threads))
+        , events()
+        , next_event_id(1)
+        , inbox(default_inbox_capacity)
+        , pending()
+        , drain_order()
+        , drained()
+        , damage()
+        , damage_sorted()
+        , damage_keys()
+        , damage_ends()
+        , chunk_deaths()
+        , deaths()
+        , chunk_crossings()
+        , listener(nullptr)
+        , kernel(kernels::best_integrate_kernel())
+        , stats()
+        , chunk_counts()
+        , stats_out(nullptr)
+        , stats_every(0)
+        , dt(1./100)
+        , time(0)
+        , ticks(0)
+    {}
+
+    /**
+     * Runs on the given maze; engines can share one maze and one pool.
+     * inbox_capacity is how many submitted actions can be waiting for the
+     * next tick, a power of two; submitAction() fails past that.
+     */
+    engine(std::shared_ptr<const maps::Maze> maze,
+           std::shared_ptr<utility::thread_pool> pool =
+               std::make_shared<utility::thread_pool>(1),
+           std::size_t inbox_capacity = default_inbox_capacity)
+        : actors()
+        , maze(maze)
+        , grid(maze->getWidth(), maze->getHeight())
+        , pool(pool)
+        , events()
+        , next_event_id(1)
+        , inbox(inbox_capacity)
+        , pending()
+        , drain_order()
+        , drained()
+        , damage()
+        , damage_sorted()
+        , damage_keys()
+        , damage_ends()
+        , chunk_deaths()
+        , deaths()
+        , chunk_crossings()
+        , listener(nullptr)
+        , kernel(kernels::best_integrate_kernel())
+        , stats()
+        , chunk_counts()
+        , stats_out(nullptr)
+        , stats_every(0)
         , dt(1./100)
         , time(0)
+        , ticks(0)
     {}
 
-    actor& getActor(const std::string& actorId) {
-        return actors[actorId];
+    engine(const engine&) = delete;
+    engine& operator=(const engine&) = delete;
+
+    // the action queue is cache line aligned, which plain operator new
+    // does not guarantee before C++17
+    static void* operator new(std::size_t size) {
+        void* p = nullptr;
+        if (posix_memalign(&p, 64, size) != 0) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+    static void operator delete(void* p) {
+        std::free(p);
+    }
+
+    /* see snapshot.hpp */
+    friend void take_snapshot(const engine& e, snapshot& out,
+                              const snapshot_precision& precision);
+    friend void restore_snapshot(engine& e, const snapshot& s);
+
+    /** Returns a copy of the actor's current state. */
+    actor getActor(actor_handle handle) const {
+        std::size_t i = actors.index_of(handle);
+        assert(i != actor_store::npos);
+        actor a(actors.name[i],
+                osg::Vec2d(actors.position_x[i], actors.position_y[i]),
+                actors.direction[i],
+                actors.health[i],
+                actors.limits[i]);
+        a.speed            = actors.speed[i];
+        a.angular_velocity = actors.angular_velocity[i];
+        a.attack_damage    = actors.attack_damage[i];
+        a.attack_delay     = actors.attack_delay[i];
+        a.attack           = actors.attack[i];
+        return a;
+    }
+
+    /** Name lookup; returns an invalid handle if there is no such actor. */
+    actor_handle findActor(const std::string& name) const {
+        return actors.find(name);
+    }
+
+    bool hasActor(actor_handle handle) const {
+        return actors.contains(handle);
+    }
+
+    std::size_t getActorCount() const {
+        return actors.size();
     }
 
 /*     void maze_interface_demo() {
@@ -148,86 +373,583 @@ class engine {
         maze->getFinish(); // std::pair<size_t, size_t>
     }
 */
-    // moves the simulation forward one tick (0.016 of a second)
+    /**
+     * Moves the simulation forward one tick (dt seconds).
+     *
+     * Submitted actions stamped up to the end of the tick are applied
+     * first, in time order. Phase one integrates every actor in parallel;
+     * each actor only writes its own columns and reads the immutable maze
+     * and its grid cell. The few actors that left their grid cell are then
+     * moved between buckets, in dense order. Phase two then fires the
+     * scheduled events that fall into this tick, serially and in fire time
+     * order, so the outcome is identical for any number of threads.
+     * Actors with nothing scheduled cost nothing in phase two.
+     */
     void simulate() {
+        std::uint64_t tick_ns = 0;
+        phase_timer tick_timer(tick_ns);
         time += dt;
-        for (auto name_actor_pair : actors) {
-            auto& actor = name_actor_pair.second;
-            auto endposition =
-                actor.position + actor.getSpeedAsVector()*dt;
-            if (maze->isPath(
-                        endposition.x(), endposition.y()))
-            {
-                actor.position = endposition;
-            }
-            actor.direction += actor.angular_velocity*dt;
-            if (actor.attack.is_attack_now(time, dt)) {
-                // attack damage happens now
-                if (actors[actor.attack.target].health > 0){
-                    actors[actor.attack.target].health -= actor.attack.damage;
+        deaths.clear();
+        {
+            phase_timer t(stats.phase_ns[engine_stats::DRAIN]);
+            drain_actions();
+        }
+
+        const std::size_t chunks =
+            utility::thread_pool::chunk_count(actors.size(), chunk_size);
+        if (engine_stats::enabled) {
+            chunk_counts.assign(chunks, chunk_stats{0, 0, 0, 0});
+        }
+        if (chunk_crossings.size() < chunks) {
+            chunk_crossings.resize(chunks);
+            for (auto& c : chunk_crossings) { c.reserve(chunk_size); }
+        }
+        auto phase_one = [this](std::size_t chunk,
+                                std::size_t begin, std::size_t end) {
+            integrate(chunk, begin, end);
+        };
+        pool->parallel_for(actors.size(), chunk_size, phase_one);
+        {
+            phase_timer t(stats.phase_ns[engine_stats::GRID]);
+            for (std::size_t c = 0; c < chunks; ++c) {
+                for (auto i : chunk_crossings[c]) {
+                    grid.update(i, actors.position_x[i], actors.position_y[i]);
                 }
+                count(stats.cell_changes, chunk_crossings[c].size());
+            }
+        }
+
+        auto phase_two = [this](double, const timed_event& e) {
+            fire(e);
+        };
+        {
+            phase_timer t(stats.phase_ns[engine_stats::EVENTS]);
+            events.fire_until(time, phase_two);
+        }
+        {
+            phase_timer t(stats.phase_ns[engine_stats::DAMAGE]);
+            resolve_damage();
+        }
+
+        ++ticks;
+        if (engine_stats::enabled) {
+            for (const auto& c : chunk_counts) {
+                stats.phase_ns[engine_stats::INTEGRATE] += c.integrate_ns;
+                stats.phase_ns[engine_stats::COLLIDE] += c.collide_ns;
+                stats.actors_moved += c.moved;
+                stats.wall_hits += c.wall_hits;
+            }
+            stats.addTick(tick_timer.elapsed());
+            if (stats_out && ticks % stats_every == 0) {
+                stats.print(*stats_out);
             }
         }
+        if (listener) {
+            listener->tickSimulated(ticks);
+        }
     }
     double getCurrentTime() {
         return time;
     }
-    void addActor(const actor& act) {
-        actors[act.name] = act;
+    /** Number of ticks simulated so far. */
+    std::uint64_t getTick() const {
+        return ticks;
+    }
+    double getTimeStep() const {
+        return dt;
+    }
+    /** Length of one tick in seconds; only change it between ticks. */
+    void setTimeStep(double step) {
+        assert(step > 0);
+        dt = step;
+    }
+    std::shared_ptr<const maps::Maze> getMaze() const {
+        return maze;
     }
 
-    void applyActionToActor(
-            std::string actorId, StartGoForwardAction forward)
+    /** Overwrites out with the pose of every actor, in dense order. */
+    void captureSnapshot(std::vector<actor_snapshot>& out) const {
+        const std::size_t n = actors.size();
+        out.clear();
+        out.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            out.push_back(actor_snapshot{actors.handle[i],
+                actors.position_x[i], actors.position_y[i],
+                actors.direction[i]});
+        }
+    }
+    actor_handle addActor(const actor& act) {
+        actor_handle handle = actors.insert(act.name);
+        std::size_t i = actors.size() - 1;
+        actors.position_x[i]       = act.position.x();
+        actors.position_y[i]       = act.position.y();
+        actors.turn(i, act.direction);
+        actors.speed[i]            = act.speed;
+        actors.angular_velocity[i] = act.angular_velocity;
+        actors.attack_damage[i]    = act.attack_damage;
+        actors.attack_delay[i]     = act.attack_delay;
+        actors.health[i]           = act.health;
+        actors.limits[i]           = act.limits;
+        actors.attack[i]           = act.attack;
+        grid.insert(i, act.position.x(), act.position.y());
+        if (listener) {
+            listener->actorAdded(ticks, handle, act);
+        }
+        return handle;
+    }
+    void removeActor(actor_handle handle) {
+        std::size_t i = actors.index_of(handle);
+        assert(i != actor_store::npos);
+        grid.erase(i);
+        actors.erase(handle);
+        if (listener) {
+            listener->actorRemoved(ticks, handle);
+        }
+    }
+
+    /**
+     * Puts an actor where someone with more say over it has it, moving
+     * and turning as fast as they have it; client-side prediction uses
+     * this to take on the server's state. Listeners are not told, so it
+     * has no place in an engine that is being recorded.
+     */
+    void placeActor(actor_handle handle, osg::Vec2d position, double direction,
+                    double speed, double angular_velocity) {
+        std::size_t i = actors.index_of(handle);
+        assert(i != actor_store::npos);
+        actors.position_x[i]       = position.x();
+        actors.position_y[i]       = position.y();
+        actors.turn(i, direction);
+        actors.speed[i]            = speed;
+        actors.angular_velocity[i] = angular_velocity;
+        grid.update(i, position.x(), position.y());
+    }
+
+    /**
+     * Overwrites out with every actor within radius of centre, in no
+     * particular order. Only looks at the grid cells the circle touches.
+     */
+    void findActorsInRadius(osg::Vec2d centre, double radius,
+                            std::vector<actor_handle>& out) const {
+        out.clear();
+        grid.forEachInRadius(actors.position_x.data(),
+                actors.position_y.data(), centre.x(), centre.y(), radius,
+                [&](std::uint32_t i) { out.push_back(actors.handle[i]); });
+    }
+    /** Overwrites out with every actor in the box, edges included. */
+    void findActorsInBox(osg::Vec2d low, osg::Vec2d high,
+                         std::vector<actor_handle>& out) const {
+        out.clear();
+        grid.forEachInBox(actors.position_x.data(), actors.position_y.data(),
+                low.x(), low.y(), high.x(), high.y(),
+                [&](std::uint32_t i) { out.push_back(actors.handle[i]); });
+    }
+    /** (squared distance, dense index) pairs, see findNearestActors(). */
+    typedef std::vector<std::pair<double, std::uint32_t>> nearest_scratch;
+
+    /**
+     * Overwrites out with the k actors nearest to point, nearest first.
+     * The search works in scratch, which a caller can keep between calls
+     * so that a query allocates nothing.
+     */
+    void findNearestActors(osg::Vec2d point, std::size_t k,
+                           std::vector<actor_handle>& out,
+                           nearest_scratch& scratch) const {
+        grid.nearest(actors.position_x.data(), actors.position_y.data(),
+                point.x(), point.y(), k, scratch);
+        out.clear();
+        for (const auto& f : scratch) { out.push_back(actors.handle[f.second]); }
+    }
+    void findNearestActors(osg::Vec2d point, std::size_t k,
+                           std::vector<actor_handle>& out) const {
+        nearest_scratch scratch;
+        findNearestActors(point, k, out, scratch);
+    }
+
+    /** The integration kernel in use; the widest one by default. */
+    kernels::integrate_kernel getIntegrationKernel() const {
+        return kernel;
+    }
+    /** All kernels give identical results; this is for benchmarking. */
+    void setIntegrationKernel(kernels::integrate_kernel k) {
+        assert(k.run);
+        kernel = k;
+    }
+
+    /**
+     * The actors whose health dropped to zero or below in the last tick,
+     * or since then through applyActionToActor(), each once, in dense
+     * order. Dead actors stay in the engine until they are removed.
+     */
+    const std::vector<actor_handle>& getDeaths() const {
+        return deaths;
+    }
+
+    /** What the ticks so far cost; all zero without HEXIT_ENGINE_STATS. */
+    const engine_stats& getStats() const {
+        return stats;
+    }
+    void resetStats() {
+        stats.clear();
+    }
+    /**
+     * Prints the stats to out every so many ticks; pass nullptr to stop.
+     * Does nothing without HEXIT_ENGINE_STATS.
+     */
+    void setStatsDump(std::ostream* out, std::uint64_t every_ticks) {
+        assert(!out || every_ticks > 0);
+        stats_out = out;
+        stats_every = every_ticks;
+    }
+
+    /** Only one listener at a time; pass nullptr to stop listening. */
+    void setListener(engine_listener* l) {
+        listener = l;
+    }
+
+    /**
+     * A 64-bit FNV-1a hash of the clock and every actor's state, bit for
+     * bit. Two engines that agree on it have not diverged.
+     */
+    std::uint64_t stateHash() const {
+        std::uint64_t h = 14695981039346656037ull;
+        auto mix = [&h](const void* data, std::size_t size) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            for (std::size_t k = 0; k < size; ++k) {
+                h = (h ^ p[k]) * 1099511628211ull;
+            }
+        };
+        mix(&time, sizeof(time));
+        mix(&ticks, sizeof(ticks));
+        for (std::size_t i = 0; i < actors.size(); ++i) {
+            mix(&actors.handle[i].index, sizeof(std::uint32_t));
+            mix(&actors.handle[i].generation, sizeof(std::uint32_t));
+            mix(&actors.position_x[i], sizeof(double));
+            mix(&actors.position_y[i], sizeof(double));
+            mix(&actors.direction[i], sizeof(double));
+            mix(&actors.speed[i], sizeof(double));
+            mix(&actors.angular_velocity[i], sizeof(double));
+            mix(&actors.health[i], sizeof(double));
+        }
+        return h;
+    }
+
+    /**
+     * Queues an action for the next tick. Unlike applyActionToActor this
+     * is safe to call from any thread, concurrently with simulate().
+     * Actions from one thread are applied in the order they were
+     * submitted unless their timestamps say otherwise.
+     *
+     * @return false if the queue is full and the action was dropped
+     */
+    template <typename Action>
+    bool submitAction(actor_handle actorId, Action action) {
+        return inbox.push(make_action(actorId, action));
+    }
+
+    /**
+     * Puts an action straight into the next tick's drain, as if it had
+     * come through the queue; simulation thread only. Replays use this.
+     */
+    void queueAction(const timed_action& a) {
+        pending.insert(std::upper_bound(pending.begin(), pending.end(), a,
+                    earlier()), a);
+    }
+
+    /** Applies a flat action right away; simulation thread only. */
+    void applyAction(const timed_action& a) {
+        apply(a, false);
+    }
+
+    void applyActionToActor(actor_handle actorId, StartGoForwardAction x)
     {
-        auto actor  = actors[actorId];
-        actor.speed = actor.speed;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, StopGoForwardAction forward)
+    void applyActionToActor(actor_handle actorId, StopGoForwardAction x)
     {
-        auto actor = actors[actorId];
-        actor.speed = 0;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, StartGoBackwardAction backward)
+    void applyActionToActor(actor_handle actorId, StartGoBackwardAction x)
     {
-        auto actor = actors[actorId];
-        actor.speed = -actor.speed;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId ,StopGoBackwardAction backward)
+    void applyActionToActor(actor_handle actorId, StopGoBackwardAction x)
     {
-        auto actor = actors[actorId];
-        actor.speed = 0;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, StartRotateLeftAction left)
+    void applyActionToActor(actor_handle actorId, StartRotateLeftAction x)
     {
-        auto actor = actors[actorId];
-        actor.angular_velocity = actor.limits.angular_velocity;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, StopRotateLeftAction left)
+    void applyActionToActor(actor_handle actorId, StopRotateLeftAction x)
     {
-        auto actor = actors[actorId];
-        actor.angular_velocity = 0;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, StartRotateRightAction right)
+    void applyActionToActor(actor_handle actorId, StartRotateRightAction x)
     {
-        auto actor = actors[actorId];
-        actor.angular_velocity = actor.angular_velocity;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, StopRotateRightAction right)
+    void applyActionToActor(actor_handle actorId, StopRotateRightAction x)
     {
-        auto actor = actors[actorId];
-        actor.angular_velocity = 0;
+        apply(make_action(actorId, x), false);
     }
-    void applyActionToActor(std::string actorId, Attack attack)
+    void applyActionToActor(actor_handle actorId, Attack x)
     {
-        auto& target = actors[attack.targetId];
-        auto& actor  = actors[actorId];
-        actor.attack = ActiveAttack{
-            time,
-            actor.attack_delay, actor.attack_damage,
-            attack.targetId
-        };
+        apply(make_action(actorId, x), false);
+    }
+    void applyActionToActor(actor_handle actorId, AreaAttack x)
+    {
+        apply(make_action(actorId, x), false);
     }
 
+    private:
+    struct earlier {
+        bool operator()(const timed_action& a, const timed_action& b) const {
+            return a.time < b.time;
+        }
+    };
+
+    /** The one place actions change actors. */
+    void apply(const timed_action& a, bool queued) {
+        std::size_t i = actors.index_of(a.actor);
+        if (i == actor_store::npos) { return; } // actor is gone
+        if (listener) {
+            listener->actionApplied(ticks, queued, a);
+        }
+        count(stats.actions_applied);
+        switch (a.type) {
+            case action_type::START_GO_FORWARD:
+                actors.speed[i] = actors.limits[i].speed;
+                break;
+            case action_type::STOP_GO_FORWARD:
+                actors.speed[i] = 0;
+                break;
+            case action_type::START_GO_BACKWARD:
+                actors.speed[i] = -actors.limits[i].speed;
+                break;
+            case action_type::STOP_GO_BACKWARD:
+                actors.speed[i] = 0;
+                break;
+            case action_type::START_ROTATE_LEFT:
+                actors.angular_velocity[i] = actors.limits[i].angular_velocity;
+                break;
+            case action_type::STOP_ROTATE_LEFT:
+                actors.angular_velocity[i] = 0;
+                break;
+            case action_type::START_ROTATE_RIGHT:
+                actors.angular_velocity[i] = -actors.limits[i].angular_velocity;
+                break;
+            case action_type::STOP_ROTATE_RIGHT:
+                actors.angular_velocity[i] = 0;
+                break;
+            case action_type::ATTACK:
+            {
+                // a new attack replaces the one being wound up, whose event
+                // is then ignored because the ids no longer match
+                count(stats.attacks_started);
+                std::uint64_t id = next_event_id++;
+                actors.attack[i] = ActiveAttack{
+                    a.time,
+                    actors.attack_delay[i], actors.attack_damage[i],
+                    a.target,
+                    id
+                };
+                events.schedule(a.time + actors.attack_delay[i], timed_event{
+                        timed_event::kind::ATTACK_LANDS, a.actor, id});
+            }break;
+            case action_type::AREA_ATTACK:
+            {
+                count(stats.attacks_started);
+                const double damage = actors.attack_damage[i];
+                grid.forEachInRadius(actors.position_x.data(),
+                        actors.position_y.data(), actors.position_x[i],
+                        actors.position_y[i], a.radius, [&](std::uint32_t k) {
+                            if (k != i) { deal_damage(k, damage); }
+                        });
+            }break;
+        }
+        // outside a tick nothing else is going to resolve it
+        if (!queued) { resolve_damage(); }
+    }
+
+    void deal_damage(std::size_t target, double amount) {
+        damage.push_back(damage_event{
+                static_cast<std::uint32_t>(target), amount});
+    }
+
+    /** Takes the health; reports the actor if that killed it. */
+    void take_damage(std::size_t i, double amount,
+                     std::vector<actor_handle>& died) {
+        if (actors.health[i] <= 0) { return; } // already dead
+        actors.health[i] -= amount;
+        if (actors.health[i] <= 0) { died.push_back(actors.handle[i]); }
+    }
+
+    /**
+     * Applies all the damage dealt since the last call. Every target's
+     * damage is added up in the order it was dealt before it comes off
+     * its health, so the result does not depend on the order attacks
+     * are resolved in, and an actor dies once however many blows it got.
+     * A few events are sorted by target; many are bucketed by target with
+     * a counting sort and taken in parallel over targets.
+     */
+    void resolve_damage() {
+        if (damage.empty()) { return; }
+        count(stats.damage_events, damage.size());
+        const std::size_t n = actors.size();
+        const std::size_t before = deaths.size();
+
+        if (damage.size() * 16 < n) {
+            damage_keys.clear();
+            for (std::size_t k = 0; k < damage.size(); ++k) {
+                damage_keys.push_back(std::make_pair(damage[k].target,
+                            static_cast<std::uint32_t>(k)));
+            }
+            std::sort(damage_keys.begin(), damage_keys.end());
+            for (std::size_t k = 0; k < damage_keys.size(); ) {
+                const std::uint32_t target = damage_keys[k].first;
+                double total = 0;
+                for (; k < damage_keys.size() && damage_keys[k].first == target;
+                        ++k) {
+                    total += damage[damage_keys[k].second].amount;
+                }
+                take_damage(target, total, deaths);
+            }
+        } else {
+            // damage_ends[t] is where target t's damage ends in
+            // damage_sorted, and where t + 1's starts
+            damage_ends.assign(n, 0);
+            for (const auto& d : damage) { ++damage_ends[d.target]; }
+            std::uint32_t sum = 0;
+            for (auto& c : damage_ends) { sum += c; c = sum - c; }
+            damage_sorted.resize(damage.size());
+            for (const auto& d : damage) {
+                damage_sorted[damage_ends[d.target]++] = d;
+            }
+
+            const std::size_t chunks =
+                utility::thread_pool::chunk_count(n, chunk_size);
+            if (chunk_deaths.size() < chunks) { chunk_deaths.resize(chunks); }
+            auto take = [this](std::size_t chunk,
+                               std::size_t begin, std::size_t end) {
+                std::vector<actor_handle>& died = chunk_deaths[chunk];
+                died.clear();
+                std::size_t k = begin ? damage_ends[begin - 1] : 0;
+                for (std::size_t t = begin; t < end; ++t) {
+                    if (k == damage_ends[t]) { continue; }
+                    double total = 0;
+                    for (; k < damage_ends[t]; ++k) {
+                        total += damage_sorted[k].amount;
+                    }
+                    take_damage(t, total, died);
+                }
+            };
+            pool->parallel_for(n, chunk_size, take);
+            for (std::size_t c = 0; c < chunks; ++c) {
+                deaths.insert(deaths.end(), chunk_deaths[c].begin(),
+                        chunk_deaths[c].end());
+            }
+        }
+        count(stats.deaths, deaths.size() - before);
+        damage.clear();
+    }
+
+    /** Applies everything submitted so far that is due by now. */
+    void drain_actions() {
+        std::size_t carried = pending.size();
+        if (inbox.drain(pending) == 0 && carried == 0) { return; }
+
+        // the carried-over part is sorted already. The new part is sorted
+        // on time and then arrival, which keeps every producer's actions in
+        // submission order among equal times, and merged in behind the
+        // carried-over actions of the same time. std::stable_sort and
+        // std::inplace_merge would do the same but allocate every time.
+        if (pending.size() > carried) {
+            drain_order.clear();
+            for (std::size_t i = carried; i < pending.size(); ++i) {
+                drain_order.push_back(std::make_pair(pending[i].time, i));
+            }
+            std::sort(drain_order.begin(), drain_order.end());
+            drained.clear();
+            std::size_t c = 0;
+            for (const auto& o : drain_order) {
+                while (c < carried && !(o.first < pending[c].time)) {
+                    drained.push_back(pending[c++]);
+                }
+                drained.push_back(pending[o.second]);
+            }
+            drained.insert(drained.end(), pending.begin() + c,
+                    pending.begin() + carried);
+            pending.swap(drained);
+        }
+
+        auto due = std::upper_bound(pending.begin(), pending.end(),
+                timed_action{time, actor_handle(), actor_handle(),
+                    action_type::ATTACK, 0},
+                earlier());
+        for (auto it = pending.begin(); it != due; ++it) {
+            apply(*it, true);
+        }
+        pending.erase(pending.begin(), due);
+    }
+
+    void integrate(std::size_t chunk, std::size_t begin, std::size_t end) {
+        assert(end - begin <= chunk_size);
+        chunk_stats local{0, 0, 0, 0};
+        std::vector<std::uint32_t>& crossed = chunk_crossings[chunk];
+        crossed.clear();
+        double step_x[chunk_size];
+        double step_y[chunk_size];
+        {
+            phase_timer t(local.integrate_ns);
+            kernel.run(&actors.heading_x[begin], &actors.heading_y[begin],
+                    &actors.speed[begin], &actors.angular_velocity[begin],
+                    &actors.direction[begin], step_x, step_y, end - begin, dt);
+        }
+
+        // the steps were taken from the headings before this tick's turn
+        {
+            phase_timer t(local.collide_ns);
+            for (std::size_t i = begin; i < end; ++i) {
+                if (actors.speed[i] != 0) {
+                    count(local.moved);
+                    if (sweep(*maze, actors.position_x[i], actors.position_y[i],
+                                step_x[i - begin], step_y[i - begin])) {
+                        count(local.wall_hits);
+                    }
+                    if (grid.leftCell(i, actors.position_x[i],
+                                actors.position_y[i])) {
+                        crossed.push_back(static_cast<std::uint32_t>(i));
+                    }
+                }
+                if (actors.angular_velocity[i] != 0) {
+                    actors.turn(i, actors.direction[i]);
+                }
+            }
+        }
+        if (engine_stats::enabled) {
+            chunk_counts[chunk] = local;
+        }
+    }
+
+    void fire(const timed_event& e) {
+        std::size_t i = actors.index_of(e.actor);
+        if (i == actor_store::npos) { return; } // actor is gone
+        switch (e.type) {
+            case timed_event::kind::ATTACK_LANDS:
+            {
+                ActiveAttack& attack = actors.attack[i];
+                if (attack.id != e.id) { return; } // superseded
+                count(stats.target_lookups);
+                std::size_t target = actors.index_of(attack.target);
+                if (target != actor_store::npos && actors.health[target] > 0) {
+                    count(stats.attacks_landed);
+                    deal_damage(target, attack.damage);
+                }
+                attack.target = actor_handle();
+            }break;
+        }
+    }
 };
 
 
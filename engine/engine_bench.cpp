@@ -0,0 +1,466 @@
+/**
+ * @file engine_bench.cpp
+ *  BENCHMARK FOR engine::simulate()
+ *
+ * Builds a maze and a population of actors for every requested population
+ * size and times a number of ticks. Prints ns per actor per tick, ticks per
+ * second, peak RSS and the heap allocations made while ticking, either as
+ * a table or as JSON. The peak RSS is reset before every run, so it is
+ * that run's own, from where the runs before it left the process.
+ *
+ * usage: engine_bench [--actors=1,10,...] [--ticks=N] [--threads=N]
+ *                     [--moving=F] [--rotating=F] [--attacking=F]
+ *                     [--maze=N] [--seed=N] [--json]
+ *                     [--record=PATH] [--hash-every=N] [--snapshots]
+ *                     [--kernel=scalar|sse2|avx2] [--stats] [--queries]
+ *
+ * With --record every run is also written to PATH.<actors> as an action
+ * log that engine_replay can check. With --snapshots the final state is
+ * also snapshotted, encoded as a keyframe and as a delta against the tick
+ * before, and the sizes and times are reported. With --stats the engine's
+ * own phase timings and counters (see stats.hpp) go to stderr. With
+ * --queries the final state is also searched around random actors, for
+ * everyone within two cells, everyone in a four by four box and the
+ * eight nearest, and the time per query is reported.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "engine.hpp"
+#include "replay.hpp"
+#include "snapshot.hpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* count every heap allocation the process makes */
+static std::atomic<std::size_t> allocations(0);
+static std::atomic<std::size_t> allocated_bytes(0);
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+static const double TAU = 2*M_PI;
+
+struct options {
+    std::vector<std::size_t> populations;
+    std::size_t ticks;
+    std::size_t threads;
+    double moving;    // fraction of actors walking forward
+    double rotating;  // fraction of actors turning
+    double attacking; // fraction of actors attacking someone
+    std::size_t maze; // maze side, 0 picks one to fit the population
+    unsigned seed;
+    bool json;
+    std::string record; // action log path prefix, empty for none
+    std::size_t hash_every;
+    bool snapshots;
+    std::string kernel; // integration kernel, the best one by default
+    bool stats;
+    bool queries;
+};
+
+struct result {
+    std::size_t actors;
+    std::size_t maze_side;
+    double seconds;
+    std::size_t ticks;
+    long peak_rss_kb;
+    std::size_t allocations;
+    std::size_t allocated_bytes;
+    // snapshot of the final tick, all zero without --snapshots
+    double snapshot_us;  // take_snapshot into reused storage
+    double keyframe_us;  // encode_snapshot without a baseline
+    double delta_us;     // encode_snapshot against the previous tick
+    std::size_t keyframe_bytes;
+    std::size_t delta_bytes;
+    // spatial queries on the final tick, all zero without --queries
+    double radius_us;
+    double box_us;
+    double nearest_us;
+    double found;        // actors per radius query
+};
+
+std::vector<std::size_t>
+parse_list(const std::string& s)
+{
+    std::vector<std::size_t> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        out.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return out;
+}
+
+options
+parse_options(int argc, char* argv[])
+{
+    options o{
+        {1, 10, 100, 1000, 10000, 100000, 1000000},
+        100, 1, 0.8, 0.3, 0.1, 0, 1, false, "", 100, false, "", false, false
+    };
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string key = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') == std::string::npos
+            ? "" : arg.substr(arg.find('=') + 1);
+        if      (key == "--actors")    { o.populations = parse_list(value); }
+        else if (key == "--ticks")     { o.ticks = std::atoi(value.c_str()); }
+        else if (key == "--threads")   { o.threads = std::atoi(value.c_str()); }
+        else if (key == "--moving")    { o.moving = std::atof(value.c_str()); }
+        else if (key == "--rotating")  { o.rotating = std::atof(value.c_str()); }
+        else if (key == "--attacking") { o.attacking = std::atof(value.c_str()); }
+        else if (key == "--maze")      { o.maze = std::atoi(value.c_str()); }
+        else if (key == "--seed")      { o.seed = std::atoi(value.c_str()); }
+        else if (key == "--json")      { o.json = true; }
+        else if (key == "--record")    { o.record = value; }
+        else if (key == "--hash-every") { o.hash_every = std::atoi(value.c_str()); }
+        else if (key == "--snapshots") { o.snapshots = true; }
+        else if (key == "--kernel")    { o.kernel = value; }
+        else if (key == "--stats")     { o.stats = true; }
+        else if (key == "--queries")   { o.queries = true; }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    if (o.kernel.empty()) {
+        o.kernel = engine::kernels::best_integrate_kernel().name;
+    } else if (!engine::kernels::find_integrate_kernel(o.kernel.c_str()).run) {
+        std::cerr << "kernel " << o.kernel << " is not available" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return o;
+}
+
+/**
+ * Starts counting the peak RSS over from the current RSS, so every run
+ * reports its own peak rather than the process's so far. Returns false
+ * where the kernel does not allow it (Linux before 4.0, or no /proc).
+ */
+bool
+reset_peak_rss()
+{
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5" << std::flush;
+    return bool(clear);
+}
+
+/** VmHWM since the last reset_peak_rss(), or the whole process's peak. */
+long
+peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atol(line.c_str() + 6);
+        }
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/** Roughly two actors per path cell, capped so generation stays quick. */
+std::size_t
+maze_side_for(std::size_t actors)
+{
+    std::size_t side = static_cast<std::size_t>(std::sqrt(actors)) + 1;
+    return std::max<std::size_t>(41, std::min<std::size_t>(501, side));
+}
+
+/** Maze only copes with odd sides. */
+std::size_t
+odd(std::size_t side)
+{
+    return side | 1;
+}
+
+result
+run(const options& o, std::size_t population)
+{
+    std::size_t side = odd(o.maze ? o.maze : maze_side_for(population));
+    if (!reset_peak_rss()) {
+        static bool warned = false;
+        if (!warned) {
+            std::cerr << "peak RSS cannot be reset; peak_rss_kb is the "
+                         "peak over every run so far" << std::endl;
+            warned = true;
+        }
+    }
+    auto maze = std::make_shared<const maps::Maze>(side, side, 1);
+    engine::engine e(maze, std::make_shared<utility::thread_pool>(o.threads));
+    e.setIntegrationKernel(engine::kernels::find_integrate_kernel(
+                o.kernel.c_str()));
+
+    std::ofstream log;
+    std::unique_ptr<engine::action_recorder> recorder;
+    if (!o.record.empty()) {
+        std::ostringstream path;
+        path << o.record << "." << population;
+        log.open(path.str().c_str(), std::ios::binary);
+        recorder.reset(new engine::action_recorder(e, log, o.hash_every));
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> cells;
+    for (std::size_t x = 1; x < maze->getWidth(); ++x) {
+        for (std::size_t y = 1; y < maze->getHeight(); ++y) {
+            if (maze->isPath(x, y)) { cells.push_back(std::make_pair(x, y)); }
+        }
+    }
+
+    std::mt19937 rng(o.seed);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<engine::actor_handle> crowd;
+    std::vector<engine::actor_handle> attackers;
+    crowd.reserve(population);
+    for (std::size_t i = 0; i < population; ++i) {
+        auto cell = cells[rng() % cells.size()];
+        auto h = e.addActor(engine::actor(
+                    "",
+                    osg::Vec2d(cell.first + unit(rng), cell.second + unit(rng)),
+                    unit(rng) * TAU,
+                    100,
+                    engine::actor_properties{1, TAU/4, 1, 0.25, 100}));
+        double now = e.getCurrentTime();
+        if (unit(rng) < o.moving) {
+            e.applyActionToActor(h, engine::StartGoForwardAction{now});
+        } else {
+            e.applyActionToActor(h, engine::StopGoForwardAction{now});
+        }
+        if (unit(rng) < o.rotating) {
+            e.applyActionToActor(h, engine::StartRotateLeftAction{now});
+        }
+        if (unit(rng) < o.attacking) {
+            attackers.push_back(h);
+        }
+        crowd.push_back(h);
+    }
+
+    // attackers swing again as soon as the last swing has landed
+    const std::size_t swing_ticks = static_cast<std::size_t>(
+            std::ceil(0.25 / e.getTimeStep()));
+
+    std::size_t allocs_before = allocations.load();
+    std::size_t bytes_before = allocated_bytes.load();
+    std::chrono::steady_clock::duration busy(0);
+    engine::snapshot previous;
+    for (std::size_t t = 0; t < o.ticks; ++t) {
+        if (o.snapshots && t + 1 == o.ticks) {
+            engine::take_snapshot(e, previous);
+        }
+        if (t % swing_ticks == 0) {
+            for (std::size_t i = 0; i < attackers.size(); ++i) {
+                e.applyActionToActor(attackers[i], engine::Attack{
+                        e.getCurrentTime(), crowd[rng() % crowd.size()]});
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        e.simulate();
+        busy += std::chrono::steady_clock::now() - start;
+    }
+    if (recorder) {
+        recorder->finish();
+    }
+    if (o.stats) {
+        std::cerr << population << " actors: ";
+        e.getStats().print(std::cerr);
+    }
+    std::size_t allocs = allocations.load() - allocs_before;
+    std::size_t bytes = allocated_bytes.load() - bytes_before;
+
+    double snapshot_us = 0, keyframe_us = 0, delta_us = 0;
+    std::vector<unsigned char> keyframe, delta;
+    if (o.snapshots) {
+        typedef std::chrono::duration<double, std::micro> us;
+        // the second snapshot into the same storage is the one a server
+        // taking one every tick pays for, and likewise for the encoding
+        engine::snapshot current;
+        engine::take_snapshot(e, current);
+        engine::encode_snapshot(current, nullptr, keyframe);
+        keyframe.clear();
+        auto t0 = std::chrono::steady_clock::now();
+        engine::take_snapshot(e, current);
+        auto t1 = std::chrono::steady_clock::now();
+        engine::encode_snapshot(current, nullptr, keyframe);
+        auto t2 = std::chrono::steady_clock::now();
+        engine::encode_snapshot(current, &previous, delta);
+        auto t3 = std::chrono::steady_clock::now();
+        snapshot_us = us(t1 - t0).count();
+        keyframe_us = us(t2 - t1).count();
+        delta_us = us(t3 - t2).count();
+    }
+
+    double radius_us = 0, box_us = 0, nearest_us = 0, found = 0;
+    if (o.queries) {
+        typedef std::chrono::duration<double, std::micro> us;
+        const std::size_t queries = 10000;
+        std::vector<osg::Vec2d> at;
+        for (std::size_t q = 0; q < queries; ++q) {
+            at.push_back(e.getActor(crowd[rng() % crowd.size()]).position);
+        }
+        std::vector<engine::actor_handle> out;
+        out.reserve(population);
+        std::size_t total = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const auto& p : at) {
+            e.findActorsInRadius(p, 2, out);
+            total += out.size();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (const auto& p : at) {
+            e.findActorsInBox(p - osg::Vec2d(2, 2), p + osg::Vec2d(2, 2), out);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        engine::engine::nearest_scratch scratch;
+        for (const auto& p : at) {
+            e.findNearestActors(p, 8, out, scratch);
+        }
+        auto t3 = std::chrono::steady_clock::now();
+        radius_us = us(t1 - t0).count() / queries;
+        box_us = us(t2 - t1).count() / queries;
+        nearest_us = us(t3 - t2).count() / queries;
+        found = double(total) / queries;
+    }
+
+    return result{
+        population,
+        maze->getWidth(),
+        std::chrono::duration<double>(busy).count(),
+        o.ticks,
+        peak_rss_kb(),
+        allocs,
+        bytes,
+        snapshot_us,
+        keyframe_us,
+        delta_us,
+        keyframe.size(),
+        delta.size(),
+        radius_us,
+        box_us,
+        nearest_us,
+        found
+    };
+}
+
+void
+print_table(const std::vector<result>& results)
+{
+    std::cout << "actors\tmaze\tns/actor/tick\tticks/s\tpeak_rss_kb"
+                 "\tallocs\talloc_bytes\tsnap_us\tkey_us\tdelta_us"
+                 "\tkey_bytes\tdelta_bytes\tradius_us\tbox_us\tknn_us"
+                 "\tfound" << std::endl;
+    for (auto& r : results) {
+        std::cout << r.actors << "\t"
+                  << r.maze_side << "\t"
+                  << r.seconds * 1e9 / r.ticks / r.actors << "\t"
+                  << r.ticks / r.seconds << "\t"
+                  << r.peak_rss_kb << "\t"
+                  << r.allocations << "\t"
+                  << r.allocated_bytes << "\t"
+                  << r.snapshot_us << "\t"
+                  << r.keyframe_us << "\t"
+                  << r.delta_us << "\t"
+                  << r.keyframe_bytes << "\t"
+                  << r.delta_bytes << "\t"
+                  << r.radius_us << "\t"
+                  << r.box_us << "\t"
+                  << r.nearest_us << "\t"
+                  << r.found << std::endl;
+    }
+}
+
+void
+print_json(const options& o, const std::vector<result>& results)
+{
+    std::cout << "{\"threads\": " << o.threads
+              << ", \"kernel\": \"" << o.kernel << "\""
+              << ", \"ticks\": " << o.ticks
+              << ", \"moving\": " << o.moving
+              << ", \"rotating\": " << o.rotating
+              << ", \"attacking\": " << o.attacking
+              << ", \"seed\": " << o.seed
+              << ", \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const result& r = results[i];
+        std::cout << (i ? ", " : "")
+                  << "{\"actors\": " << r.actors
+                  << ", \"maze\": " << r.maze_side
+                  << ", \"ns_per_actor_tick\": "
+                      << r.seconds * 1e9 / r.ticks / r.actors
+                  << ", \"ticks_per_second\": " << r.ticks / r.seconds
+                  << ", \"peak_rss_kb\": " << r.peak_rss_kb
+                  << ", \"allocations\": " << r.allocations
+                  << ", \"allocated_bytes\": " << r.allocated_bytes
+                  << ", \"snapshot_us\": " << r.snapshot_us
+                  << ", \"keyframe_encode_us\": " << r.keyframe_us
+                  << ", \"delta_encode_us\": " << r.delta_us
+                  << ", \"keyframe_bytes\": " << r.keyframe_bytes
+                  << ", \"delta_bytes\": " << r.delta_bytes
+                  << ", \"radius_query_us\": " << r.radius_us
+                  << ", \"box_query_us\": " << r.box_us
+                  << ", \"nearest_query_us\": " << r.nearest_us
+                  << ", \"found_per_radius_query\": " << r.found
+                  << "}";
+    }
+    std::cout << "]}" << std::endl;
+}
+
+} // end anonymous namespace
+
+int main( int argc, char *argv[] )
+{
+    options o = parse_options(argc, argv);
+
+    std::vector<result> results;
+    for (std::size_t population : o.populations) {
+        if (population == 0) { continue; }
+        results.push_back(run(o, population));
+        if (!o.json) {
+            std::cerr << "done " << population << " actors" << std::endl;
+        }
+    }
+
+    if (o.json) {
+        print_json(o, results);
+    } else {
+        std::cout << "kernel: " << o.kernel << std::endl;
+        print_table(results);
+    }
+    return EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
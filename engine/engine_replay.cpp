@@ -0,0 +1,70 @@
+/**
+ * @file engine_replay.cpp
+ *  REPLAYS RECORDED ACTION LOGS
+ *
+ * Runs every log given on the command line headless, as fast as the CPU
+ * allows, checks the state hashes recorded in it and reports how much
+ * faster than real time it went. Exits with failure if any log is damaged
+ * or diverges.
+ *
+ * usage: engine_replay [--threads=N] log...
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "replay.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main( int argc, char *argv[] )
+{
+    std::size_t threads = 1;
+    int failures = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 10, "--threads=") == 0) {
+            threads = std::atoi(arg.c_str() + 10);
+            continue;
+        }
+
+        std::ifstream in(arg.c_str(), std::ios::binary);
+        if (!in) {
+            std::cerr << arg << ": cannot open" << std::endl;
+            ++failures;
+            continue;
+        }
+        try {
+            auto start = std::chrono::steady_clock::now();
+            engine::replay_result r = engine::replay(in, threads);
+            double wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+            std::cout << arg << ": " << r.ticks << " ticks, "
+                      << r.hashes_checked << " hashes ok, "
+                      << r.game_time << " s of game time in "
+                      << wall << " s ("
+                      << (wall > 0 ? r.game_time / wall : 0) << "x realtime), "
+                      << "final hash " << std::hex << r.final_hash << std::dec
+                      << std::endl;
+        } catch (engine::err::diverged& e) {
+            const unsigned long long* tick =
+                boost::get_error_info<engine::err::tick>(e);
+            std::cout << arg << ": DIVERGED at tick "
+                      << (tick ? *tick : 0) << std::endl;
+            ++failures;
+        } catch (engine::err::bad_format& e) {
+            const std::string* reason =
+                boost::get_error_info<engine::err::reason>(e);
+            std::cout << arg << ": bad log: "
+                      << (reason ? *reason : "?") << std::endl;
+            ++failures;
+        }
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
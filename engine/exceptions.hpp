@@ -0,0 +1,25 @@
+#ifndef ENGINE_EXCEPTIONS_HPP_HEADER
+#define ENGINE_EXCEPTIONS_HPP_HEADER
+/**
+ * @file exceptions.hpp
+ * 
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+#include <string>
+#include <boost/exception/all.hpp>
+
+namespace engine {
+namespace err {
+
+    struct exception_base : virtual std::exception, virtual boost::exception {};
+    struct bad_format     : virtual exception_base {};
+    struct diverged       : virtual exception_base {};
+    typedef boost::error_info<struct tag_reason, std::string> reason;
+    typedef boost::error_info<struct tag_tick, unsigned long long> tick;
+
+}
+}
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * @file host_bench.cpp
+ *  BENCHMARK FOR engine::match_host
+ *
+ * Hosts a number of small matches in real time for a while and reports
+ * how many ticks got done, how busy the workers were and the tick latency
+ * percentiles, either as a table or as JSON.
+ *
+ * usage: host_bench [--matches=N] [--actors=N] [--threads=N] [--pin]
+ *                   [--seconds=F] [--rate=N] [--maps=N] [--maze=N]
+ *                   [--seed=N] [--json]
+ *
+ * --actors is per match, --rate the ticks per second of every match and
+ * --maps the number of different maps the matches are spread over.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "match_host.hpp"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+static const double TAU = 2*M_PI;
+
+struct options {
+    std::size_t matches;
+    std::size_t actors;
+    std::size_t threads;
+    bool pin;
+    double seconds;
+    double rate;
+    std::size_t maps;
+    std::size_t maze;
+    unsigned seed;
+    bool json;
+};
+
+options
+parse_options(int argc, char* argv[])
+{
+    options o{1000, 20, 0, false, 5, 30, 10, 21, 1, false};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string key = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') == std::string::npos
+            ? "" : arg.substr(arg.find('=') + 1);
+        if      (key == "--matches") { o.matches = std::atoi(value.c_str()); }
+        else if (key == "--actors")  { o.actors = std::atoi(value.c_str()); }
+        else if (key == "--threads") { o.threads = std::atoi(value.c_str()); }
+        else if (key == "--pin")     { o.pin = true; }
+        else if (key == "--seconds") { o.seconds = std::atof(value.c_str()); }
+        else if (key == "--rate")    { o.rate = std::atof(value.c_str()); }
+        else if (key == "--maps")    { o.maps = std::atoi(value.c_str()); }
+        else if (key == "--maze")    { o.maze = std::atoi(value.c_str()); }
+        else if (key == "--seed")    { o.seed = std::atoi(value.c_str()); }
+        else if (key == "--json")    { o.json = true; }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    if (o.maps == 0 || o.rate <= 0) {
+        std::cerr << "--maps and --rate have to be positive" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return o;
+}
+
+double
+cpu_seconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+void
+populate(engine::engine& e, std::size_t actors, std::mt19937& rng)
+{
+    const maps::Maze& maze = *e.getMaze();
+    std::vector<std::pair<std::size_t, std::size_t>> cells;
+    for (std::size_t x = 1; x < maze.getWidth(); ++x) {
+        for (std::size_t y = 1; y < maze.getHeight(); ++y) {
+            if (maze.isPath(x, y)) { cells.push_back(std::make_pair(x, y)); }
+        }
+    }
+    std::uniform_real_distribution<double> unit(0, 1);
+    for (std::size_t i = 0; i < actors; ++i) {
+        auto cell = cells[rng() % cells.size()];
+        auto h = e.addActor(engine::actor(
+                    "",
+                    osg::Vec2d(cell.first + unit(rng), cell.second + unit(rng)),
+                    unit(rng) * TAU,
+                    100,
+                    engine::actor_properties{1, TAU/4, 1, 0.25, 100}));
+        if (i % 3 == 0) {
+            e.applyActionToActor(h,
+                    engine::StartRotateLeftAction{e.getCurrentTime()});
+        }
+    }
+}
+
+} // end anonymous namespace
+
+int main( int argc, char *argv[] )
+{
+    options o = parse_options(argc, argv);
+    std::size_t side = o.maze | 1; // Maze only copes with odd sides
+
+    engine::match_host host(o.threads, o.pin);
+    std::mt19937 rng(o.seed);
+    for (std::size_t i = 0; i < o.matches; ++i) {
+        std::size_t id = host.addMatch(side, side, 1,
+                o.seed + static_cast<unsigned>(i % o.maps), 1 / o.rate);
+        populate(host.getMatch(id), o.actors, rng);
+    }
+
+    double cpu_before = cpu_seconds();
+    auto start = std::chrono::steady_clock::now();
+    host.run(o.seconds);
+    double wall = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    double cpu = cpu_seconds() - cpu_before;
+
+    engine::latency_report r = host.latencyReport();
+    double scheduled = o.matches * o.rate * o.seconds;
+    double utilization = cpu / (wall * host.getThreadCount());
+
+    if (o.json) {
+        std::cout << "{\"matches\": " << o.matches
+                  << ", \"actors_per_match\": " << o.actors
+                  << ", \"threads\": " << host.getThreadCount()
+                  << ", \"pinned\": " << (host.isPinned() ? "true" : "false")
+                  << ", \"mazes\": " << host.getMazeCache().size()
+                  << ", \"seconds\": " << wall
+                  << ", \"ticks\": " << r.ticks
+                  << ", \"ticks_scheduled\": " << scheduled
+                  << ", \"cpu_utilization\": " << utilization
+                  << ", \"missed\": " << r.missed
+                  << ", \"dropped\": " << r.dropped
+                  << ", \"p50_us\": " << r.p50
+                  << ", \"p99_us\": " << r.p99
+                  << ", \"p999_us\": " << r.p999
+                  << ", \"max_us\": " << r.max
+                  << "}" << std::endl;
+    } else {
+        std::cout << "matches\tthreads\tmazes\tticks\tscheduled\tcpu"
+                     "\tmissed\tdropped\tp50_us\tp99_us\tp999_us\tmax_us"
+                  << std::endl;
+        std::cout << o.matches << "\t"
+                  << host.getThreadCount() << (host.isPinned() ? "p" : "")
+                  << "\t" << host.getMazeCache().size() << "\t"
+                  << r.ticks << "\t"
+                  << scheduled << "\t"
+                  << utilization << "\t"
+                  << r.missed << "\t"
+                  << r.dropped << "\t"
+                  << r.p50 << "\t"
+                  << r.p99 << "\t"
+                  << r.p999 << "\t"
+                  << r.max << std::endl;
+    }
+    return EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
@@ -0,0 +1,144 @@
+#ifndef INTEGRATE_HPP_HEADER
+#define INTEGRATE_HPP_HEADER
+
+/**
+ * @file integrate.hpp
+ * The arithmetic half of moving actors, over whole columns at a time.
+ *
+ * For n actors it computes the step every actor wants to take this tick,
+ * (heading * speed) * dt, and advances every direction by
+ * angular_velocity * dt. Collision is left to the caller. There is a plain
+ * loop, an SSE2 and an AVX2 version; best_integrate_kernel() picks the
+ * widest one the processor runs. All of them do the same multiplications
+ * and additions in the same order and never fuse them, so they give
+ * bit-identical results and the engine stays deterministic whichever
+ * one runs.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEXIT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace engine {
+namespace kernels {
+
+typedef void (*integrate_fn)(const double* heading_x, const double* heading_y,
+                             const double* speed, const double* angular_velocity,
+                             double* direction, double* step_x, double* step_y,
+                             std::size_t n, double dt);
+
+struct integrate_kernel {
+    const char* name;
+    integrate_fn run;
+};
+
+inline void
+integrate_scalar(const double* heading_x, const double* heading_y,
+                 const double* speed, const double* angular_velocity,
+                 double* direction, double* step_x, double* step_y,
+                 std::size_t n, double dt)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        step_x[i] = (heading_x[i] * speed[i]) * dt;
+        step_y[i] = (heading_y[i] * speed[i]) * dt;
+        direction[i] += angular_velocity[i] * dt;
+    }
+}
+
+#ifdef HEXIT_X86_KERNELS
+
+__attribute__((target("sse2"))) inline void
+integrate_sse2(const double* heading_x, const double* heading_y,
+               const double* speed, const double* angular_velocity,
+               double* direction, double* step_x, double* step_y,
+               std::size_t n, double dt)
+{
+    const __m128d t = _mm_set1_pd(dt);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d s = _mm_loadu_pd(speed + i);
+        _mm_storeu_pd(step_x + i,
+                _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(heading_x + i), s), t));
+        _mm_storeu_pd(step_y + i,
+                _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(heading_y + i), s), t));
+        _mm_storeu_pd(direction + i, _mm_add_pd(_mm_loadu_pd(direction + i),
+                _mm_mul_pd(_mm_loadu_pd(angular_velocity + i), t)));
+    }
+    integrate_scalar(heading_x + i, heading_y + i, speed + i,
+            angular_velocity + i, direction + i, step_x + i, step_y + i,
+            n - i, dt);
+}
+
+__attribute__((target("avx2"))) inline void
+integrate_avx2(const double* heading_x, const double* heading_y,
+               const double* speed, const double* angular_velocity,
+               double* direction, double* step_x, double* step_y,
+               std::size_t n, double dt)
+{
+    const __m256d t = _mm256_set1_pd(dt);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_loadu_pd(speed + i);
+        _mm256_storeu_pd(step_x + i, _mm256_mul_pd(
+                    _mm256_mul_pd(_mm256_loadu_pd(heading_x + i), s), t));
+        _mm256_storeu_pd(step_y + i, _mm256_mul_pd(
+                    _mm256_mul_pd(_mm256_loadu_pd(heading_y + i), s), t));
+        _mm256_storeu_pd(direction + i, _mm256_add_pd(
+                    _mm256_loadu_pd(direction + i),
+                    _mm256_mul_pd(_mm256_loadu_pd(angular_velocity + i), t)));
+    }
+    integrate_scalar(heading_x + i, heading_y + i, speed + i,
+            angular_velocity + i, direction + i, step_x + i, step_y + i,
+            n - i, dt);
+}
+
+#endif
+
+/** Every kernel this processor can run, narrowest first. */
+inline std::vector<integrate_kernel>
+available_integrate_kernels()
+{
+    std::vector<integrate_kernel> out;
+    out.push_back(integrate_kernel{"scalar", &integrate_scalar});
+#ifdef HEXIT_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        out.push_back(integrate_kernel{"sse2", &integrate_sse2});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        out.push_back(integrate_kernel{"avx2", &integrate_avx2});
+    }
+#endif
+    return out;
+}
+
+/** The widest kernel this processor can run; checked once. */
+inline integrate_kernel
+best_integrate_kernel()
+{
+    static const integrate_kernel best = available_integrate_kernels().back();
+    return best;
+}
+
+/** The kernel with the given name; run is null if it is not available. */
+inline integrate_kernel
+find_integrate_kernel(const char* name)
+{
+    for (const auto& k : available_integrate_kernels()) {
+        if (std::strcmp(k.name, name) == 0) { return k; }
+    }
+    return integrate_kernel{name, nullptr};
+}
+
+} // end namespace kernels
+} /*end namespace*/
+
+#endif
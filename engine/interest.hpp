@@ -0,0 +1,289 @@
+#ifndef INTEREST_HPP_HEADER
+#define INTEREST_HPP_HEADER
+
+/**
+ * @file interest.hpp
+ * Which actors each observer gets to know about.
+ *
+ * An observer is an actor, usually the one a client controls. It is
+ * interested in every actor whose cell it can see (maps::Maze::isVisible,
+ * a bit test if the maze has its visible sets) within radius cells, and
+ * in every actor within near cells whether it can see it or not.
+ * Everything is decided per cell, so the interest sets only change when
+ * an actor crosses a cell boundary.
+ *
+ * The manager keeps actors bucketed by cell and, for every cell, the
+ * observers that see it. An actor changing cells is then taken out of the
+ * sets of the old cell's observers and put into the new cell's. Only an
+ * observer that changes cells itself has its visible cells and its set
+ * worked out again.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "engine.hpp"
+#include "../maps/maze.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace engine {
+
+struct interest_params {
+    double radius; // in cells, between cell centres
+    double near;   // seen through walls up to this distance
+
+    interest_params(double radius = 12, double near = 1.5)
+        : radius(radius)
+        , near(near)
+    {}
+};
+
+class interest_manager {
+    static const std::uint32_t no_cell =
+        std::numeric_limits<std::uint32_t>::max();
+    static const std::uint32_t no_slot =
+        std::numeric_limits<std::uint32_t>::max();
+
+    struct tracked {
+        actor_handle handle;
+        std::uint32_t cell;
+        std::uint64_t seen; // update() that last saw the actor
+    };
+
+    struct observer {
+        actor_handle handle;
+        std::uint32_t cell;
+        std::vector<std::uint32_t> cells;   // the cells it sees
+        std::vector<actor_handle> interest; // sorted
+    };
+
+    struct move {
+        actor_handle handle;
+        std::uint32_t from;
+        std::uint32_t to;
+    };
+
+    std::shared_ptr<const maps::Maze> maze;
+    interest_params params;
+    std::uint64_t updates;
+
+    std::vector<tracked> actors; // by handle index
+    std::vector<std::vector<actor_handle>> buckets; // actors by cell
+    std::vector<std::vector<std::uint32_t>> watchers; // observers by cell
+    std::vector<std::unique_ptr<observer>> observers; // null where removed
+    std::vector<std::uint32_t> observer_slot; // by handle index, no_slot if none
+    std::vector<move> moves;
+
+    public:
+    interest_manager(std::shared_ptr<const maps::Maze> maze,
+                     interest_params params = interest_params())
+        : maze(maze)
+        , params(params)
+        , updates(0)
+        , actors()
+        , buckets(maze->getWidth() * maze->getHeight())
+        , watchers(maze->getWidth() * maze->getHeight())
+        , observers()
+        , observer_slot()
+        , moves()
+    {}
+
+    interest_manager(const interest_manager&) = delete;
+    interest_manager& operator=(const interest_manager&) = delete;
+
+    /** Starts tracking what the actor sees; it is filled in by update(). */
+    void addObserver(actor_handle h) {
+        assert(!isObserver(h));
+        std::size_t slot = 0;
+        while (slot < observers.size() && observers[slot]) { ++slot; }
+        if (slot == observers.size()) { observers.push_back(nullptr); }
+        observers[slot].reset(new observer{h, no_cell, {}, {}});
+        if (h.index >= observer_slot.size()) {
+            observer_slot.resize(h.index + 1, std::uint32_t(no_slot));
+        }
+        observer_slot[h.index] = static_cast<std::uint32_t>(slot);
+    }
+
+    void removeObserver(actor_handle h) {
+        std::size_t slot = find_observer(h);
+        assert(slot != observers.size());
+        unwatch(static_cast<std::uint32_t>(slot));
+        observers[slot].reset();
+        observer_slot[h.index] = no_slot;
+    }
+
+    bool isObserver(actor_handle h) const {
+        return find_observer(h) != observers.size();
+    }
+
+    /** The actors the observer is interested in, sorted by handle. */
+    const std::vector<actor_handle>& interestOf(actor_handle h) const {
+        std::size_t slot = find_observer(h);
+        assert(slot != observers.size());
+        return observers[slot]->interest;
+    }
+
+    /** Whether an observer in cell a is interested in actors in cell b. */
+    bool sees(std::size_t ax, std::size_t ay,
+              std::size_t bx, std::size_t by) const {
+        const double dx = double(bx) - double(ax), dy = double(by) - double(ay);
+        const double d2 = dx*dx + dy*dy;
+        if (d2 > params.radius * params.radius) { return false; }
+        return d2 <= params.near * params.near ||
+            maze->isVisible(ax, ay, bx, by);
+    }
+
+    /**
+     * Brings every interest set up to date with the given poses, which
+     * have to be all the actors there are (engine::captureSnapshot).
+     */
+    void update(const std::vector<actor_snapshot>& poses) {
+        ++updates;
+        moves.clear();
+
+        for (const auto& p : poses) {
+            if (p.handle.index >= actors.size()) {
+                actors.resize(p.handle.index + 1,
+                        tracked{actor_handle(), no_cell, 0});
+            }
+            tracked& t = actors[p.handle.index];
+            const std::uint32_t cell = cell_of(p.x, p.y);
+            if (t.handle != p.handle) {
+                if (t.handle.valid()) {
+                    // the slot was reused since the last update
+                    moves.push_back(move{t.handle, t.cell, no_cell});
+                    take_out(t.handle, t.cell);
+                }
+                t.handle = p.handle;
+                t.cell = no_cell;
+            }
+            t.seen = updates;
+            if (cell != t.cell) {
+                moves.push_back(move{p.handle, t.cell, cell});
+                take_out(p.handle, t.cell);
+                put_in(p.handle, cell);
+                t.cell = cell;
+            }
+        }
+        for (auto& t : actors) {
+            if (t.handle.valid() && t.seen != updates) {
+                moves.push_back(move{t.handle, t.cell, no_cell});
+                take_out(t.handle, t.cell);
+                t.handle = actor_handle();
+                t.cell = no_cell;
+            }
+        }
+
+        // observers that changed cells start over from the buckets, which
+        // already include this update's moves
+        std::vector<bool> fresh(observers.size(), false);
+        for (std::uint32_t o = 0; o < observers.size(); ++o) {
+            if (!observers[o]) { continue; }
+            const actor_handle h = observers[o]->handle;
+            std::uint32_t cell = h.index < actors.size()
+                && actors[h.index].handle == h ? actors[h.index].cell : no_cell;
+            if (cell != observers[o]->cell) {
+                rewatch(o, cell);
+                fresh[o] = true;
+            }
+        }
+
+        for (const auto& m : moves) {
+            if (m.from != no_cell) {
+                for (auto o : watchers[m.from]) {
+                    if (!fresh[o]) { erase(observers[o]->interest, m.handle); }
+                }
+            }
+            if (m.to != no_cell) {
+                for (auto o : watchers[m.to]) {
+                    if (!fresh[o]) { insert(observers[o]->interest, m.handle); }
+                }
+            }
+        }
+    }
+
+    private:
+    std::size_t find_observer(actor_handle h) const {
+        if (h.index < observer_slot.size() && observer_slot[h.index] != no_slot &&
+                observers[observer_slot[h.index]]->handle == h) {
+            return observer_slot[h.index];
+        }
+        return observers.size();
+    }
+
+    std::uint32_t cell_of(double x, double y) const {
+        if (!(x >= 0 && y >= 0 && x < maze->getWidth() && y < maze->getHeight())) {
+            return no_cell; // off the maze, nobody sees it
+        }
+        return static_cast<std::uint32_t>(
+                static_cast<std::size_t>(x) * maze->getHeight()
+                + static_cast<std::size_t>(y));
+    }
+
+    static void insert(std::vector<actor_handle>& v, actor_handle h) {
+        auto it = std::lower_bound(v.begin(), v.end(), h);
+        if (it == v.end() || *it != h) { v.insert(it, h); }
+    }
+
+    static void erase(std::vector<actor_handle>& v, actor_handle h) {
+        auto it = std::lower_bound(v.begin(), v.end(), h);
+        if (it != v.end() && *it == h) { v.erase(it); }
+    }
+
+    void put_in(actor_handle h, std::uint32_t cell) {
+        if (cell != no_cell) { buckets[cell].push_back(h); }
+    }
+
+    void take_out(actor_handle h, std::uint32_t cell) {
+        if (cell == no_cell) { return; }
+        auto& b = buckets[cell];
+        auto it = std::find(b.begin(), b.end(), h);
+        assert(it != b.end());
+        *it = b.back();
+        b.pop_back();
+    }
+
+    void unwatch(std::uint32_t o) {
+        for (auto c : observers[o]->cells) {
+            auto& w = watchers[c];
+            w.erase(std::find(w.begin(), w.end(), o));
+        }
+        observers[o]->cells.clear();
+        observers[o]->interest.clear();
+    }
+
+    /** Works out what the observer sees from its new cell. */
+    void rewatch(std::uint32_t o, std::uint32_t cell) {
+        unwatch(o);
+        observer& obs = *observers[o];
+        obs.cell = cell;
+        if (cell == no_cell) { return; }
+
+        const long h = static_cast<long>(maze->getHeight());
+        const long w = static_cast<long>(maze->getWidth());
+        const long cx = cell / h, cy = cell % h;
+        const long r = static_cast<long>(std::floor(params.radius));
+        for (long x = std::max(0L, cx - r); x <= std::min(w - 1, cx + r); ++x) {
+            for (long y = std::max(0L, cy - r); y <= std::min(h - 1, cy + r); ++y) {
+                if (!sees(cx, cy, x, y)) { continue; }
+                const std::uint32_t c = static_cast<std::uint32_t>(x * h + y);
+                obs.cells.push_back(c);
+                watchers[c].push_back(o);
+                obs.interest.insert(obs.interest.end(),
+                        buckets[c].begin(), buckets[c].end());
+            }
+        }
+        std::sort(obs.interest.begin(), obs.interest.end());
+    }
+};
+
+} /*end namespace*/
+
+#endif
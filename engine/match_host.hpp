@@ -0,0 +1,300 @@
+#ifndef MATCH_HOST_HPP_HEADER
+#define MATCH_HOST_HPP_HEADER
+
+/**
+ * @file match_host.hpp
+ * Runs many independent matches in one process.
+ *
+ * Every match is an engine of its own with its own tick rate. The host
+ * keeps the time each match's next tick is due in a scheduler and hands
+ * due ticks to a work-stealing pool as tasks, so a few threads keep
+ * thousands of matches going. A match never has more than one tick in
+ * flight. Matches on the same map share a single maze through a
+ * maps::maze_cache.
+ *
+ * A tick's latency is the time from when it was due to when it was done.
+ * A tick misses its deadline if it is not done by the time the next one
+ * is due. A match that falls more than max_lag ticks behind skips ticks
+ * instead of trying to catch up, the same way fixed_step_driver does.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "engine.hpp"
+#include "scheduler.hpp"
+#include "../maps/maze_cache.hpp"
+#include "../misc/thread_pool.hpp"
+#include "../misc/work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+
+/** Tick latencies in microseconds, and what went wrong. */
+struct latency_report {
+    std::size_t ticks;
+    std::size_t missed;  // finished after the next tick was due
+    std::size_t dropped; // skipped to catch up with the clock
+    double p50;
+    double p99;
+    double p999;
+    double max;
+};
+
+class match_host {
+    typedef std::chrono::steady_clock clock;
+
+    // actions a match can have waiting for its next tick; a match is a
+    // handful of players, and thousands of engines at the default
+    // capacity would hold gigabytes of empty queue
+    static const std::size_t inbox_capacity = 512;
+
+    struct match {
+        std::unique_ptr<engine> e;
+        match_host* host;
+        std::size_t id;
+        std::size_t batch;  // ticks to run per task
+        double due;         // host time the next tick is due
+        double finished;    // host time the last task was done
+        bool in_flight;
+    };
+
+    std::size_t max_lag;
+    clock::time_point epoch;
+    maps::maze_cache mazes;
+    // engines tick on a pool worker each, so they get no threads of their own
+    std::shared_ptr<utility::thread_pool> serial;
+    std::vector<std::unique_ptr<match>> matches; // null where removed
+    std::size_t live;
+    event_scheduler<std::size_t> due;
+
+    std::mutex done_mutex;
+    std::condition_variable done_signal;
+    std::vector<std::size_t> done;
+
+    std::vector<double> latencies;
+    std::size_t missed;
+    std::size_t dropped;
+
+    utility::work_stealing_pool pool; // last, so it stops first
+
+    public:
+    /**
+     * threads = 0 runs one worker per hardware thread; pin_threads pins
+     * the workers to cores.
+     */
+    explicit match_host(std::size_t threads = 0, bool pin_threads = false,
+                        std::size_t max_lag = 5)
+        : max_lag(max_lag)
+        , epoch(clock::now())
+        , mazes()
+        , serial(std::make_shared<utility::thread_pool>(1))
+        , matches()
+        , live(0)
+        , due()
+        , done_mutex()
+        , done_signal()
+        , done()
+        , latencies()
+        , missed(0)
+        , dropped(0)
+        , pool(threads, pin_threads)
+    {}
+
+    match_host(const match_host&) = delete;
+    match_host& operator=(const match_host&) = delete;
+
+    /**
+     * Starts a match on the given map, ticking every dt seconds, and
+     * returns its id. Ids of removed matches are reused.
+     */
+    std::size_t addMatch(std::size_t width, std::size_t height,
+                         double difficulty, unsigned int seed,
+                         double dt = 1./100) {
+        std::size_t id = 0;
+        while (id < matches.size() && matches[id]) { ++id; }
+        if (id == matches.size()) { matches.push_back(nullptr); }
+
+        std::unique_ptr<engine> e(new engine(
+                    mazes.get(width, height, difficulty, seed), serial,
+                    inbox_capacity));
+        e->setTimeStep(dt);
+        matches[id].reset(new match{std::move(e), this, id, 1, 0, 0, false});
+        ++live;
+        return id;
+    }
+
+    void removeMatch(std::size_t id) {
+        assert(hasMatch(id) && !matches[id]->in_flight);
+        matches[id].reset();
+        --live;
+    }
+
+    bool hasMatch(std::size_t id) const {
+        return id < matches.size() && matches[id];
+    }
+
+    /** Only touch a match's engine between run() and runTicks() calls. */
+    engine& getMatch(std::size_t id) {
+        assert(hasMatch(id));
+        return *matches[id]->e;
+    }
+
+    std::size_t getMatchCount() const { return live; }
+    std::size_t getThreadCount() const { return pool.size(); }
+    bool isPinned() const { return pool.isPinned(); }
+    maps::maze_cache& getMazeCache() { return mazes; }
+
+    /**
+     * Runs every match at its tick rate for the given number of wall-clock
+     * seconds, then waits for the ticks still in flight. The matches'
+     * first ticks are due within the first tick period.
+     */
+    void run(double seconds) {
+        const double start = now();
+        const double end = start + seconds;
+        due.clear();
+        // spread the first ticks over a tick period, so the matches do not
+        // all come due at the same moment every tick
+        std::size_t k = 0;
+        for (auto& m : matches) {
+            if (!m) { continue; }
+            m->batch = 1;
+            m->due = start + m->e->getTimeStep() * k++ / live;
+            due.schedule(m->due, m->id);
+        }
+
+        auto submit = [this](double, std::size_t id) {
+            match& m = *matches[id];
+            m.in_flight = true;
+            pool.submit(&match_host::tick, &m);
+        };
+        std::vector<std::size_t> finished;
+        for (;;) {
+            collect(finished);
+            double t = now();
+            for (auto id : finished) {
+                match& m = *matches[id];
+                record(m);
+                m.due += m.e->getTimeStep();
+                if (m.due < t - max_lag * m.e->getTimeStep()) {
+                    // too far behind; give up the time instead of catching up
+                    dropped += static_cast<std::size_t>(
+                            (t - m.due) / m.e->getTimeStep());
+                    m.due = t;
+                }
+                due.schedule(m.due, id);
+            }
+            if (t >= end) { break; }
+            due.fire_until(t, submit);
+
+            double wake = due.empty() ? end : std::min(end, due.next_time());
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done_signal.wait_until(lock, at(wake),
+                    [this]{ return !done.empty(); });
+        }
+
+        pool.wait_idle();
+        collect(finished);
+        for (auto id : finished) {
+            record(*matches[id]);
+        }
+        due.clear();
+    }
+
+    /**
+     * Runs n ticks of every match as fast as the workers go, without
+     * deadlines and without recording latencies.
+     */
+    void runTicks(std::size_t n) {
+        for (auto& m : matches) {
+            if (!m) { continue; }
+            m->batch = n;
+            m->in_flight = true;
+            pool.submit(&match_host::tick, m.get());
+        }
+        pool.wait_idle();
+        std::vector<std::size_t> finished;
+        collect(finished);
+    }
+
+    /** Latencies of the ticks run by run() since the last reset. */
+    latency_report latencyReport(bool reset = true) {
+        latency_report r{latencies.size(), missed, dropped, 0, 0, 0, 0};
+        if (!latencies.empty()) {
+            r.p50  = percentile(0.5);
+            r.p99  = percentile(0.99);
+            r.p999 = percentile(0.999);
+            r.max  = *std::max_element(latencies.begin(), latencies.end());
+        }
+        if (reset) {
+            latencies.clear();
+            missed = 0;
+            dropped = 0;
+        }
+        return r;
+    }
+
+    private:
+    double now() const {
+        return std::chrono::duration<double>(clock::now() - epoch).count();
+    }
+
+    clock::time_point at(double t) const {
+        return epoch + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(t));
+    }
+
+    static void tick(void* ctx) {
+        match& m = *static_cast<match*>(ctx);
+        for (std::size_t i = 0; i < m.batch; ++i) {
+            m.e->simulate();
+        }
+        m.finished = m.host->now();
+
+        match_host& host = *m.host;
+        {
+            std::lock_guard<std::mutex> lock(host.done_mutex);
+            host.done.push_back(m.id);
+        }
+        host.done_signal.notify_one();
+    }
+
+    void collect(std::vector<std::size_t>& out) {
+        out.clear();
+        std::lock_guard<std::mutex> lock(done_mutex);
+        out.swap(done);
+        for (auto id : out) {
+            matches[id]->in_flight = false;
+        }
+    }
+
+    void record(const match& m) {
+        double late = m.finished - m.due;
+        latencies.push_back(late * 1e6);
+        if (late > m.e->getTimeStep()) {
+            ++missed;
+        }
+    }
+
+    double percentile(double q) {
+        std::size_t k = std::min(latencies.size() - 1,
+                static_cast<std::size_t>(q * latencies.size()));
+        std::nth_element(latencies.begin(), latencies.begin() + k,
+                latencies.end());
+        return latencies[k];
+    }
+};
+
+} /*end namespace*/
+
+#endif
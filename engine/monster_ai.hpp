@@ -0,0 +1,422 @@
+#ifndef MONSTER_AI_HPP_HEADER
+#define MONSTER_AI_HPP_HEADER
+
+/**
+ * @file monster_ai.hpp
+ * Brings the maze's monsters to life.
+ *
+ * spawnMonsters() turns every monster the maze placed into an actor. The
+ * ones next to a treasure guard it, the others patrol around where they
+ * started. A monster that sees a player (maps::Maze::isVisible) within
+ * sight cells chases it along the player's shared flow field and attacks
+ * once close enough. A guard gives up once it has been lured leash cells
+ * from its post, a patroller once the player is out of sight and far.
+ *
+ * Monsters steer through the engine's ordinary actions, always stamped
+ * with the current time, so a monster that changes its mind never has an
+ * old plan still queued up. A turn starts rotating and a walk starts going
+ * forward, and the monster decides again when the angle should be covered
+ * or the point reached. Between decisions it needs no attention at all.
+ *
+ * How often a monster decides depends on how far the nearest player is:
+ * every tick up close, every mid_interval ticks further out and every
+ * far_interval ticks beyond that, or sooner when a turn or a walk is done
+ * by then. The decisions are kept in an event_scheduler by due tick,
+ * spread over the interval from the start, and at most budget of them are
+ * made per tick. That alone does not bound the time they take: a chase
+ * can rebuild its player's flow field and a patrol or a return runs an A*,
+ * either of which may cover the whole maze. So the pathfinder counts the
+ * cells its searches visit, and no decision is started once this tick's
+ * have visited search_budget cells; the one that crosses the line is
+ * still finished, so a tick goes over by at most one search. Decisions
+ * over either budget wait for the next tick, first in line. Everything is
+ * decided from engine state and a seeded generator, so a match replays
+ * the same.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "engine.hpp"
+#include "scheduler.hpp"
+#include "../maps/pathfinding.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+struct ai_params {
+    double sight;          // cells within which a visible player is chased
+    double leash;          // cells from its post a guard chases to
+    double attack_range;   // distance a monster attacks from
+    double near_distance;  // decides every tick within this of a player
+    double mid_distance;   // every mid_interval ticks within this
+    std::uint64_t mid_interval;
+    std::uint64_t far_interval; // and every far_interval ticks beyond
+    std::size_t budget;    // decisions per tick
+    std::size_t search_budget; // cells path searches visit per tick
+    unsigned patrol_steps; // how far a patroller strays, in random steps
+    actor_properties monster; // for value 0; the maze's value scales it
+
+    ai_params()
+        : sight(10)
+        , leash(12)
+        , attack_range(0.8)
+        , near_distance(12)
+        , mid_distance(32)
+        , mid_interval(4)
+        , far_interval(16)
+        , budget(64)
+        , search_budget(1 << 16)
+        , patrol_steps(12)
+        , monster{1.5, TAU/2, 5, 0.5, 30}
+    {}
+};
+
+enum class monster_state {
+    PATROL,
+    GUARD,
+    CHASE,
+    RETURN
+};
+
+/** Decisions made so far, and how many had to wait for a later tick. */
+struct ai_stats {
+    std::uint64_t decisions;
+    std::uint64_t deferred;
+    std::size_t busiest; // most decisions in one tick
+    std::uint64_t searched; // cells visited by their path searches
+};
+
+class monster_ai {
+    struct monster {
+        actor_handle handle;
+        monster_state state;
+        bool guard;
+        maps::cell post;  // where it spawned
+        actor_handle target;
+        std::vector<maps::cell> route; // for patrolling and returning
+        std::size_t next; // position in route
+        std::uint64_t due; // tick of the next decision
+        std::uint64_t until; // tick its turn or walk is done by, 0 if none
+    };
+
+    struct player {
+        actor_handle handle;
+        double x, y;
+    };
+
+    engine& e;
+    std::shared_ptr<const maps::Maze> maze;
+    ai_params params;
+    maps::pathfinder paths;
+    std::mt19937 rng;
+
+    std::vector<monster> monsters;
+    std::vector<actor_handle> player_handles;
+    std::vector<player> players; // this tick's poses
+    event_scheduler<std::size_t> decisions; // monster index by due tick
+    ai_stats stats;
+
+    public:
+    monster_ai(engine& e, ai_params params = ai_params(), unsigned seed = 1)
+        : e(e)
+        , maze(e.getMaze())
+        , params(params)
+        , paths(e.getMaze())
+        , rng(seed)
+        , monsters()
+        , player_handles()
+        , players()
+        , decisions()
+        , stats{0, 0, 0, 0}
+    {}
+
+    monster_ai(const monster_ai&) = delete;
+    monster_ai& operator=(const monster_ai&) = delete;
+
+    /**
+     * Adds an actor for every monster the maze placed and returns how
+     * many. Stronger monsters (higher value) have more health and hit
+     * harder.
+     */
+    std::size_t spawnMonsters() {
+        const auto& objects = maze->getMonsters();
+        for (std::size_t i = 0; i < objects.size(); ++i) {
+            const maps::Object& o = objects[i];
+            const double scale = 1 + o.value;
+            actor_properties p = params.monster;
+            p.attack_damage *= scale;
+            p.health *= scale;
+
+            actor a("monster-" + std::to_string(i),
+                    osg::Vec2d(o.position.first + 0.5, o.position.second + 0.5),
+                    0, p.health, p);
+            a.speed = 0;
+            bool guard = false;
+            for (const auto& t : maze->getTreasure()) {
+                if (std::labs(long(t.position.first) - long(o.position.first)) +
+                    std::labs(long(t.position.second) - long(o.position.second)) <= 1) {
+                    guard = true;
+                }
+            }
+            monsters.push_back(monster{e.addActor(a),
+                    guard ? monster_state::GUARD : monster_state::PATROL,
+                    guard, o.position, actor_handle(), {}, 0, 0, 0});
+        }
+        // spread the first decisions, so they do not all come at once
+        for (std::size_t i = 0; i < monsters.size(); ++i) {
+            monsters[i].due = e.getTick() + i % params.far_interval;
+            decisions.schedule(double(monsters[i].due), i);
+        }
+        return objects.size();
+    }
+
+    /** Monsters chase players, and only players. */
+    void addPlayer(actor_handle h) {
+        player_handles.push_back(h);
+    }
+
+    void removePlayer(actor_handle h) {
+        player_handles.erase(std::remove(player_handles.begin(),
+                    player_handles.end(), h), player_handles.end());
+        paths.forget(h.index);
+    }
+
+    std::size_t getMonsterCount() const { return monsters.size(); }
+    actor_handle getMonster(std::size_t i) const { return monsters[i].handle; }
+    monster_state getState(std::size_t i) const { return monsters[i].state; }
+
+    const ai_stats& getStats() const { return stats; }
+    maps::pathfinder& getPathfinder() { return paths; }
+
+    /**
+     * Makes this tick's decisions; call it once before every
+     * engine::simulate().
+     */
+    void think() {
+        players.clear();
+        for (auto h : player_handles) {
+            if (!e.hasActor(h)) { continue; }
+            actor a = e.getActor(h);
+            if (a.health > 0) {
+                players.push_back(player{h, a.position.x(), a.position.y()});
+            }
+        }
+
+        const std::uint64_t tick = e.getTick();
+        auto decide = [this, tick](double, std::size_t i) {
+            monster& m = monsters[i];
+            if (m.due < tick) { ++stats.deferred; }
+            if (!e.hasActor(m.handle)) { return; } // gone for good
+            ++stats.decisions;
+            m.until = 0;
+            m.due = tick + interval(think_about(m));
+            if (m.until != 0 && m.until < m.due) { m.due = m.until; }
+            decisions.schedule(double(m.due), i);
+        };
+        const std::uint64_t searched = paths.getSearched();
+        std::size_t made = 0;
+        while (made < params.budget &&
+                paths.getSearched() - searched < params.search_budget &&
+                decisions.fire_until(double(tick), decide, 1) == 1) {
+            ++made;
+        }
+        stats.busiest = std::max(stats.busiest, made);
+        stats.searched += paths.getSearched() - searched;
+    }
+
+    private:
+    std::uint64_t interval(double distance) const {
+        if (distance <= params.near_distance) { return 1; }
+        if (distance <= params.mid_distance) { return params.mid_interval; }
+        return params.far_interval;
+    }
+
+    static maps::cell cell_of(double x, double y) {
+        return maps::cell(static_cast<std::size_t>(x),
+                          static_cast<std::size_t>(y));
+    }
+
+    static double cells_apart(maps::cell a, maps::cell b) {
+        const double dx = double(a.first) - double(b.first);
+        const double dy = double(a.second) - double(b.second);
+        return std::sqrt(dx*dx + dy*dy);
+    }
+
+    /** Decides what the monster does next; returns its nearest player. */
+    double think_about(monster& m) {
+        actor a = e.getActor(m.handle);
+        if (a.health <= 0) {
+            halt(m, a);
+            return std::numeric_limits<double>::infinity();
+        }
+        const maps::cell here = cell_of(a.position.x(), a.position.y());
+
+        const player* seen = nullptr;
+        double nearest_d = std::numeric_limits<double>::infinity();
+        double seen_d = nearest_d;
+        for (const auto& p : players) {
+            const double d = (osg::Vec2d(p.x, p.y) - a.position).length();
+            nearest_d = std::min(nearest_d, d);
+            const maps::cell there = cell_of(p.x, p.y);
+            if (d < seen_d && d <= params.sight &&
+                    maze->isVisible(here.first, here.second,
+                                    there.first, there.second)) {
+                seen_d = d;
+                seen = &p;
+            }
+        }
+
+        const player* target = nullptr;
+        for (const auto& p : players) {
+            if (p.handle == m.target) { target = &p; }
+        }
+        if (m.state == monster_state::CHASE) {
+            const bool lost = !target ||
+                (m.guard && cells_apart(here, m.post) > params.leash) ||
+                (!m.guard && target != seen &&
+                    (osg::Vec2d(target->x, target->y) - a.position).length()
+                        > 1.5 * params.sight);
+            if (lost) {
+                m.target = actor_handle();
+                m.route = paths.path(here, m.post);
+                m.next = 0;
+                m.state = m.guard ? monster_state::RETURN : monster_state::PATROL;
+                target = nullptr;
+            }
+        } else if (seen && (!m.guard ||
+                    cells_apart(here, m.post) <= params.leash)) {
+            m.state = monster_state::CHASE;
+            m.target = seen->handle;
+            target = seen;
+        }
+
+        switch (m.state) {
+            case monster_state::CHASE:
+                chase(m, a, here, *target);
+                break;
+            case monster_state::GUARD:
+                halt(m, a);
+                break;
+            case monster_state::RETURN:
+                if (here == m.post || !follow_route(m, a, here)) {
+                    m.state = monster_state::GUARD;
+                    halt(m, a);
+                }
+                break;
+            case monster_state::PATROL:
+                if (!follow_route(m, a, here)) {
+                    plan_patrol(m, here);
+                    if (!follow_route(m, a, here)) { halt(m, a); }
+                }
+                break;
+        }
+        return nearest_d;
+    }
+
+    void chase(monster& m, const actor& a, maps::cell here, const player& p) {
+        const osg::Vec2d to(p.x, p.y);
+        if ((to - a.position).length() <= params.attack_range) {
+            halt(m, a);
+            if (!a.attack.target.valid()) {
+                e.submitAction(m.handle, Attack{e.getCurrentTime(), p.handle});
+            }
+            return;
+        }
+        auto field = paths.follow(p.handle.index, cell_of(p.x, p.y));
+        maps::cell step = field->next(here.first, here.second);
+        if (step == here) {
+            // same cell, or no way there; go straight for it
+            steer(m, a, to);
+        } else {
+            steer(m, a, osg::Vec2d(step.first + 0.5, step.second + 0.5));
+        }
+    }
+
+    /** Heads for the next cell on the route; false once it is walked. */
+    bool follow_route(monster& m, const actor& a, maps::cell here) {
+        while (m.next < m.route.size() && m.route[m.next] == here) {
+            ++m.next;
+        }
+        if (m.next >= m.route.size()) { return false; }
+        const maps::cell c = m.route[m.next];
+        steer(m, a, osg::Vec2d(c.first + 0.5, c.second + 0.5));
+        return true;
+    }
+
+    /** Picks a spot a few random steps from the post and a way there. */
+    void plan_patrol(monster& m, maps::cell here) {
+        maps::cell goal = m.post;
+        static const long dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (unsigned i = 0; i < params.patrol_steps; ++i) {
+            const long* d = dirs[rng() % 4];
+            const long x = long(goal.first) + d[0], y = long(goal.second) + d[1];
+            if (maps::is_open_cell(*maze, x, y)) { goal = maps::cell(x, y); }
+        }
+        m.route = paths.path(here, goal);
+        m.next = 0;
+    }
+
+    void halt(monster& m, const actor& a) {
+        const double now = e.getCurrentTime();
+        if (a.speed != 0) { e.submitAction(m.handle, StopGoForwardAction{now}); }
+        if (a.angular_velocity != 0) {
+            e.submitAction(m.handle, StopRotateLeftAction{now});
+        }
+    }
+
+    /**
+     * Heads for the point: turns on the spot if it is well off to the
+     * side, otherwise walks. The monster decides again once the turn is
+     * through or the point reached, and stops or goes on from there.
+     */
+    void steer(monster& m, const actor& a, osg::Vec2d to) {
+        const double now = e.getCurrentTime();
+        const osg::Vec2d d = to - a.position;
+        const double distance = d.length();
+        if (distance < 0.05) { halt(m, a); return; }
+
+        double turn = std::atan2(d.y(), d.x()) - a.direction;
+        turn = std::remainder(turn, TAU);
+        if (std::fabs(turn) > 0.2) {
+            const double omega = a.limits.angular_velocity;
+            if (a.speed != 0) { e.submitAction(m.handle, StopGoForwardAction{now}); }
+            if (turn > 0 && a.angular_velocity != omega) {
+                e.submitAction(m.handle, StartRotateLeftAction{now});
+            } else if (turn < 0 && a.angular_velocity != -omega) {
+                e.submitAction(m.handle, StartRotateRightAction{now});
+            }
+            wake(m, std::fabs(turn) / omega);
+            return;
+        }
+        if (a.angular_velocity != 0) {
+            e.submitAction(m.handle, StopRotateLeftAction{now});
+        }
+        if (a.speed != a.limits.speed) {
+            e.submitAction(m.handle, StartGoForwardAction{now});
+        }
+        wake(m, distance / a.limits.speed);
+    }
+
+    /** Has the monster decide again once seconds have gone by. */
+    void wake(monster& m, double seconds) {
+        const double ticks = std::ceil(seconds / e.getTimeStep());
+        m.until = e.getTick() + std::max<std::uint64_t>(1,
+                static_cast<std::uint64_t>(ticks));
+    }
+};
+
+} /*end namespace*/
+
+#endif
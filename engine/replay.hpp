@@ -0,0 +1,332 @@
+#ifndef REPLAY_HPP_HEADER
+#define REPLAY_HPP_HEADER
+
+/**
+ * @file replay.hpp
+ * Recording matches as action logs and replaying them headless.
+ *
+ * The engine is deterministic, so a match is fully described by its maze
+ * (size, difficulty, seed and generator), its tick length and everything
+ * that was done to it from the outside: actors added and removed and
+ * actions applied, each labelled with the tick it happened before. The
+ * recorder can also write the engine's state hash every N ticks, and the
+ * replay checks those to find out where a replay diverges.
+ *
+ * Log layout: a header, then records that each start with a tag byte and
+ * the tick delta since the previous record, as varints.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "binary_io.hpp"
+#include "engine.hpp"
+#include "exceptions.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+namespace engine {
+
+namespace replay_format {
+    static const char magic[4] = {'H', 'X', 'R', 'L'};
+    static const std::uint64_t version = 2;
+
+    enum tag : unsigned char {
+        SPAWN  = 1,
+        REMOVE = 2,
+        ACTION = 3,
+        HASH   = 4,
+        END    = 5
+    };
+
+    // set in the action type byte for actions that came through the queue
+    static const unsigned char queued_flag = 0x80;
+
+    // the most ticks between two records, some 46 hours at 100 ticks a
+    // second; a longer gap is taken for a damaged log
+    static const std::uint64_t max_gap = std::uint64_t(1) << 24;
+
+    inline void
+    write_handle(byte_writer& w, actor_handle h) {
+        w.varint(h.index);
+        w.varint(h.generation);
+    }
+
+    inline actor_handle
+    read_handle(byte_reader& r) {
+        std::uint32_t index = static_cast<std::uint32_t>(r.varint());
+        return actor_handle(index, static_cast<std::uint32_t>(r.varint()));
+    }
+} // end namespace replay_format
+
+/**
+ * Records an engine into a log from the moment it is constructed until
+ * finish() (or destruction). It has to be attached to a fresh engine, and
+ * the engine's time step must not change while recording.
+ */
+class action_recorder : public engine_listener {
+    engine& e;
+    std::ostream& out;
+    std::uint64_t hash_every;
+    std::uint64_t last_tick;
+    std::vector<unsigned char> buffer;
+    bool finished;
+
+    static const std::size_t flush_size = 1 << 16;
+
+    public:
+    /** hash_every = 0 records no state hashes. */
+    action_recorder(engine& e, std::ostream& out, std::uint64_t hash_every = 0)
+        : e(e)
+        , out(out)
+        , hash_every(hash_every)
+        , last_tick(0)
+        , buffer()
+        , finished(false)
+    {
+        assert(e.getTick() == 0 && e.getActorCount() == 0);
+        auto maze = e.getMaze();
+        byte_writer w(buffer);
+        w.bytes(replay_format::magic, sizeof(replay_format::magic));
+        w.varint(replay_format::version);
+        w.varint(maze->getWidth());
+        w.varint(maze->getHeight());
+        w.f64(maze->getDifficulty());
+        w.varint(maze->getSeed());
+        w.string(maze->getGenerator());
+        w.f64(e.getTimeStep());
+        w.varint(hash_every);
+        e.setListener(this);
+    }
+
+    action_recorder(const action_recorder&) = delete;
+    action_recorder& operator=(const action_recorder&) = delete;
+
+    ~action_recorder() {
+        finish();
+    }
+
+    /** Writes the end marker, flushes and detaches from the engine. */
+    void finish() {
+        if (finished) { return; }
+        begin(replay_format::END, e.getTick());
+        flush();
+        e.setListener(nullptr);
+        finished = true;
+    }
+
+    virtual void actorAdded(std::uint64_t tick, actor_handle handle,
+                            const actor& act) {
+        byte_writer w = begin(replay_format::SPAWN, tick);
+        replay_format::write_handle(w, handle);
+        w.string(act.name);
+        w.f64(act.position.x());
+        w.f64(act.position.y());
+        w.f64(act.direction);
+        w.f64(act.speed);
+        w.f64(act.angular_velocity);
+        w.f64(act.attack_damage);
+        w.f64(act.attack_delay);
+        w.f64(act.health);
+        w.f64(act.limits.speed);
+        w.f64(act.limits.angular_velocity);
+        w.f64(act.limits.attack_damage);
+        w.f64(act.limits.attack_delay);
+        w.f64(act.limits.health);
+    }
+
+    virtual void actorRemoved(std::uint64_t tick, actor_handle handle) {
+        byte_writer w = begin(replay_format::REMOVE, tick);
+        replay_format::write_handle(w, handle);
+    }
+
+    virtual void actionApplied(std::uint64_t tick, bool queued,
+                               const timed_action& a) {
+        byte_writer w = begin(replay_format::ACTION, tick);
+        w.u8(static_cast<unsigned char>(a.type) |
+             (queued ? replay_format::queued_flag : 0));
+        replay_format::write_handle(w, a.actor);
+        w.f64(a.time);
+        if (a.type == action_type::ATTACK) {
+            replay_format::write_handle(w, a.target);
+        } else if (a.type == action_type::AREA_ATTACK) {
+            w.f64(a.radius);
+        }
+    }
+
+    virtual void tickSimulated(std::uint64_t tick) {
+        if (hash_every && tick % hash_every == 0) {
+            byte_writer w = begin(replay_format::HASH, tick);
+            w.fixed64(e.stateHash());
+        }
+        if (buffer.size() >= flush_size) {
+            flush();
+        }
+    }
+
+    private:
+    byte_writer begin(replay_format::tag t, std::uint64_t tick) {
+        assert(tick >= last_tick);
+        byte_writer w(buffer);
+        w.u8(t);
+        w.varint(tick - last_tick);
+        last_tick = tick;
+        return w;
+    }
+
+    void flush() {
+        out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        buffer.clear();
+    }
+};
+
+struct replay_result {
+    std::uint64_t ticks;
+    std::uint64_t hashes_checked;
+    std::uint64_t final_hash;
+    double game_time; // seconds of game time replayed
+};
+
+/**
+ * Runs a recorded log on a fresh engine as fast as it will go.
+ *
+ * Throws err::bad_format if the log is damaged and err::diverged (with
+ * the tick attached) if the engine ends up somewhere other than where
+ * the recorded hashes say it should be, or an actor the log removes is
+ * not there.
+ */
+inline replay_result
+replay(std::istream& in, std::size_t threads = 1)
+{
+    using namespace replay_format;
+
+    std::vector<unsigned char> data(
+            (std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+    byte_reader r(data.data(), data.size());
+
+    char m[sizeof(magic)];
+    r.bytes(m, sizeof(m));
+    if (std::memcmp(m, magic, sizeof(magic)) != 0) {
+        throw err::bad_format() << err::reason("not an action log");
+    }
+    if (r.varint() != version) {
+        throw err::bad_format() << err::reason("unsupported log version");
+    }
+    std::size_t width  = r.varint();
+    std::size_t height = r.varint();
+    double difficulty  = r.f64();
+    unsigned int seed  = static_cast<unsigned int>(r.varint());
+    const auto how = maps::generators::find_generator(r.string().c_str());
+    double dt          = r.f64();
+    r.varint(); // hash interval, only informative
+    if (width == 0 || height == 0 || width > 0xffff || height > 0xffff) {
+        throw err::bad_format() << err::reason("bad maze size");
+    }
+    if (!how.run) {
+        throw err::bad_format() << err::reason("unknown maze generator");
+    }
+    if (!std::isfinite(dt) || dt <= 0) {
+        throw err::bad_format() << err::reason("bad time step");
+    }
+
+    engine e(std::make_shared<const maps::Maze>(width, height, difficulty, seed,
+                                                how),
+             std::make_shared<utility::thread_pool>(threads));
+    e.setTimeStep(dt);
+
+    replay_result result{0, 0, 0, 0};
+    std::uint64_t label = 0;
+    for (;;) {
+        unsigned char t = r.u8();
+        const std::uint64_t gap = r.varint();
+        if (gap > max_gap) {
+            throw err::bad_format() << err::reason("record too far ahead");
+        }
+        label += gap;
+        while (e.getTick() < label) {
+            e.simulate();
+        }
+
+        if (t == END) { break; }
+        switch (t) {
+            case SPAWN:
+            {
+                actor_handle recorded = read_handle(r);
+                actor act(r.string());
+                act.position.x()     = r.f64();
+                act.position.y()     = r.f64();
+                act.direction        = r.f64();
+                act.speed            = r.f64();
+                act.angular_velocity = r.f64();
+                act.attack_damage    = r.f64();
+                act.attack_delay     = r.f64();
+                act.health           = r.f64();
+                act.limits.speed            = r.f64();
+                act.limits.angular_velocity = r.f64();
+                act.limits.attack_damage    = r.f64();
+                act.limits.attack_delay     = r.f64();
+                act.limits.health           = r.f64();
+                if (e.addActor(act) != recorded) {
+                    throw err::diverged() << err::tick(label)
+                        << err::reason("actor spawned with another handle");
+                }
+            }break;
+            case REMOVE:
+            {
+                actor_handle h = read_handle(r);
+                if (!e.hasActor(h)) {
+                    throw err::diverged() << err::tick(label)
+                        << err::reason("removed actor is not there");
+                }
+                e.removeActor(h);
+            }break;
+            case ACTION:
+            {
+                unsigned char type = r.u8();
+                bool queued = type & queued_flag;
+                type &= ~queued_flag;
+                if (type > static_cast<unsigned char>(action_type::AREA_ATTACK)) {
+                    throw err::bad_format() << err::reason("unknown action");
+                }
+                timed_action a{0, read_handle(r), actor_handle(),
+                    static_cast<action_type>(type), 0};
+                a.time = r.f64();
+                if (a.type == action_type::ATTACK) {
+                    a.target = read_handle(r);
+                } else if (a.type == action_type::AREA_ATTACK) {
+                    a.radius = r.f64();
+                }
+                if (queued) {
+                    e.queueAction(a);
+                } else {
+                    e.applyAction(a);
+                }
+            }break;
+            case HASH:
+                if (r.fixed64() != e.stateHash()) {
+                    throw err::diverged() << err::tick(label)
+                        << err::reason("state hash mismatch");
+                }
+                ++result.hashes_checked;
+                break;
+            default:
+                throw err::bad_format() << err::reason("unknown record");
+        }
+    }
+
+    result.ticks = e.getTick();
+    result.final_hash = e.stateHash();
+    result.game_time = e.getCurrentTime();
+    return result;
+}
+
+} /*end namespace*/
+
+#endif
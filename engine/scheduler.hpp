@@ -0,0 +1,85 @@
+#ifndef SCHEDULER_HPP_HEADER
+#define SCHEDULER_HPP_HEADER
+
+/**
+ * @file scheduler.hpp
+ * Timed event queue for the engine.
+ *
+ * Events are kept in a binary min-heap keyed on (fire time, insertion
+ * order), so only pending events cost anything and events due at the same
+ * time fire in the order they were scheduled.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace engine {
+
+template <typename Event>
+class event_scheduler {
+    struct entry {
+        double time;
+        std::uint64_t seq;
+        Event event;
+    };
+
+    struct later {
+        bool operator()(const entry& a, const entry& b) const {
+            return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+        }
+    };
+
+    std::vector<entry> heap;
+    std::uint64_t next_seq;
+
+    public:
+    event_scheduler()
+        : heap()
+        , next_seq(0)
+    {}
+
+    void schedule(double time, const Event& event) {
+        heap.push_back(entry{time, next_seq++, event});
+        std::push_heap(heap.begin(), heap.end(), later());
+    }
+
+    /**
+     * Pops every event due at or before `time` and calls f(fire_time, event)
+     * for each one, earliest first. Events scheduled from inside f are
+     * picked up too if they are already due. At most limit events fire;
+     * the rest stay queued, still earliest first.
+     *
+     * @return the number of events fired
+     */
+    template <typename F>
+    std::size_t fire_until(double time, F& f,
+            std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+        std::size_t fired = 0;
+        while (fired < limit && !heap.empty() && heap.front().time <= time) {
+            std::pop_heap(heap.begin(), heap.end(), later());
+            entry e = heap.back();
+            heap.pop_back();
+            f(e.time, e.event);
+            ++fired;
+        }
+        return fired;
+    }
+
+    bool empty() const { return heap.empty(); }
+    std::size_t size() const { return heap.size(); }
+
+    /** Fire time of the earliest pending event; only valid if !empty(). */
+    double next_time() const { return heap.front().time; }
+
+    void clear() { heap.clear(); }
+};
+
+} /*end namespace*/
+
+#endif
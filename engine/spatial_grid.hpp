@@ -0,0 +1,285 @@
+#ifndef SPATIAL_GRID_HPP_HEADER
+#define SPATIAL_GRID_HPP_HEADER
+
+/**
+ * @file spatial_grid.hpp
+ * Actors bucketed by maze cell, for finding the ones near a point.
+ *
+ * The grid has a bucket per maze cell, and cell (i, j) covers
+ * [i, i+1) x [j, j+1) as in collision.hpp. Anything off the maze goes
+ * into the nearest border cell, so every actor is always in some bucket.
+ * A query only visits the buckets its area touches and checks the
+ * positions of the actors in them, which it is given as the actor
+ * store's columns.
+ *
+ * A bucket is a list of blocks of dense indices, a cache line each,
+ * taken from one pool that every bucket shares. The pool is kept large
+ * enough for the worst case the actors could be spread over the cells
+ * in, so moving actors around never allocates.
+ *
+ * The grid follows the store's dense indices, so it has to be told about
+ * every insert and erase in the same order the store gets them. Moving
+ * within a cell needs nothing, so a tick only checks whether an actor
+ * left its cell, which can be done in parallel, and then moves the few
+ * that did with update(), serially.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+class spatial_grid {
+    static const std::uint32_t none =
+        std::numeric_limits<std::uint32_t>::max();
+    static const std::uint32_t block_size = 14;
+
+    struct block {
+        std::uint32_t index[block_size]; // dense
+        std::uint32_t used;
+        std::uint32_t next; // in the bucket, or in the free list
+    };
+
+    long width;
+    long height;
+    std::vector<block> blocks;
+    std::uint32_t free_blocks;        // first one
+    std::vector<std::uint32_t> first; // block of every bucket, the one filling
+    std::vector<std::uint32_t> cell;  // by dense index
+    std::vector<std::uint32_t> where; // block * block_size + place in it
+
+    public:
+    spatial_grid(std::size_t width, std::size_t height)
+        : width(static_cast<long>(width))
+        , height(static_cast<long>(height))
+        , blocks()
+        , free_blocks(none)
+        , first(width * height, std::uint32_t(none))
+        , cell()
+        , where()
+    {
+        assert(width > 0 && height > 0);
+    }
+
+    std::size_t size() const { return cell.size(); }
+
+    /** The cell a point belongs to, with points off the grid clamped in. */
+    std::uint32_t cellOf(double x, double y) const {
+        return static_cast<std::uint32_t>(column(x) * height + row(y));
+    }
+
+    /** Whether (x, y) is outside the cell the actor is bucketed in. */
+    bool leftCell(std::size_t i, double x, double y) const {
+        return cellOf(x, y) != cell[i];
+    }
+
+    /** Adds the actor that just got dense index size(). */
+    void insert(std::size_t i, double x, double y) {
+        assert(i == size());
+        // every bucket's blocks are full but its first one, which holds
+        // at least one actor
+        const std::size_t worst = (i + 1) / block_size
+            + std::min(i + 1, first.size());
+        if (blocks.capacity() < worst) { blocks.reserve(2 * worst); }
+        cell.push_back(cellOf(x, y));
+        where.push_back(0);
+        put_in(i);
+    }
+
+    /**
+     * Removes the actor at dense index i. As in actor_store::erase, the
+     * last actor takes over index i.
+     */
+    void erase(std::size_t i) {
+        assert(i < size());
+        take_out(i);
+        const std::size_t last = size() - 1;
+        if (i != last) {
+            cell[i] = cell[last];
+            where[i] = where[last];
+            at(where[i]) = static_cast<std::uint32_t>(i);
+        }
+        cell.pop_back();
+        where.pop_back();
+    }
+
+    void clear() {
+        blocks.clear();
+        free_blocks = none;
+        first.assign(first.size(), std::uint32_t(none));
+        cell.clear();
+        where.clear();
+    }
+
+    /** Starts over with n actors at the given positions, in dense order. */
+    void rebuild(const double* x, const double* y, std::size_t n) {
+        clear();
+        for (std::size_t i = 0; i < n; ++i) { insert(i, x[i], y[i]); }
+    }
+
+    /** Moves the actor to the bucket of (x, y) if it is not there already. */
+    void update(std::size_t i, double x, double y) {
+        const std::uint32_t c = cellOf(x, y);
+        if (c == cell[i]) { return; }
+        take_out(i);
+        cell[i] = c;
+        put_in(i);
+    }
+
+    /**
+     * Calls f(dense index) for every actor in the box, edges included;
+     * xs and ys are the actors' positions by dense index.
+     */
+    template <typename F>
+    void forEachInBox(const double* xs, const double* ys,
+                      double x0, double y0, double x1, double y1, F f) const {
+        auto check = [&](std::uint32_t k) {
+            if (xs[k] >= x0 && xs[k] <= x1 && ys[k] >= y0 && ys[k] <= y1) {
+                f(k);
+            }
+        };
+        for (long cx = column(x0); cx <= column(x1); ++cx) {
+            for (long cy = row(y0); cy <= row(y1); ++cy) {
+                each(cx * height + cy, check);
+            }
+        }
+    }
+
+    /** Calls f(dense index) for every actor within radius of (x, y). */
+    template <typename F>
+    void forEachInRadius(const double* xs, const double* ys,
+                         double x, double y, double radius, F f) const {
+        const double r2 = radius * radius;
+        auto check = [&](std::uint32_t k) {
+            const double dx = xs[k] - x, dy = ys[k] - y;
+            if (dx*dx + dy*dy <= r2) { f(k); }
+        };
+        for (long cx = column(x - radius); cx <= column(x + radius); ++cx) {
+            for (long cy = row(y - radius); cy <= row(y + radius); ++cy) {
+                each(cx * height + cy, check);
+            }
+        }
+    }
+
+    /**
+     * Overwrites out with the k actors closest to (x, y), nearest first,
+     * as (squared distance, dense index) pairs; ties go to the lower
+     * index. Searches rings of cells outwards and stops as soon as no
+     * unsearched cell can hold anything closer than the k-th found.
+     */
+    void nearest(const double* xs, const double* ys,
+                 double x, double y, std::size_t k,
+                 std::vector<std::pair<double, std::uint32_t>>& out) const {
+        out.clear();
+        if (k == 0) { return; }
+        auto offer = [&](std::uint32_t i) {
+            const double dx = xs[i] - x, dy = ys[i] - y;
+            const std::pair<double, std::uint32_t> p(dx*dx + dy*dy, i);
+            // out is a max-heap of the k best so far
+            if (out.size() < k) {
+                out.push_back(p);
+                std::push_heap(out.begin(), out.end());
+            } else if (p < out.front()) {
+                std::pop_heap(out.begin(), out.end());
+                out.back() = p;
+                std::push_heap(out.begin(), out.end());
+            }
+        };
+        const long cx = column(x), cy = row(y);
+        for (long d = 0; ; ++d) {
+            const long x0 = cx - d, x1 = cx + d, y0 = cy - d, y1 = cy + d;
+            for (long i = std::max(x0, 0L); i <= std::min(x1, width - 1); ++i) {
+                // whole columns on the ring's sides, in between only the
+                // top and bottom cell
+                const bool side = i == x0 || i == x1;
+                for (long j = std::max(y0, 0L); j <= std::min(y1, height - 1);
+                        ++j) {
+                    if (!side && j != y0) { j = y1; }
+                    if (j >= height) { break; }
+                    each(i * height + j, offer);
+                }
+            }
+            // everything outside the ring is at least this far away
+            if (out.size() == k) {
+                const double edge = std::min(std::min(x - x0, x1 + 1 - x),
+                        std::min(y - y0, y1 + 1 - y));
+                if (edge > 0 && edge * edge >= out.front().first) { break; }
+            }
+            if (x0 <= 0 && y0 <= 0 && x1 >= width - 1 && y1 >= height - 1) {
+                break; // that was all of it
+            }
+        }
+        std::sort_heap(out.begin(), out.end());
+    }
+
+    private:
+    long column(double x) const {
+        return std::min(std::max(static_cast<long>(std::floor(x)), 0L),
+                width - 1);
+    }
+    long row(double y) const {
+        return std::min(std::max(static_cast<long>(std::floor(y)), 0L),
+                height - 1);
+    }
+
+    std::uint32_t& at(std::uint32_t w) {
+        return blocks[w / block_size].index[w % block_size];
+    }
+
+    template <typename F>
+    void each(long c, F& f) const {
+        for (std::uint32_t b = first[c]; b != none; b = blocks[b].next) {
+            const block& bl = blocks[b];
+            for (std::uint32_t k = 0; k < bl.used; ++k) { f(bl.index[k]); }
+        }
+    }
+
+    /** Adds the actor to the bucket of its cell. */
+    void put_in(std::size_t i) {
+        const std::uint32_t c = cell[i];
+        std::uint32_t b = first[c];
+        if (b == none || blocks[b].used == block_size) {
+            std::uint32_t fresh = free_blocks;
+            if (fresh == none) {
+                fresh = static_cast<std::uint32_t>(blocks.size());
+                blocks.push_back(block());
+            } else {
+                free_blocks = blocks[fresh].next;
+            }
+            blocks[fresh].used = 0;
+            blocks[fresh].next = b;
+            first[c] = b = fresh;
+        }
+        block& bl = blocks[b];
+        bl.index[bl.used] = static_cast<std::uint32_t>(i);
+        where[i] = b * block_size + bl.used++;
+    }
+
+    /** Fills the actor's hole with the last index of its bucket. */
+    void take_out(std::size_t i) {
+        const std::uint32_t c = cell[i];
+        block& bl = blocks[first[c]];
+        const std::uint32_t last = bl.index[--bl.used];
+        at(where[i]) = last;
+        where[last] = where[i];
+        if (bl.used == 0) {
+            const std::uint32_t empty = first[c];
+            first[c] = bl.next;
+            bl.next = free_blocks;
+            free_blocks = empty;
+        }
+    }
+};
+
+} /*end namespace*/
+
+#endif
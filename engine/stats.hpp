@@ -0,0 +1,182 @@
+#ifndef STATS_HPP_HEADER
+#define STATS_HPP_HEADER
+
+/**
+ * @file stats.hpp
+ * Where engine::simulate() spends its time.
+ *
+ * With HEXIT_ENGINE_STATS defined the engine times the phases of every
+ * tick, counts what it does and keeps a histogram of tick durations in
+ * an engine_stats. Without it phase_timer and count() are empty inlines
+ * and the stats stay zero, so the instrumented code compiles to what it
+ * was before.
+ *
+ * Integration and collision run in parallel chunks; their times are
+ * summed over the chunks, so with several threads they are CPU time,
+ * not wall-clock time.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace engine {
+
+struct engine_stats {
+    enum phase {
+        DRAIN,     // applying submitted actions
+        INTEGRATE, // the movement kernel
+        COLLIDE,   // sweeping moves against the maze
+        EVENTS,    // attacks landing
+        DAMAGE,    // damage coming off health
+        GRID,      // moving actors between spatial grid cells
+        phase_count
+    };
+
+    // bucket k holds the ticks that took [2^k, 2^(k+1)) nanoseconds
+    static const std::size_t histogram_size = 40;
+
+    std::uint64_t ticks;
+    std::uint64_t tick_ns;
+    std::uint64_t phase_ns[phase_count];
+
+    std::uint64_t actions_applied;
+    std::uint64_t actors_moved;    // actors that tried to move
+    std::uint64_t wall_hits;       // moves a wall cut short
+    std::uint64_t attacks_started;
+    std::uint64_t attacks_landed;
+    std::uint64_t target_lookups;  // handle lookups for attack targets
+    std::uint64_t damage_events;   // blows, an area attack deals several
+    std::uint64_t deaths;
+    std::uint64_t cell_changes;    // actors that moved to another grid cell
+
+    std::uint64_t tick_histogram[histogram_size];
+
+#ifdef HEXIT_ENGINE_STATS
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+
+    engine_stats()
+        : ticks(0)
+        , tick_ns(0)
+        , phase_ns()
+        , actions_applied(0)
+        , actors_moved(0)
+        , wall_hits(0)
+        , attacks_started(0)
+        , attacks_landed(0)
+        , target_lookups(0)
+        , damage_events(0)
+        , deaths(0)
+        , cell_changes(0)
+        , tick_histogram()
+    {}
+
+    void clear() {
+        ticks = tick_ns = 0;
+        for (auto& p : phase_ns) { p = 0; }
+        actions_applied = actors_moved = wall_hits = 0;
+        attacks_started = attacks_landed = target_lookups = 0;
+        damage_events = deaths = cell_changes = 0;
+        for (auto& b : tick_histogram) { b = 0; }
+    }
+
+    void addTick(std::uint64_t ns) {
+        ++ticks;
+        tick_ns += ns;
+        std::size_t bucket = 0;
+        while (bucket + 1 < histogram_size && (ns >> (bucket + 1))) {
+            ++bucket;
+        }
+        ++tick_histogram[bucket];
+    }
+
+    /**
+     * An upper bound on the q-th quantile of tick durations in ns, good to
+     * a factor of two; 0 before any tick.
+     */
+    std::uint64_t tickPercentile(double q) const {
+        std::uint64_t seen = 0;
+        for (std::size_t k = 0; k < histogram_size; ++k) {
+            seen += tick_histogram[k];
+            if (ticks && seen >= q * ticks) {
+                return std::uint64_t(2) << k;
+            }
+        }
+        return 0;
+    }
+
+    void print(std::ostream& out) const {
+        static const char* names[phase_count] = {
+            "drain", "integrate", "collide", "events", "damage", "grid"};
+        const double per_tick = ticks ? 1e-3 / ticks : 0;
+        out << "ticks " << ticks
+            << " mean_us " << tick_ns * per_tick
+            << " p50_us<" << tickPercentile(0.5) * 1e-3
+            << " p99_us<" << tickPercentile(0.99) * 1e-3;
+        for (std::size_t p = 0; p < phase_count; ++p) {
+            out << " " << names[p] << "_us " << phase_ns[p] * per_tick;
+        }
+        out << " actions " << actions_applied
+            << " moved " << actors_moved
+            << " wall_hits " << wall_hits
+            << " attacks " << attacks_started
+            << " landed " << attacks_landed
+            << " lookups " << target_lookups
+            << " damage " << damage_events
+            << " deaths " << deaths
+            << " cell_changes " << cell_changes
+            << std::endl;
+    }
+};
+
+#ifdef HEXIT_ENGINE_STATS
+
+/** Adds the time from construction to destruction to one counter. */
+class phase_timer {
+    typedef std::chrono::steady_clock clock;
+    std::uint64_t& total;
+    clock::time_point start;
+
+    public:
+    explicit phase_timer(std::uint64_t& total)
+        : total(total)
+        , start(clock::now())
+    {}
+
+    phase_timer(const phase_timer&) = delete;
+    phase_timer& operator=(const phase_timer&) = delete;
+
+    std::uint64_t elapsed() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - start).count();
+    }
+
+    ~phase_timer() { total += elapsed(); }
+};
+
+inline void count(std::uint64_t& counter, std::uint64_t n = 1) {
+    counter += n;
+}
+
+#else
+
+class phase_timer {
+    public:
+    explicit phase_timer(std::uint64_t&) {}
+    std::uint64_t elapsed() const { return 0; }
+};
+
+inline void count(std::uint64_t&, std::uint64_t = 1) {}
+
+#endif
+
+} /*end namespace*/
+
+#endif
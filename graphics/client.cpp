@@ -7,6 +7,8 @@
  */
 
 #include "../maps/maze.hpp"
+#include "../engine/engine.hpp"
+#include "../engine/driver.hpp"
 
 #include <osg/Geode>
 #include <osg/Geometry>
@@ -28,6 +30,7 @@
 #include <osgViewer/ViewerEventHandlers>
 
 #include <osg/Math>
+#include <osg/Timer>
 
 #include <iostream>
 
@@ -35,38 +38,6 @@
 
 #include <boost/multi_array.hpp>
 
-class PhysicsObject {
-public:
-    PhysicsObject(osg::ref_ptr<osg::PositionAttitudeTransform> xform)
-        : velocity(osg::Vec3d(0,0,0))
-        , omega(osg::Quat(0, osg::Vec3d(1,0,0)))
-        , xform(xform)
-    {}
-
-    void add_vel(osg::Vec3d v) {
-        velocity += xform->getAttitude() * v;
-    }
-
-    void add_rot(osg::Quat q) {
-        omega *= q;
-    }
-
-    void move() {
-        xform->setPosition(xform->getPosition() + velocity);
-        xform->setAttitude(xform->getAttitude() * omega);
-    }
-
-    void clear() {
-        velocity = osg::Vec3d(0,0,0);
-        omega    = osg::Quat(0, osg::Vec3d(1,0,0));
-    }
-
-    osg::Vec3d velocity;
-    osg::Quat  omega;
-
-    osg::ref_ptr<osg::PositionAttitudeTransform> xform;
-};
-
 osg::ref_ptr<osg::Geode>
 ijk()
 {
@@ -110,10 +81,22 @@ ijk()
 class KeyboardEventHandler : public osgGA::GUIEventHandler
 {
 public:
-    KeyboardEventHandler() : pressed() {}
+    KeyboardEventHandler()
+        : pressed()
+        , forward(false)
+        , backward(false)
+        , left(false)
+        , right(false)
+    {}
 
     std::set<int> pressed;
 
+    // what the player was last told to do
+    bool forward;
+    bool backward;
+    bool left;
+    bool right;
+
     virtual bool handle(const osgGA::GUIEventAdapter& ea,osgGA::GUIActionAdapter&)
     {
         //std::cout << ea.getEventType() << "\t";
@@ -141,56 +124,54 @@ public:
         return true;
     }
 
-    void apply_commands(PhysicsObject& obj) {
-        double movespeed =
-            0.027869470349083095035789384576097879050347563756563587097654766897654;
-        for (auto& key : pressed) {
-            switch(key)
-            {
-                case(osgGA::GUIEventAdapter::KEY_C):
-                {
-                    obj.add_vel(osg::Vec3d(0.0,-movespeed,0.0));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_Space):
-                {
-                    obj.add_vel(osg::Vec3d(0.0,movespeed,0.0));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_Left):
-                case(osgGA::GUIEventAdapter::KEY_A):
-                {
-                    obj.add_vel(osg::Vec3d(-movespeed,0.0,0.0));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_Right):
-                case(osgGA::GUIEventAdapter::KEY_D):
-                {
-                    obj.add_vel(osg::Vec3d(movespeed,0.0,0.0));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_S):
-                case(osgGA::GUIEventAdapter::KEY_Down):
-                {
-                    obj.add_vel(osg::Vec3d(0.0,0.0,movespeed));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_W):
-                case(osgGA::GUIEventAdapter::KEY_Up):
-                {
-                    obj.add_vel(osg::Vec3d(0.0,0.0,-movespeed));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_Q):
-                {
-                    obj.add_rot(osg::Quat(0.001,osg::Vec3d(0.0,1.0,0.0)));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_E):
-                {
-                    obj.add_rot(osg::Quat(-0.001,osg::Vec3d(0.0,1.0,0.0)));
-                }break;
-                case(osgGA::GUIEventAdapter::KEY_G):
-                {
-                    obj.add_vel(osg::Vec3d(0.0,0.0,-0.398978678676678688));
-                }break;
-                default:
-                    break;
+    bool held(int key) const {
+        return pressed.find(key) != pressed.end();
+    }
+
+    /** Turns changes in the held keys into start/stop actions. */
+    void apply_commands(engine::engine& world, engine::actor_handle player) {
+        using osgGA::GUIEventAdapter;
+        double now = world.getCurrentTime();
+
+        bool f = held(GUIEventAdapter::KEY_W) || held(GUIEventAdapter::KEY_Up);
+        bool b = held(GUIEventAdapter::KEY_S) || held(GUIEventAdapter::KEY_Down);
+        bool l = held(GUIEventAdapter::KEY_A) || held(GUIEventAdapter::KEY_Left)
+            || held(GUIEventAdapter::KEY_Q);
+        bool r = held(GUIEventAdapter::KEY_D) || held(GUIEventAdapter::KEY_Right)
+            || held(GUIEventAdapter::KEY_E);
+
+        if (f != forward) {
+            if (f) {
+                world.applyActionToActor(player, engine::StartGoForwardAction{now});
+            } else {
+                world.applyActionToActor(player, engine::StopGoForwardAction{now});
+            }
+        }
+        if (b != backward) {
+            if (b) {
+                world.applyActionToActor(player, engine::StartGoBackwardAction{now});
+            } else {
+                world.applyActionToActor(player, engine::StopGoBackwardAction{now});
             }
         }
+        if (l != left) {
+            if (l) {
+                world.applyActionToActor(player, engine::StartRotateLeftAction{now});
+            } else {
+                world.applyActionToActor(player, engine::StopRotateLeftAction{now});
+            }
+        }
+        if (r != right) {
+            if (r) {
+                world.applyActionToActor(player, engine::StartRotateRightAction{now});
+            } else {
+                world.applyActionToActor(player, engine::StopRotateRightAction{now});
+            }
+        }
+        forward = f;
+        backward = b;
+        left = l;
+        right = r;
     }
     virtual ~KeyboardEventHandler() {};
 };
@@ -223,16 +204,20 @@ int main( int , char ** )
     const int map_size_w = 91;
     const double difficulty = 1;
 
-    auto maze = maps::Maze(map_size_w, map_size_h, difficulty);
+    // world units per maze cell
+    const double cell_size = 40;
+
+    auto maze = std::make_shared<const maps::Maze>(
+            map_size_w, map_size_h, difficulty);
 
     // draw maze
-    maze_xform_type maze_xforms(boost::extents[maze.getHeight()][maze.getWidth()]);
-    for (size_t i = 0; i < maze.getHeight(); i++){
-        for (size_t j = 0; j < maze.getWidth(); j++){
-            if (maze.isWall(j, i)){
+    maze_xform_type maze_xforms(boost::extents[maze->getHeight()][maze->getWidth()]);
+    for (size_t i = 0; i < maze->getHeight(); i++){
+        for (size_t j = 0; j < maze->getWidth(); j++){
+            if (maze->isWall(j, i)){
                 maze_xforms[i][j] = osg::ref_ptr<osg::PositionAttitudeTransform>(new osg::PositionAttitudeTransform);
                 maze_xforms[i][j]->addChild(box);
-                maze_xforms[i][j]->setPosition(osg::Vec3d(j*40, i*40, 0));
+                maze_xforms[i][j]->setPosition(osg::Vec3d(j*cell_size, i*cell_size, 0));
                 maze_xforms[i][j]->setAttitude(osg::Quat(M_PI, osg::Vec3d(1,0,0) ));
                 mazexform->addChild(maze_xforms[i][j]);
             }
@@ -246,8 +231,26 @@ int main( int , char ** )
     osgViewer::Viewer viewer;
     viewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
 
-    PhysicsObject obj(guyxform);
-    guyxform->setPosition(osg::Vec3d(1,1,0));
+    engine::engine world(maze);
+    auto start = maze->getStart();
+    auto player = world.addActor(engine::actor(
+                "player",
+                osg::Vec2d(start.first + 0.5, start.second + 0.5),
+                0, // direction
+                100, // health
+                engine::actor_properties{
+                    2, // speed
+                    TAU/4, // angular vel
+                    10, // attack damage
+                    0.5, // attack delay
+                    100
+                }));
+    world.applyActionToActor(player,
+            engine::StopGoForwardAction{world.getCurrentTime()});
+
+    // the simulation ticks at its own rate, frames draw in between ticks
+    engine::fixed_step_driver driver(world);
+    std::vector<engine::actor_snapshot> poses;
 
     root->addChild(mazexform);
 
@@ -273,16 +276,27 @@ int main( int , char ** )
                 osg::Vec3d(0,0,-1),
                 osg::Vec3d(0,1,0)));
 //    viewer.run();
+    osg::Timer_t last_frame = osg::Timer::instance()->tick();
     while (!viewer.done()) {
-        eventHandler->apply_commands(obj);
-        obj.move();
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        eventHandler->apply_commands(world, player);
+        driver.advance(osg::Timer::instance()->delta_s(last_frame, now));
+        last_frame = now;
+
+        driver.interpolate(poses);
+        for (auto& pose : poses) {
+            if (pose.handle != player) { continue; }
+            guyxform->setPosition(
+                    osg::Vec3d(pose.x*cell_size, 0, pose.y*cell_size));
+            guyxform->setAttitude(
+                    osg::Quat(-pose.direction, osg::Vec3d(0,1,0)));
+        }
         viewer.getCamera()->setViewMatrix(
                 osg::Matrixd::lookAt(
-                    /* where we are */ obj.xform->getPosition() + obj.xform->getAttitude() * osg::Vec3d(0,6,6),
-                    /* what we are looking at */ obj.xform->getPosition(),
+                    /* where we are */ guyxform->getPosition() + guyxform->getAttitude() * osg::Vec3d(0,6,6),
+                    /* what we are looking at */ guyxform->getPosition(),
                     /* up vector */ osg::Vec3d(0,1,0)
                     ));
-        obj.clear();
         viewer.frame();
     }
 
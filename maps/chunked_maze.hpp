@@ -0,0 +1,246 @@
+#ifndef CHUNKED_MAZE_HPP_GUARD
+#define CHUNKED_MAZE_HPP_GUARD
+/**
+ * @file chunked_maze.hpp
+ * A maze with no edges, made of chunks generated as they are needed.
+ *
+ * The world is tiled with square chunks, and each chunk is a Maze of its
+ * own, generated from a seed hashed out of the world seed and the chunk's
+ * coordinates. So a chunk comes out the same whenever and in whatever
+ * order it is generated, and it can be thrown away and made again. Every
+ * chunk is walled in. The doors through the walls between two chunks are
+ * picked from a seed for that shared side, so both chunks open the same
+ * rows. Nothing is generated up front, so a world costs nothing to start
+ * and as much memory as the chunks around its actors.
+ *
+ * update() is what generates and evicts. It makes sure the chunks within
+ * some radius of every actor are there, and keeps them. Any others are
+ * kept up to a capacity, and the ones that have gone longest without an
+ * actor near them are evicted first. The const queries only look at the
+ * chunks that are there and never change anything, so they can be made
+ * from any number of threads between updates. A cell in a chunk that is
+ * not there is a wall.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "maze.hpp"
+#include "../misc/utility.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace maps {
+
+struct chunked_maze_params {
+    size_t chunk_size;  // cells on a side, odd
+    double difficulty;
+    unsigned int seed;
+    size_t doors;       // between two chunks; some may fall together
+    size_t capacity;    // chunks kept, besides the ones near actors
+    generators::generator how; // see generators.hpp
+
+    chunked_maze_params()
+        : chunk_size(65)
+        , difficulty(1)
+        , seed(1)
+        , doors(2)
+        , capacity(64)
+        , how(generators::find_generator("random-walk"))
+    {}
+};
+
+struct chunked_maze_stats {
+    size_t generated;
+    size_t evicted;
+
+    chunked_maze_stats() : generated(0), evicted(0) {}
+};
+
+class chunked_maze {
+    typedef std::pair<long, long> chunk_key;
+
+    struct key_hash {
+        size_t operator()(const chunk_key& k) const {
+            return static_cast<size_t>(
+                    mix(static_cast<std::uint64_t>(k.first),
+                        static_cast<std::uint64_t>(k.second)));
+        }
+    };
+
+    struct chunk {
+        std::shared_ptr<Maze> maze;
+        std::uint64_t used; // the last update() an actor was near it
+        bool near;          // in the last update()
+    };
+
+    enum class side { VERTICAL, HORIZONTAL };
+
+    chunked_maze_params params;
+    long size;
+    std::unordered_map<chunk_key, chunk, key_hash> chunks;
+    std::uint64_t round;
+    chunked_maze_stats stats;
+    std::vector<std::pair<std::uint64_t, chunk_key>> idle; // update() scratch
+
+    public:
+    explicit chunked_maze(
+            const chunked_maze_params& params = chunked_maze_params())
+        : params(params)
+        , size(static_cast<long>(params.chunk_size | 1))
+        , chunks()
+        , round(0)
+        , stats()
+        , idle()
+    {
+        assert(size >= 11); // Maze needs the room to place its start
+    }
+
+    chunked_maze(const chunked_maze&) = delete;
+    chunked_maze& operator=(const chunked_maze&) = delete;
+
+    long getChunkSize() const { return size; }
+    size_t getChunkCount() const { return chunks.size(); }
+    const chunked_maze_stats& getStats() const { return stats; }
+
+    /** The chunk cell (x, y) is in. */
+    std::pair<long, long> chunkOf(long x, long y) const {
+        return chunk_key(floor_div(x, size), floor_div(y, size));
+    }
+
+    bool hasChunk(long cx, long cy) const {
+        return chunks.find(chunk_key(cx, cy)) != chunks.end();
+    }
+
+    /** The chunk if it is there, nullptr if not. */
+    std::shared_ptr<const Maze> findChunk(long cx, long cy) const {
+        auto it = chunks.find(chunk_key(cx, cy));
+        return it == chunks.end() ? nullptr : it->second.maze;
+    }
+
+    /** The chunk, generated if it is not there. */
+    std::shared_ptr<const Maze> getChunk(long cx, long cy) {
+        return find_or_make(cx, cy).maze;
+    }
+
+    /** Whether the cell is a path; false if its chunk is not there. */
+    bool isOpen(long x, long y) const {
+        const chunk_key k = chunkOf(x, y);
+        auto it = chunks.find(k);
+        return it != chunks.end() &&
+            it->second.maze->isPath(x - k.first * size, y - k.second * size);
+    }
+
+    /** Whether the cell is a path, generating its chunk if need be. */
+    bool isPath(long x, long y) {
+        const chunk_key k = chunkOf(x, y);
+        return find_or_make(k.first, k.second).maze->isPath(
+                x - k.first * size, y - k.second * size);
+    }
+
+    bool isWall(long x, long y) { return !isPath(x, y); }
+
+    /**
+     * Generates the chunks within radius cells of every position and
+     * keeps them. Of the rest, only the capacity most recently near an
+     * actor are kept, and chunks generated through isPath() or getChunk()
+     * count as near an actor when they were made. Serial only: nothing
+     * else may use the maze while this runs.
+     */
+    void update(const std::vector<std::pair<double, double>>& positions,
+                double radius) {
+        ++round;
+        for (auto& c : chunks) { c.second.near = false; }
+        for (const auto& p : positions) {
+            const chunk_key low = chunkOf(static_cast<long>(std::floor(p.first - radius)),
+                    static_cast<long>(std::floor(p.second - radius)));
+            const chunk_key high = chunkOf(static_cast<long>(std::floor(p.first + radius)),
+                    static_cast<long>(std::floor(p.second + radius)));
+            for (long cx = low.first; cx <= high.first; ++cx) {
+                for (long cy = low.second; cy <= high.second; ++cy) {
+                    chunk& c = find_or_make(cx, cy);
+                    c.near = true;
+                    c.used = round;
+                }
+            }
+        }
+
+        idle.clear();
+        for (const auto& c : chunks) {
+            if (!c.second.near) { idle.push_back(std::make_pair(c.second.used, c.first)); }
+        }
+        if (idle.size() <= params.capacity) { return; }
+        std::sort(idle.begin(), idle.end());
+        for (size_t i = 0; i < idle.size() - params.capacity; ++i) {
+            chunks.erase(idle[i].second);
+            ++stats.evicted;
+        }
+    }
+
+    private:
+    static long floor_div(long a, long b) {
+        return a >= 0 ? a / b : -((-a - 1) / b) - 1;
+    }
+
+    /** splitmix64 of h and v together. */
+    static std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+        std::uint64_t z = h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t chunk_seed(long cx, long cy) const {
+        return mix(mix(params.seed, static_cast<std::uint64_t>(cx)),
+                static_cast<std::uint64_t>(cy));
+    }
+
+    /**
+     * Opens the doors on the side a chunk shares with the next one to
+     * the right (VERTICAL) or above (HORIZONTAL), in the given column or
+     * row of the chunk. Both chunks get the same odd offsets along the
+     * side, which the maze never walls in behind the door.
+     */
+    void open_doors(Maze& m, long cx, long cy, side s, size_t at) const {
+        std::mt19937 rng(static_cast<std::uint32_t>(
+                    mix(chunk_seed(cx, cy), static_cast<std::uint64_t>(s))));
+        for (size_t d = 0; d < params.doors; ++d) {
+            const size_t along = 1 + 2 * utility::rand(rng, 0, (size - 1) / 2);
+            if (s == side::VERTICAL) {
+                m.setPath(at, along, PathTypes::NORMAL);
+            } else {
+                m.setPath(along, at, PathTypes::NORMAL);
+            }
+        }
+    }
+
+    chunk& find_or_make(long cx, long cy) {
+        auto it = chunks.find(chunk_key(cx, cy));
+        if (it != chunks.end()) { return it->second; }
+
+        // a chunk is too small to be worth more threads
+        auto m = std::make_shared<Maze>(size, size, params.difficulty,
+                static_cast<unsigned int>(chunk_seed(cx, cy)), params.how, 1);
+        const size_t last = size - 1;
+        open_doors(*m, cx - 1, cy, side::VERTICAL, 0);
+        open_doors(*m, cx, cy, side::VERTICAL, last);
+        open_doors(*m, cx, cy - 1, side::HORIZONTAL, 0);
+        open_doors(*m, cx, cy, side::HORIZONTAL, last);
+        ++stats.generated;
+        return chunks.insert(std::make_pair(chunk_key(cx, cy),
+                    chunk{m, round, true})).first->second;
+    }
+};
+
+} /*end namespace*/
+
+#endif
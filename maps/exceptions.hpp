@@ -0,0 +1,23 @@
+#ifndef MAPS_EXCEPTIONS_HPP_GUARD
+#define MAPS_EXCEPTIONS_HPP_GUARD
+/**
+ * @file exceptions.hpp
+ * 
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+#include <string>
+#include <boost/exception/all.hpp>
+
+namespace maps {
+namespace err {
+
+    struct exception_base : virtual std::exception, virtual boost::exception {};
+    struct bad_format     : virtual exception_base {};
+    typedef boost::error_info<struct tag_reason, std::string> reason;
+
+}
+}
+
+#endif
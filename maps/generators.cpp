@@ -0,0 +1,397 @@
+/**
+ * @file generators.cpp
+ * The algorithms a Maze can be laid out with, see generators.hpp.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "../misc/thread_pool.hpp"
+#include "../misc/utility.hpp"
+#include "generators.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace maps {
+namespace generators {
+
+namespace {
+
+/** The rooms of a layout, the cells with both coordinates odd. */
+struct rooms {
+    std::size_t w;
+    std::size_t h;
+
+    explicit rooms(const layout& cells)
+        : w((cells.width - 1) / 2)
+        , h((cells.height - 1) / 2)
+    {}
+
+    std::size_t size() const { return w * h; }
+    std::size_t index(std::size_t i, std::size_t j) const { return i * h + j; }
+
+    /** The rooms next to room k, as (room, link x, link y). */
+    std::size_t neighbours(std::size_t k, std::size_t* out, std::size_t* lx,
+                           std::size_t* ly) const {
+        const std::size_t i = k / h, j = k % h;
+        std::size_t n = 0;
+        auto add = [&](std::size_t ni, std::size_t nj) {
+            out[n] = index(ni, nj);
+            lx[n] = i + ni + 1;
+            ly[n] = j + nj + 1;
+            ++n;
+        };
+        if (i > 0)     { add(i - 1, j); }
+        if (i + 1 < w) { add(i + 1, j); }
+        if (j > 0)     { add(i, j - 1); }
+        if (j + 1 < h) { add(i, j + 1); }
+        return n;
+    }
+
+    void open(layout& cells, std::size_t k) const {
+        cells.open(2 * (k / h) + 1, 2 * (k % h) + 1);
+    }
+};
+
+} // end anonymous namespace
+
+/**
+ * Walls grow out from the nodes, the cells with both coordinates even,
+ * in random walks that step two cells at a time and only onto nodes that
+ * are still paths. So the walls are a forest hanging off the border, and
+ * every path cell can reach every other one. The nodes are split into
+ * square tiles. The walks of a tile stay in it and draw from a generator
+ * seeded for that tile alone, so tiles can grow on any number of threads
+ * and come out the same. Each row of tiles is one job, and no two jobs
+ * touch the same row of cells or the same nodes: a job opens its rows,
+ * grows its tiles and joins up the walls inside them in a union-find.
+ * Only the seams are left for after that. Their links are walled, with
+ * one chance in two, where they join two separate walls, so the seams do
+ * not show as long straight corridors and the forest stays a forest.
+ */
+void random_walk(layout& cells, const generator_params& params)
+{
+    using utility::rand;
+
+    const std::size_t width = cells.width, height = cells.height;
+    static const std::size_t tile = 32; // nodes on a side
+    const std::size_t nodes_x = width/2 + 1, nodes_y = height/2 + 1;
+    const std::size_t tiles_x = (nodes_x + tile - 1) / tile;
+    const std::size_t tiles_y = (nodes_y + tile - 1) / tile;
+    const std::size_t complexity = std::size_t(params.complexity*(5*(
+                    std::min(width, 2*tile) + std::min(height, 2*tile))));
+
+    // the walls in union-find, to tell which links would close a loop
+    std::vector<std::uint32_t> parent(nodes_x * nodes_y);
+    auto find = [&](std::uint32_t a) {
+        while (parent[a] != a) { a = parent[a] = parent[parent[a]]; }
+        return a;
+    };
+    auto node = [&](std::size_t x, std::size_t y) {
+        return static_cast<std::uint32_t>(x * nodes_y + y);
+    };
+    auto wall = [&](std::size_t x, std::size_t y) {
+        return !cells.isOpen(x, y);
+    };
+
+    auto grow = [&](std::size_t, std::size_t ty, std::size_t) {
+        const std::size_t y0 = ty * tile, y1 = std::min(nodes_y, y0 + tile);
+        // the rows of cells from this tile row's nodes up to the next one's
+        const std::size_t last = ty + 1 == tiles_y ? height - 1 : 2*y1;
+        for (std::size_t y = std::max<std::size_t>(1, 2*y0); y < last; ++y) {
+            // cells 1 to width-2 are bits 2 to width-1 of the padded row
+            std::uint64_t* row = cells.bits + (y + 1) * cells.stride;
+            for (std::size_t col = 2; col < width; ) {
+                const std::size_t bit = col % 64;
+                const std::size_t n = std::min(64 - bit, width - col);
+                row[col / 64] |= (n == 64 ? ~std::uint64_t(0)
+                        : (std::uint64_t(1) << n) - 1) << bit;
+                col += n;
+            }
+        }
+        for (std::size_t tx = 0; tx < tiles_x; ++tx) {
+            const std::size_t x0 = tx * tile, x1 = std::min(nodes_x, x0 + tile);
+            std::seed_seq seq{params.seed, static_cast<unsigned int>(tx),
+                static_cast<unsigned int>(ty)};
+            std::mt19937 rng(seq);
+            const std::size_t walks =
+                std::size_t(params.density * (x1 - x0) * (y1 - y0));
+            for (std::size_t i = 0; i < walks; ++i) {
+                // in nodes
+                std::size_t x = rand(rng, x0, x1), y = rand(rng, y0, y1);
+                cells.close(2*x, 2*y);
+                for (std::size_t j = 0; j < complexity; ++j) {
+                    std::pair<std::size_t, std::size_t> neigh[4];
+                    std::size_t n = 0;
+                    bool open = false;
+                    auto add = [&](std::size_t nx, std::size_t ny) {
+                        neigh[n++] = std::make_pair(nx, ny);
+                        open = open || cells.isOpen(2*nx, 2*ny);
+                    };
+                    if (x > x0)     { add(x-1, y); }
+                    if (x + 1 < x1) { add(x+1, y); }
+                    if (y > y0)     { add(x, y-1); }
+                    if (y + 1 < y1) { add(x, y+1); }
+                    if (!open) { break; } // and it never will be
+                    auto next = neigh[rand(rng, 0, n)];
+                    if (cells.isOpen(2*next.first, 2*next.second)) {
+                        cells.close(2*next.first, 2*next.second);
+                        cells.close(x + next.first, y + next.second); // the link
+                        x = next.first;
+                        y = next.second;
+                    }
+                }
+            }
+
+            for (std::size_t x = x0; x < x1; ++x) {
+                for (std::size_t y = y0; y < y1; ++y) {
+                    parent[node(x, y)] = node(x, y);
+                }
+            }
+            for (std::size_t x = x0; x < x1; ++x) {
+                for (std::size_t y = y0; y < y1; ++y) {
+                    if (!wall(2*x, 2*y)) { continue; }
+                    if (x + 1 < x1 && wall(2*x + 1, 2*y) && wall(2*x + 2, 2*y)) {
+                        parent[find(node(x, y))] = find(node(x + 1, y));
+                    }
+                    if (y + 1 < y1 && wall(2*x, 2*y + 1) && wall(2*x, 2*y + 2)) {
+                        parent[find(node(x, y))] = find(node(x, y + 1));
+                    }
+                }
+            }
+        }
+    };
+    const std::size_t workers = params.threads ? params.threads
+        : std::max(1u, std::thread::hardware_concurrency());
+    utility::thread_pool pool(std::min(workers, tiles_y));
+    pool.parallel_for(tiles_y, 1, grow);
+
+    // then the seams, serially. The walls already across them, the
+    // border's, are joined first, so that no stitch closes a loop there.
+    std::seed_seq seq{params.seed};
+    std::mt19937 rng(seq);
+    auto seam = [&](bool stitching, std::size_t ax, std::size_t ay,
+                    std::size_t bx, std::size_t by) {
+        if (!wall(2*ax, 2*ay) || !wall(2*bx, 2*by) ||
+                wall(ax + bx, ay + by) == stitching) {
+            return;
+        }
+        const std::uint32_t a = find(node(ax, ay)), b = find(node(bx, by));
+        if (!stitching) {
+            parent[a] = b;
+        } else if (a != b && rand(rng, 0, 2)) {
+            cells.close(ax + bx, ay + by);
+            parent[a] = b;
+        }
+    };
+    for (bool stitching : {false, true}) {
+        for (std::size_t tx = 1; tx < tiles_x; ++tx) {
+            for (std::size_t y = 0; y < nodes_y; ++y) {
+                seam(stitching, tx * tile - 1, y, tx * tile, y);
+            }
+        }
+        for (std::size_t ty = 1; ty < tiles_y; ++ty) {
+            for (std::size_t x = 0; x < nodes_x; ++x) {
+                seam(stitching, x, ty * tile - 1, x, ty * tile);
+            }
+        }
+    }
+}
+
+void eller(layout& cells, const generator_params& params)
+{
+    eller_rows rows(cells.width, cells.height, params.seed);
+    std::vector<char> row;
+    for (std::size_t y = 0; !rows.done(); ++y) {
+        rows.next(row);
+        for (std::size_t x = 0; x < cells.width; ++x) {
+            if (row[x]) { cells.open(x, y); }
+        }
+    }
+}
+
+/**
+ * Every room not in the tree yet starts a random walk, which remembers
+ * only the way it last left each room, so the loops it makes are erased
+ * as it goes. When it reaches the tree, the walk is retraced and added
+ * to it.
+ */
+void wilson(layout& cells, const generator_params& params)
+{
+    using utility::rand;
+
+    const rooms r(cells);
+    std::mt19937 rng(params.seed);
+    std::vector<char> in_tree(r.size(), 0);
+    std::vector<std::uint8_t> way(r.size(), 0); // the neighbour it left by
+    std::size_t next[4], lx[4], ly[4];
+
+    const std::size_t root = rand(rng, 0, r.size());
+    in_tree[root] = 1;
+    r.open(cells, root);
+    for (std::size_t k = 0; k < r.size(); ++k) {
+        for (std::size_t at = k; !in_tree[at]; ) {
+            const std::size_t n = r.neighbours(at, next, lx, ly);
+            way[at] = static_cast<std::uint8_t>(rand(rng, 0, n));
+            at = next[way[at]];
+        }
+        for (std::size_t at = k; !in_tree[at]; ) {
+            r.neighbours(at, next, lx, ly);
+            in_tree[at] = 1;
+            r.open(cells, at);
+            cells.open(lx[way[at]], ly[way[at]]);
+            at = next[way[at]];
+        }
+    }
+}
+
+void backtracker(layout& cells, const generator_params& params)
+{
+    using utility::rand;
+
+    const rooms r(cells);
+    std::mt19937 rng(params.seed);
+    std::vector<char> seen(r.size(), 0);
+    std::vector<std::uint32_t> path; // from the first room to where it digs
+    std::size_t next[4], lx[4], ly[4], fresh[4];
+
+    const std::size_t first = rand(rng, 0, r.size());
+    seen[first] = 1;
+    r.open(cells, first);
+    path.push_back(static_cast<std::uint32_t>(first));
+    while (!path.empty()) {
+        const std::size_t n = r.neighbours(path.back(), next, lx, ly);
+        std::size_t m = 0;
+        for (std::size_t d = 0; d < n; ++d) {
+            if (!seen[next[d]]) { fresh[m++] = d; }
+        }
+        if (m == 0) {
+            path.pop_back();
+            continue;
+        }
+        const std::size_t d = fresh[rand(rng, 0, m)];
+        seen[next[d]] = 1;
+        r.open(cells, next[d]);
+        cells.open(lx[d], ly[d]);
+        path.push_back(static_cast<std::uint32_t>(next[d]));
+    }
+}
+
+std::vector<generator> available_generators()
+{
+    std::vector<generator> out;
+    out.push_back(generator{"random-walk", &random_walk});
+    out.push_back(generator{"eller", &eller});
+    out.push_back(generator{"wilson", &wilson});
+    out.push_back(generator{"backtracker", &backtracker});
+    return out;
+}
+
+generator find_generator(const char* name)
+{
+    for (const auto& g : available_generators()) {
+        if (std::strcmp(g.name, name) == 0) { return g; }
+    }
+    return generator{name, nullptr};
+}
+
+eller_rows::eller_rows(std::size_t width, std::size_t height,
+                       unsigned int seed)
+    : width(width)
+    , height(height)
+    , rooms((width - 1) / 2)
+    , y(0)
+    , rng(seed)
+    , set(rooms)
+    , parent(rooms)
+    , right(rooms, 0)
+    , down(rooms, 0)
+    , label(rooms)
+    , count(rooms)
+    , went(rooms)
+{
+    assert(width % 2 == 1 && height % 2 == 1 && width >= 3 && height >= 3);
+    for (std::size_t i = 0; i < rooms; ++i) {
+        set[i] = static_cast<std::uint32_t>(i);
+    }
+}
+
+std::uint32_t eller_rows::find(std::uint32_t s)
+{
+    while (parent[s] != s) { s = parent[s] = parent[parent[s]]; }
+    return s;
+}
+
+void eller_rows::next(std::vector<char>& row)
+{
+    assert(!done());
+    row.assign(width, 0);
+    if (y == 0 || y + 1 == height) {
+        // the border
+    } else if (y % 2 == 1) {
+        join_rooms(y + 2 == height);
+        for (std::size_t i = 0; i < rooms; ++i) {
+            row[2*i + 1] = 1;
+            row[2*i + 2] = right[i];
+        }
+    } else {
+        // the sets that go on keep their rooms, every other room starts
+        // a set of its own, and they are all numbered from 0 again
+        std::fill(label.begin(), label.end(), std::uint32_t(none));
+        std::uint32_t sets = 0;
+        for (std::size_t i = 0; i < rooms; ++i) {
+            row[2*i + 1] = down[i];
+            if (down[i]) {
+                std::uint32_t& l = label[find(set[i])];
+                if (l == none) { l = sets++; }
+            }
+        }
+        for (std::size_t i = 0; i < rooms; ++i) {
+            set[i] = down[i] ? label[find(set[i])] : sets++;
+        }
+    }
+    ++y;
+}
+
+void eller_rows::join_rooms(bool last)
+{
+    using utility::rand;
+
+    for (std::size_t s = 0; s < rooms; ++s) {
+        parent[s] = static_cast<std::uint32_t>(s);
+    }
+    for (std::size_t i = 0; i + 1 < rooms; ++i) {
+        const std::uint32_t a = find(set[i]), b = find(set[i + 1]);
+        right[i] = a != b && (last || rand(rng, 0, 2));
+        if (right[i]) { parent[a] = b; }
+    }
+    right[rooms - 1] = 0;
+    if (last) { return; }
+
+    // every room goes down by a coin toss, and every set that got none
+    // sends down a room of its own picked at random
+    std::fill(count.begin(), count.end(), 0);
+    std::fill(went.begin(), went.end(), 0);
+    for (std::size_t i = 0; i < rooms; ++i) {
+        const std::uint32_t s = find(set[i]);
+        down[i] = static_cast<char>(rand(rng, 0, 2));
+        went[s] |= down[i];
+        if (rand(rng, 0, ++count[s]) == 0) {
+            label[s] = static_cast<std::uint32_t>(i);
+        }
+    }
+    for (std::size_t i = 0; i < rooms; ++i) {
+        const std::uint32_t s = find(set[i]);
+        if (!went[s]) {
+            down[label[s]] = 1;
+            went[s] = 1;
+        }
+    }
+}
+
+} // end namespace generators
+} /*end namespace*/
@@ -0,0 +1,135 @@
+#ifndef GENERATORS_HPP_GUARD
+#define GENERATORS_HPP_GUARD
+/**
+ * @file generators.hpp
+ * The algorithms a Maze can be laid out with.
+ *
+ * A generator opens cells in a layout that starts out as all walls, and
+ * leaves the objects to the Maze. Apart from the random walk, they all
+ * carve a spanning tree over the rooms, the cells with both coordinates
+ * odd, so the result is a perfect maze: there is exactly one way from
+ * any cell to any other.
+ *
+ *  - random-walk grows walls in random walks from random nodes, each
+ *    only stepping onto nodes that are still open, in tiles on as many
+ *    threads as it is given. The loops it leaves make it the easiest of
+ *    them.
+ *  - eller goes row by row and only keeps the row it is on, see
+ *    eller_rows.
+ *  - wilson joins loop-erased random walks, which picks every spanning
+ *    tree with the same probability. It has no bias, and it is the
+ *    slowest: the first walks are long.
+ *  - backtracker digs depth first, which gives long winding corridors
+ *    with few branches.
+ *
+ * Each of them is a function of the layout and the parameters alone, so
+ * the same seed always gives the same maze, and the thread count never
+ * changes it.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace maps {
+namespace generators {
+
+/**
+ * The cells of a maze, packed the way Maze keeps them: cell (x, y) is
+ * bit x+1 of padded row y+1, and set if it is open. The padding around
+ * the cells is never touched.
+ */
+struct layout {
+    std::size_t width;
+    std::size_t height;
+    std::size_t stride; // words per padded row
+    std::uint64_t* bits;
+
+    bool isOpen(std::size_t x, std::size_t y) const {
+        const std::size_t col = x + 1;
+        return (bits[(y + 1) * stride + col / 64] >> (col % 64)) & 1;
+    }
+    void open(std::size_t x, std::size_t y) {
+        const std::size_t col = x + 1;
+        bits[(y + 1) * stride + col / 64] |= std::uint64_t(1) << (col % 64);
+    }
+    void close(std::size_t x, std::size_t y) {
+        const std::size_t col = x + 1;
+        bits[(y + 1) * stride + col / 64] &= ~(std::uint64_t(1) << (col % 64));
+    }
+};
+
+struct generator_params {
+    unsigned int seed;
+    double density;     // random-walk: walks per node
+    double complexity;  // random-walk: how long a walk goes on
+    std::size_t threads; // 0: one per hardware thread
+};
+
+typedef void (*generate_fn)(layout& cells, const generator_params& params);
+
+struct generator {
+    const char* name;
+    generate_fn run;
+};
+
+void random_walk(layout& cells, const generator_params& params);
+void eller(layout& cells, const generator_params& params);
+void wilson(layout& cells, const generator_params& params);
+void backtracker(layout& cells, const generator_params& params);
+
+/** Every generator there is, random-walk first. */
+std::vector<generator> available_generators();
+
+/** The generator with the given name; run is null if there is none. */
+generator find_generator(const char* name);
+
+/**
+ * Eller's algorithm as a stream of rows of cells, from y = 0 up, so a
+ * maze of any height can go straight to a file or a cache with only
+ * O(width) memory held. The rooms of a row are sorted into sets by
+ * which of them are joined through the rows so far. Rooms next to each
+ * other in different sets are joined at random, and every set goes on
+ * into the next row through at least one room. The last row joins
+ * whatever sets are left.
+ */
+class eller_rows {
+    static const std::uint32_t none = 0xffffffffu;
+
+    std::size_t width;
+    std::size_t height;
+    std::size_t rooms;   // in a row
+    std::size_t y;       // of the next row
+    std::mt19937 rng;
+    std::vector<std::uint32_t> set;     // of every room of the row, compact
+    std::vector<std::uint32_t> parent;  // union-find over the sets
+    std::vector<char> right;            // joined to the next room
+    std::vector<char> down;             // goes on into the next row
+    std::vector<std::uint32_t> label;   // scratch, by set
+    std::vector<std::uint32_t> count;   // scratch, by set
+    std::vector<char> went;             // scratch, by set
+
+    public:
+    /** width and height are in cells, odd and at least 3. */
+    eller_rows(std::size_t width, std::size_t height, unsigned int seed);
+
+    std::size_t getWidth() const { return width; }
+    std::size_t getHeight() const { return height; }
+    bool done() const { return y == height; }
+
+    /** Fills row with the next row of cells, 1 where it is open. */
+    void next(std::vector<char>& row);
+
+    private:
+    std::uint32_t find(std::uint32_t s);
+    void join_rooms(bool last);
+};
+
+} // end namespace generators
+} /*end namespace*/
+
+#endif
@@ -1,64 +1,48 @@
 
+#include "../misc/thread_pool.hpp"
 #include "../misc/utility.hpp"
+#include "exceptions.hpp"
 #include "maze.hpp"
+#include "visibility.hpp"
 
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <thread>
 #include <type_traits>
 
 
 namespace maps {
-/** Initializes the borders and makes all other ground passable */
-void Maze::initialize_maze() {
-    for (size_t i = 1; i < width-1; ++i) {
-        for (size_t j = 1; j < height-1; ++j) {
-            setPath(i, j, PathTypes::NORMAL);
-        }
-    }
-    /* fill borders */
-    for (size_t i = 0; i < width; ++i) {
-        setWall(i, 0, WallTypes::BORDER);
-    }
-    for (size_t j = 0; j < height; ++j) {
-        setWall(0, j, WallTypes::BORDER);
-    }
-}
+/** Lays the paths out with the given generator, then places the objects. */
+void Maze::generate_maze(const generators::generator& how, size_t threads) {
+    /* all walls, the borders and the padding around them included */
+    std::fill(paths.begin(), paths.end(), 0);
+    subtypes.clear();
+    generators::layout cells = {width, height, stride, paths.data()};
+    const generators::generator_params params = {seed, density, complexity,
+        threads};
+    how.run(cells, params);
 
-/** makes the walls of the maze. */
-void Maze::make_walls() {
-    using std::make_pair;
-    using utility::rand;
+    place_treasure_with_guardian_monsters(threads);
+    place_wondering_monsters();
+    place_start();
+    place_end();
+}
 
-    size_t complexity = size_t(this->complexity*(5*(width + height)));
-    size_t density    = size_t(this->density*width/2*height/2);
-
-    for (size_t i = 0; i < density; ++i) {
-        size_t x = rand(0, width/2)*2;
-        size_t y = rand(0, height/2)*2;
-        setWall(x, y, WallTypes::INNER);
-
-        std::vector<std::pair<size_t, size_t>> neigh;
-        neigh.reserve(4);
-        for (size_t j = 0; j < complexity; ++j) {
-            // add all neighbors that are not out of bounds
-            if (x > 1)        { neigh.push_back( make_pair(x-2, y) ); }
-            if (x < height-2) { neigh.push_back( make_pair(x+2, y) ); }
-            if (y > 1)        { neigh.push_back( make_pair(x, y-2) ); }
-            if (y < width-2)  { neigh.push_back( make_pair(x, y+2) ); }
-            if (neigh.size()) { // choose a random neighbor if there are any
-                auto n = neigh[rand(0, neigh.size())];
-                if (isPath(n.first, n.second)) {
-                    auto link = make_pair(
-                            x + static_cast<long long>(n.first - x)/2,
-                            y + static_cast<long long>(n.second - y)/2);
-                    setWall(n.first,    n.second,    WallTypes::INNER);
-                    setWall(link.first, link.second, WallTypes::INNER);
-                    x = n.first;
-                    y = n.second;
-                }
-            }
-            neigh.clear();
-        }
+void Maze::set_subtype(size_t x, size_t y, unsigned int type,
+                       unsigned int usual)
+{
+    const std::uint32_t cell = static_cast<std::uint32_t>(x * height + y);
+    auto it = std::lower_bound(subtypes.begin(), subtypes.end(), cell,
+            [](const subtype& s, std::uint32_t c) { return s.cell < c; });
+    const bool listed = it != subtypes.end() && it->cell == cell;
+    if (type == usual) {
+        if (listed) { subtypes.erase(it); }
+    } else if (listed) {
+        it->type = type;
+    } else {
+        subtypes.insert(it, subtype{cell, type});
     }
-
 }
 
 /**
@@ -76,48 +60,64 @@ void Maze::make_walls() {
  * </pre>
  * For the above maze, the function returns
  * ((4,1)(-1,0))
+ *
+ * The rows are searched in chunks on up to threads threads, and the ends
+ * come out in row order all the same.
  */
 std::vector<std::pair<std::pair<size_t, size_t>, std::pair<int, int>>>
-Maze::find_blind_ends() {
+Maze::find_blind_ends(size_t threads) {
     using std::make_pair;
     using std::pair;
+    typedef std::vector<pair<pair<size_t, size_t>, pair<int, int>>> ends;
 
-    std::vector<pair<pair<size_t, size_t>, pair<int, int>>> koti;
-    std::vector<pair<size_t, size_t>> neighbors
+    const std::vector<pair<size_t, size_t>> neighbors
         {
             make_pair(-1,1),  make_pair(0,1),  make_pair(1,1),
             make_pair(-1,0),                   make_pair(1,0),
             make_pair(-1,-1), make_pair(0,-1), make_pair(1,-1)
         };
 
-    for (size_t row = 1; row < height-1; ++row) {
-        for (size_t col = 1; col < width-1; ++col) {
-            if (isWall(col, row)) { continue; }
-
-            auto monster = make_pair(0,0);
-            size_t kot = 0;
-            for (auto n : neighbors) {
-                auto x = col + n.first;
-                auto y = row + n.second;
-                if (isWall(x, y)) {
-                    kot += 1;
-                } else {
-                    monster = n;
+    const size_t rows = height - 2, grain = 64;
+    std::vector<ends> found(utility::thread_pool::chunk_count(rows, grain));
+    auto work = [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t row = begin + 1; row < end + 1; ++row) {
+            for (size_t col = 1; col < width-1; ++col) {
+                if (isWall(col, row)) { continue; }
+
+                auto monster = make_pair(0,0);
+                size_t kot = 0;
+                for (auto n : neighbors) {
+                    auto x = col + n.first;
+                    auto y = row + n.second;
+                    if (isWall(x, y)) {
+                        kot += 1;
+                    } else {
+                        monster = n;
+                    }
+                }
+                if (kot == 7) {
+                    found[chunk].push_back(make_pair(make_pair(col, row),monster));
                 }
-            }
-            if (kot == 7) {
-                koti.push_back(make_pair(make_pair(col, row),monster));
             }
         }
+    };
+    const size_t workers = threads ? threads
+        : std::max(1u, std::thread::hardware_concurrency());
+    utility::thread_pool pool(std::min(workers, found.size()));
+    pool.parallel_for(rows, grain, work);
+
+    ends koti;
+    for (const auto& f : found) {
+        koti.insert(koti.end(), f.begin(), f.end());
     }
     return koti;
 }
 
-void Maze::place_treasure_with_guardian_monsters() {
+void Maze::place_treasure_with_guardian_monsters(size_t threads) {
     using std::make_pair;
     using utility::random_shuffle;
-    auto koti = find_blind_ends();
-    random_shuffle(koti);
+    auto koti = find_blind_ends(threads);
+    random_shuffle(koti, rng);
 
     size_t how_many_monsters = 10;
     treasure.reserve(how_many_monsters);
@@ -150,8 +150,8 @@ void Maze::place_wondering_monsters()
     using utility::rand;
     /* wondering monsters */
     for (size_t i = 1; i < 40; i++) {
-        size_t w = rand(1, width-1);
-        size_t h = rand(1, height-1);
+        size_t w = rand(rng, 1, width-1);
+        size_t h = rand(rng, 1, height-1);
         if (isPath(w, h)) {
             monsters.push_back(
                     Object{
@@ -182,7 +182,7 @@ void Maze::place_start()
     using std::make_pair;
     using utility::rand;
     do { // try to get a good start position
-        start = make_pair(rand(1,width-1), rand(1, height-1));
+        start = make_pair(rand(rng, 1,width-1), rand(rng, 1, height-1));
         // and repeat if we failed and the found coordinates are in the
         // center third
     } while (!(
@@ -200,11 +200,368 @@ void Maze::place_end() {
     auto start_quadrant = quadrant(start.first, start.second);
 
     do {
-        finish = make_pair(rand(1, width-1), rand(1, height-1));
+        finish = make_pair(rand(rng, 1, width-1), rand(rng, 1, height-1));
     } while (!(
                 !is_in_center_third(finish.first, finish.second) &&
-                start_quadrant != quadrant(finish.first, finish.second)
+                start_quadrant != quadrant(finish.first, finish.second) &&
+                isPath(finish.first, finish.second)
               ));
 }
 
+Maze::Maze(size_t width, size_t height, double difficulty,
+        unsigned int seed, const std::string& generator, no_generation)
+    : width(width)
+    , height(height)
+    , difficulty(difficulty)
+    , seed(seed)
+    , generator(generator)
+    , density(0.75)
+    , complexity(0.75)
+    , stride((width + 2 + 63) / 64)
+    , paths((height + 2) * stride, 0)
+    , subtypes()
+    , monsters()
+    , treasure()
+    , start(0,0)
+    , finish(0,0)
+    , rng(seed)
+    , pvs_radius(0)
+    , pvs_cells()
+    , pvs_bits()
+{
+}
+
+bool Maze::trace_visibility(size_t ax, size_t ay, size_t bx, size_t by) const
+{
+    return line_of_sight(*this, ax, ay, bx, by);
+}
+
+void Maze::precomputeVisibility(unsigned int radius, size_t threads)
+{
+    assert(radius > 0 && 2*radius + 1 <= 0xffff);
+    assert(width <= 0xffff && height <= 0xffff);
+
+    // every chunk of cells fills its own part, and the parts are joined in
+    // chunk order, so the result does not depend on the thread count
+    struct part {
+        std::vector<pvs_cell> cells;
+        std::vector<std::uint64_t> bits;
+        part() : cells(), bits() {}
+    };
+    const size_t n = width * height;
+    const size_t grain = 256;
+    std::vector<part> parts(utility::thread_pool::chunk_count(n, grain));
+    const long r = radius;
+
+    auto work = [&](size_t chunk, size_t begin, size_t end) {
+        part& out = parts[chunk];
+        std::vector<std::pair<long, long>> seen;
+        for (size_t c = begin; c < end; ++c) {
+            const long x = c / height, y = c % height;
+            pvs_cell cell = {static_cast<std::uint32_t>(out.bits.size()),
+                0, 0, 0, 0};
+            seen.clear();
+            if (isPath(x, y)) {
+                for (long bx = std::max(0L, x - r);
+                        bx <= std::min(long(width) - 1, x + r); ++bx) {
+                    for (long by = std::max(0L, y - r);
+                            by <= std::min(long(height) - 1, y + r); ++by) {
+                        const long dx = bx - x, dy = by - y;
+                        if (dx*dx + dy*dy <= r*r &&
+                                line_of_sight(*this, x, y, bx, by)) {
+                            seen.push_back(std::make_pair(bx, by));
+                        }
+                    }
+                }
+            }
+            if (!seen.empty()) {
+                long x0 = x, x1 = x, y0 = y, y1 = y;
+                for (auto& p : seen) {
+                    x0 = std::min(x0, p.first);
+                    x1 = std::max(x1, p.first);
+                    y0 = std::min(y0, p.second);
+                    y1 = std::max(y1, p.second);
+                }
+                cell.x0 = static_cast<std::uint16_t>(x0);
+                cell.y0 = static_cast<std::uint16_t>(y0);
+                cell.w = static_cast<std::uint16_t>(x1 - x0 + 1);
+                cell.h = static_cast<std::uint16_t>(y1 - y0 + 1);
+                out.bits.resize(out.bits.size() + (cell.w * cell.h + 63) / 64);
+                for (auto& p : seen) {
+                    size_t bit = (p.first - x0) * cell.h + (p.second - y0);
+                    out.bits[cell.offset + bit / 64] |=
+                        std::uint64_t(1) << (bit % 64);
+                }
+            }
+            out.cells.push_back(cell);
+        }
+    };
+    utility::thread_pool pool(threads);
+    pool.parallel_for(n, grain, work);
+
+    pvs_cells.clear();
+    pvs_bits.clear();
+    pvs_cells.reserve(n);
+    for (auto& p : parts) {
+        const std::uint32_t base = static_cast<std::uint32_t>(pvs_bits.size());
+        for (auto c : p.cells) {
+            c.offset += base;
+            pvs_cells.push_back(c);
+        }
+        pvs_bits.insert(pvs_bits.end(), p.bits.begin(), p.bits.end());
+    }
+    pvs_radius = radius;
+}
+
+/*
+ * save() and load() write everything little-endian in fixed widths.
+ * Version 1 had 32 bits per cell, a kind in the top byte and a subtype
+ * below; version 2 has the grid words and the subtypes as they are kept,
+ * and version 3 adds the generator's name after the seed. The older ones
+ * were all random walks.
+ */
+namespace {
+    const char maze_magic[4] = {'H', 'X', 'M', 'Z'};
+    const std::uint32_t maze_version = 3;
+    const std::uint32_t max_name_length = 255;
+    const std::uint32_t v1_kind_mask = 0xff000000;
+    const std::uint32_t v1_path = 0x01000000;
+    const std::uint32_t v1_wall = 0x02000000;
+    // the last of each enum, to tell a subtype from a stray number
+    const unsigned int last_wall_type = static_cast<unsigned int>(WallTypes::INNER);
+    const unsigned int last_path_type = static_cast<unsigned int>(PathTypes::GRASSY);
+
+    void put(std::ostream& out, std::uint64_t v, unsigned bytes) {
+        char b[8];
+        for (unsigned i = 0; i < bytes; ++i) {
+            b[i] = static_cast<char>(v >> (8 * i));
+        }
+        out.write(b, bytes);
+    }
+
+    void put_f64(std::ostream& out, double v) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put(out, bits, 8);
+    }
+
+    std::uint64_t get(std::istream& in, unsigned bytes) {
+        unsigned char b[8];
+        if (!in.read(reinterpret_cast<char*>(b), bytes)) {
+            throw err::bad_format() << err::reason("unexpected end of maze");
+        }
+        std::uint64_t v = 0;
+        for (unsigned i = 0; i < bytes; ++i) {
+            v |= std::uint64_t(b[i]) << (8 * i);
+        }
+        return v;
+    }
+
+    double get_f64(std::istream& in) {
+        std::uint64_t bits = get(in, 8);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    void put_objects(std::ostream& out, const std::vector<Object>& objects) {
+        put(out, objects.size(), 4);
+        for (auto& o : objects) {
+            put(out, o.position.first, 4);
+            put(out, o.position.second, 4);
+            put(out, static_cast<std::uint64_t>(o.type), 4);
+            put(out, o.value, 4);
+        }
+    }
+
+    void get_objects(std::istream& in, std::vector<Object>& objects,
+                     size_t width, size_t height) {
+        objects.clear();
+        for (std::uint64_t n = get(in, 4); n > 0; --n) {
+            size_t x = get(in, 4);
+            size_t y = get(in, 4);
+            ObjectType type = static_cast<ObjectType>(get(in, 4));
+            unsigned int value = static_cast<unsigned int>(get(in, 4));
+            if (x >= width || y >= height) {
+                throw err::bad_format() << err::reason("object off the maze");
+            }
+            objects.push_back(Object{std::make_pair(x, y), type, value});
+        }
+    }
+} // end anonymous namespace
+
+void Maze::save(std::ostream& out) const
+{
+    out.write(maze_magic, sizeof(maze_magic));
+    put(out, maze_version, 4);
+    put(out, width, 4);
+    put(out, height, 4);
+    put_f64(out, difficulty);
+    put(out, seed, 4);
+    put(out, generator.size(), 4);
+    out.write(generator.data(), generator.size());
+    put_f64(out, density);
+    put_f64(out, complexity);
+    for (auto w : paths) {
+        put(out, w, 8);
+    }
+    put(out, subtypes.size(), 4);
+    for (auto& t : subtypes) {
+        put(out, t.cell, 4);
+        put(out, t.type, 4);
+    }
+    put_objects(out, monsters);
+    put_objects(out, treasure);
+    put(out, start.first, 4);
+    put(out, start.second, 4);
+    put(out, finish.first, 4);
+    put(out, finish.second, 4);
+
+    put(out, pvs_radius, 4);
+    if (pvs_radius) {
+        for (auto& c : pvs_cells) {
+            put(out, c.offset, 4);
+            put(out, c.x0, 2);
+            put(out, c.y0, 2);
+            put(out, c.w, 2);
+            put(out, c.h, 2);
+        }
+        put(out, pvs_bits.size(), 8);
+        for (auto w : pvs_bits) {
+            put(out, w, 8);
+        }
+    }
+}
+
+Maze Maze::load(std::istream& in)
+{
+    char magic[sizeof(maze_magic)];
+    if (!in.read(magic, sizeof(magic)) ||
+            std::memcmp(magic, maze_magic, sizeof(magic)) != 0) {
+        throw err::bad_format() << err::reason("not a maze");
+    }
+    const std::uint64_t version = get(in, 4);
+    if (version < 1 || version > maze_version) {
+        throw err::bad_format() << err::reason("unsupported maze version");
+    }
+    size_t width = get(in, 4);
+    size_t height = get(in, 4);
+    if (width == 0 || height == 0 || width > 0xffff || height > 0xffff) {
+        throw err::bad_format() << err::reason("bad maze size");
+    }
+    double difficulty = get_f64(in);
+    unsigned int seed = static_cast<unsigned int>(get(in, 4));
+    std::string generator = "random-walk";
+    if (version >= 3) {
+        const std::uint64_t length = get(in, 4);
+        if (length > max_name_length) {
+            throw err::bad_format() << err::reason("bad generator name");
+        }
+        generator.resize(length);
+        if (!in.read(&generator[0], length)) {
+            throw err::bad_format() << err::reason("unexpected end of maze");
+        }
+    }
+
+    Maze m(width, height, difficulty, seed, generator, no_generation());
+    m.density = get_f64(in);
+    m.complexity = get_f64(in);
+    if (version == 1) {
+        for (size_t x = 0; x < width; ++x) {
+            for (size_t y = 0; y < height; ++y) {
+                const std::uint32_t v = static_cast<std::uint32_t>(get(in, 4));
+                const unsigned int type = v & ~v1_kind_mask;
+                if ((v & v1_kind_mask) == v1_path && type <= last_path_type) {
+                    m.setPath(x, y, static_cast<PathTypes>(type));
+                } else if ((v & v1_kind_mask) == v1_wall &&
+                        type <= last_wall_type) {
+                    m.setWall(x, y, static_cast<WallTypes>(type));
+                } else if (v == 0) {
+                    // the right and bottom borders used to be left unset
+                    m.setWall(x, y, m.usual_wall(x, y));
+                } else {
+                    throw err::bad_format() << err::reason("bad maze cell");
+                }
+            }
+        }
+    } else {
+        for (auto& w : m.paths) {
+            w = get(in, 8);
+        }
+        for (size_t row = 0; row < height + 2; ++row) {
+            for (size_t col = 0; col < m.stride * 64; ++col) {
+                const bool on_maze = row >= 1 && row <= height &&
+                    col >= 1 && col <= width;
+                if (!on_maze && m.open_bit(col, row)) {
+                    throw err::bad_format() << err::reason("path off the maze");
+                }
+            }
+        }
+        for (std::uint64_t n = get(in, 4); n > 0; --n) {
+            const std::uint32_t cell = static_cast<std::uint32_t>(get(in, 4));
+            const unsigned int type = static_cast<unsigned int>(get(in, 4));
+            if (cell >= width * height ||
+                    (!m.subtypes.empty() && m.subtypes.back().cell >= cell)) {
+                throw err::bad_format() << err::reason("bad cell subtype");
+            }
+            // a path's subtype has to be a path type, a wall's a wall type,
+            // and neither is listed if it is the usual one
+            const size_t x = cell / height, y = cell % height;
+            const bool open = m.isPath(x, y);
+            const unsigned int usual = open
+                ? static_cast<unsigned int>(PathTypes::NORMAL)
+                : static_cast<unsigned int>(m.usual_wall(x, y));
+            if (type > (open ? last_path_type : last_wall_type) ||
+                    type == usual) {
+                throw err::bad_format() << err::reason("bad cell subtype");
+            }
+            m.subtypes.push_back(subtype{cell, type});
+        }
+    }
+    get_objects(in, m.monsters, width, height);
+    get_objects(in, m.treasure, width, height);
+    m.start.first = get(in, 4);
+    m.start.second = get(in, 4);
+    m.finish.first = get(in, 4);
+    m.finish.second = get(in, 4);
+    if (m.start.first >= width || m.start.second >= height ||
+            m.finish.first >= width || m.finish.second >= height) {
+        throw err::bad_format() << err::reason("start or finish off the maze");
+    }
+
+    unsigned int radius = static_cast<unsigned int>(get(in, 4));
+    if (radius) {
+        m.pvs_cells.resize(width * height);
+        for (auto& c : m.pvs_cells) {
+            c.offset = static_cast<std::uint32_t>(get(in, 4));
+            c.x0 = static_cast<std::uint16_t>(get(in, 2));
+            c.y0 = static_cast<std::uint16_t>(get(in, 2));
+            c.w = static_cast<std::uint16_t>(get(in, 2));
+            c.h = static_cast<std::uint16_t>(get(in, 2));
+        }
+        std::uint64_t words = get(in, 8);
+        std::uint64_t boxes = 0; // words all the boxes take together
+        for (auto& c : m.pvs_cells) {
+            boxes += (size_t(c.w) * c.h + 63) / 64;
+        }
+        if (words > boxes) {
+            throw err::bad_format() << err::reason("bad visible set");
+        }
+        for (auto& c : m.pvs_cells) {
+            if (c.x0 + size_t(c.w) > width || c.y0 + size_t(c.h) > height ||
+                    c.offset + (size_t(c.w) * c.h + 63) / 64 > words) {
+                throw err::bad_format() << err::reason("bad visible set");
+            }
+        }
+        // grown as the words come in, so a count the file does not back
+        // up runs out of data before it runs out of memory
+        m.pvs_bits.reserve(std::min<std::uint64_t>(words, 1 << 20));
+        for (std::uint64_t i = 0; i < words; ++i) {
+            m.pvs_bits.push_back(get(in, 8));
+        }
+        m.pvs_radius = radius;
+    }
+    return m;
+}
+
 } //end namespace maps
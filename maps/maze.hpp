@@ -2,14 +2,29 @@
 #define MAZE_HPP_GUARD
 /**
  * @file maze.hpp
- * 
+ *
+ * The grid is kept as one bit per cell, set for paths, in rows of 64-bit
+ * words: row y + 1 holds cells (x, y) at bit x + 1. A row and a column of
+ * walls pad the maze on every side, so the cells around any cell on the
+ * maze can be read without checking for the edge. Wall and path subtypes
+ * are nearly always the usual ones (a border wall on the edge, an inner
+ * wall inside, a normal path), so only the cells where they are not are
+ * listed on the side.
  *
  * @author Gašper Ažman, gasper.azman@gmail.com
  * @since 2012-05-01
  */
 
-#include <boost/multi_array.hpp>
+#include "generators.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace maps {
 
@@ -39,149 +54,269 @@ struct Object {
 };
 
 class Maze {
+    friend class chunked_maze; // opens the doors between its chunks
+
     private:
-    enum class FieldTypes : unsigned int {
-        TYPE_MASK = 0xff000000,
-        PATH = 0x01000000,
-        WALL = 0x02000000,
+    /** A cell whose subtype is not the usual one for what it is. */
+    struct subtype {
+        std::uint32_t cell; // x * height + y
+        unsigned int type;  // a WallTypes or a PathTypes
     };
 
-    typedef boost::multi_array<FieldTypes, 2> maze_type;
-
     size_t width;
     size_t height;
 
     double difficulty;
+    unsigned int seed;
+    std::string generator; // its name in generators::available_generators()
 
     double density;
     double complexity;
 
-    decltype(boost::extents[width][height]) shape;
-    maze_type maze;
+    size_t stride; // words per row, padding included
+    std::vector<std::uint64_t> paths; // (height + 2) rows of stride words
+    std::vector<subtype> subtypes; // by cell
 
     std::vector<Object> monsters;
     std::vector<Object> treasure;
     std::pair<size_t, size_t> start;
     std::pair<size_t, size_t> finish;
 
+    // only used while generating; the same seed always gives the same maze
+    std::mt19937 rng;
+
+    /* potentially visible sets, see precomputeVisibility() */
+    struct pvs_cell {
+        std::uint32_t offset; // first word in pvs_bits
+        std::uint16_t x0, y0; // bounding box of the visible cells
+        std::uint16_t w, h;
+    };
+    unsigned int pvs_radius; // 0 if there are none
+    std::vector<pvs_cell> pvs_cells; // by x * height + y
+    std::vector<std::uint64_t> pvs_bits;
+
+    struct no_generation {};
+    Maze(size_t width, size_t height, double difficulty, unsigned int seed,
+         const std::string& generator, no_generation);
+
+    bool trace_visibility(size_t ax, size_t ay, size_t bx, size_t by) const;
+
     std::vector<std::pair<std::pair<size_t, size_t>, std::pair<int, int>>>
-    find_blind_ends();
+    find_blind_ends(size_t threads);
     bool is_in_center_third(size_t x, size_t y);
     std::pair<size_t, size_t> quadrant(size_t x, size_t y);
 
-    void initialize_maze();
-    void make_walls();
-    void place_treasure_with_guardian_monsters();
+    void generate_maze(const generators::generator& how, size_t threads);
+    void place_treasure_with_guardian_monsters(size_t threads);
     void place_wondering_monsters();
     void place_start();
     void place_end();
 
-    inline void
-    generate_maze()
-    {
-        initialize_maze();
-        make_walls();
-        place_treasure_with_guardian_monsters();
-        place_wondering_monsters();
-        place_start();
-        place_end();
-    }
-
     inline void
     setPath(size_t x, size_t y, PathTypes t) {
-//        std::cerr << "x: " << x << " y: " << y << std::endl;
         assert(x < width);
         assert(y < height);
-        using ult = std::underlying_type<FieldTypes>::type;
-        maze[x][y] = static_cast<FieldTypes>(
-                static_cast<ult>(t) |
-                static_cast<ult>(FieldTypes::PATH)
-                );
+        const size_t col = x + 1;
+        paths[(y + 1) * stride + col / 64] |= std::uint64_t(1) << (col % 64);
+        set_subtype(x, y, static_cast<unsigned int>(t),
+                static_cast<unsigned int>(PathTypes::NORMAL));
     }
 
     inline void
     setWall(size_t x, size_t y, WallTypes t) {
-//        std::cerr << "x: " << x << " y: " << y << std::endl;
         assert(x < width);
         assert(y < height);
-        using ult = std::underlying_type<FieldTypes>::type;
-        maze[x][y] = static_cast<FieldTypes>(
-                static_cast<ult>(t) |
-                static_cast<ult>(FieldTypes::WALL)
-                );
+        const size_t col = x + 1;
+        paths[(y + 1) * stride + col / 64] &= ~(std::uint64_t(1) << (col % 64));
+        set_subtype(x, y, static_cast<unsigned int>(t),
+                static_cast<unsigned int>(usual_wall(x, y)));
     }
 
-    inline FieldTypes
-    getType(size_t x, size_t y) const {
-        assert(x < width);
-        assert(y < height);
-        return
-            static_cast<FieldTypes>(
-                static_cast<unsigned int>(maze[x][y]) &
-                static_cast<unsigned int>(FieldTypes::TYPE_MASK));
+    /** The bit of padded column col in padded row row. */
+    inline bool
+    open_bit(size_t col, size_t row) const {
+        return (paths[row * stride + col / 64] >> (col % 64)) & 1;
+    }
+
+    inline WallTypes
+    usual_wall(size_t x, size_t y) const {
+        return x == 0 || y == 0 || x + 1 == width || y + 1 == height
+            ? WallTypes::BORDER : WallTypes::INNER;
+    }
+
+    inline unsigned int
+    get_subtype(size_t x, size_t y, unsigned int usual) const {
+        const std::uint32_t cell = static_cast<std::uint32_t>(x * height + y);
+        auto it = std::lower_bound(subtypes.begin(), subtypes.end(), cell,
+                [](const subtype& s, std::uint32_t c) { return s.cell < c; });
+        return it != subtypes.end() && it->cell == cell ? it->type : usual;
     }
 
+    void set_subtype(size_t x, size_t y, unsigned int type, unsigned int usual);
+
     public:
 
-    Maze(size_t width, size_t height, double difficulty)
+    /**
+     * Generates a maze with the random-walk generator, growing its walls
+     * and looking for the blind ends to put treasure in on the given
+     * number of threads (0: one per hardware thread). The maze only
+     * depends on the size, the difficulty and the seed, never on the
+     * threads.
+     */
+    Maze(size_t width, size_t height, double difficulty,
+            unsigned int seed = 1, size_t threads = 0)
+        : Maze(width, height, difficulty, seed,
+                generators::generator{"random-walk", &generators::random_walk},
+                threads)
+    {}
+
+    /**
+     * Generates a maze with the given generator, see generators.hpp. The
+     * maze keeps its name, so find_generator(getGenerator()) builds it
+     * again from the same size, difficulty and seed.
+     */
+    Maze(size_t width, size_t height, double difficulty, unsigned int seed,
+            const generators::generator& how, size_t threads = 0)
         : width( (width/2)  * 2 + 1)
         , height((height/2) * 2 + 1)
         , difficulty(difficulty)
+        , seed(seed)
+        , generator(how.name)
         , density(0.75)
         , complexity(0.75)
-        , shape(boost::extents[width][height])
-        , maze(shape)
+        , stride((this->width + 2 + 63) / 64)
+        , paths((this->height + 2) * stride, 0)
+        , subtypes()
         , monsters()
         , treasure()
         , start(0,0)
         , finish(0,0)
+        , rng(seed)
+        , pvs_radius(0)
+        , pvs_cells()
+        , pvs_bits()
     {
-        generate_maze();
+        generate_maze(how, threads);
     }
 
+    /** Reads a maze written by save(); throws err::bad_format. */
+    static Maze load(std::istream& in);
+
+    /** Writes the maze, and its visible sets if it has them. */
+    void save(std::ostream& out) const;
+
     inline bool
     isWall(size_t x, size_t y) const {
         assert(x < width);
         assert(y < height);
-        return getType(x, y) == FieldTypes::WALL;
+        return !open_bit(x + 1, y + 1);
     }
 
     inline bool
     isPath(size_t x, size_t y) const {
         assert(x < width);
         assert(y < height);
-        return getType(x, y) == FieldTypes::PATH;
+        return open_bit(x + 1, y + 1);
+    }
+
+    /** isPath() for any cell; everything off the maze is a wall. */
+    inline bool
+    isOpen(long x, long y) const {
+        // the padding covers one cell past every edge
+        const unsigned long col = x + 1, row = y + 1;
+        return col <= width + 1 && row <= height + 1 && open_bit(col, row);
+    }
+
+    /**
+     * Which of the four cells next to one on the maze are paths, as bits:
+     * 1 for (x + 1, y), 2 for (x - 1, y), 4 for (x, y + 1), 8 for (x, y - 1).
+     * Anything off the maze is a wall.
+     */
+    inline unsigned int
+    openNeighbours(size_t x, size_t y) const {
+        assert(x < width);
+        assert(y < height);
+        const size_t col = x + 1, row = y + 1;
+        return open_bit(col + 1, row)
+            | open_bit(col - 1, row) << 1
+            | open_bit(col, row + 1) << 2
+            | open_bit(col, row - 1) << 3;
     }
 
     inline WallTypes
     getWallType(size_t x, size_t y) const {
         assert(x < width);
         assert(y < height);
-        assert(getType(x, y) == FieldTypes::WALL);
-        using ult = std::underlying_type<FieldTypes>::type;
-        return static_cast<WallTypes>(
-                    static_cast<ult>(maze[x][y]) &
-                    ~static_cast<ult>(FieldTypes::TYPE_MASK)
-                );
+        assert(isWall(x, y));
+        return static_cast<WallTypes>(get_subtype(x, y,
+                    static_cast<unsigned int>(usual_wall(x, y))));
     }
 
     inline PathTypes
     getPathType(size_t x, size_t y) const {
         assert(x < width);
         assert(y < height);
-        assert(getType(x, y) == FieldTypes::WALL);
-        using ult = std::underlying_type<FieldTypes>::type;
-        return static_cast<PathTypes>(
-                    static_cast<ult>(maze[x][y]) &
-                    ~static_cast<ult>(FieldTypes::TYPE_MASK)
-                );
+        assert(isPath(x, y));
+        return static_cast<PathTypes>(get_subtype(x, y,
+                    static_cast<unsigned int>(PathTypes::NORMAL)));
     }
 
+    /** Memory taken by the grid and its subtypes. */
+    size_t getGridBytes() const {
+        return paths.size() * sizeof(std::uint64_t)
+            + subtypes.size() * sizeof(subtype);
+    }
+
+    double getDifficulty() const { return difficulty; }
+    unsigned int getSeed() const { return seed; }
+    /** The name of the generator that laid it out, see find_generator(). */
+    const std::string& getGenerator() const { return generator; }
+
     decltype(width)  getWidth()  const { return width; }
     decltype(height) getHeight() const { return height; }
 
     decltype(start) getStart() const { return start; }
     decltype(finish) getFinish() const { return finish; }
+
+    const std::vector<Object>& getMonsters() const { return monsters; }
+    const std::vector<Object>& getTreasure() const { return treasure; }
+
+    /**
+     * Works out, for every path cell, which cells within radius it can
+     * see (see visibility.hpp), split over the given number of threads
+     * (0: one per hardware thread). Each set is a bitset over the bounding
+     * box of the visible cells, which in a maze is mostly narrow.
+     */
+    void precomputeVisibility(unsigned int radius, size_t threads = 0);
+
+    bool hasVisibility() const { return pvs_radius != 0; }
+    unsigned int getVisibilityRadius() const { return pvs_radius; }
+    /** Memory taken by the visible sets. */
+    size_t getVisibilityBytes() const {
+        return pvs_cells.size() * sizeof(pvs_cell)
+            + pvs_bits.size() * sizeof(std::uint64_t);
+    }
+
+    /**
+     * maps::line_of_sight(), answered with a single bit test from the
+     * visible sets when there are any and b is within their radius of a.
+     */
+    inline bool
+    isVisible(size_t ax, size_t ay, size_t bx, size_t by) const {
+        assert(ax < width && ay < height && bx < width && by < height);
+        const long dx = long(bx) - long(ax), dy = long(by) - long(ay);
+        if (pvs_radius && dx*dx + dy*dy <= long(pvs_radius * pvs_radius)
+                && isPath(ax, ay)) {
+            const pvs_cell& c = pvs_cells[ax * height + ay];
+            if (bx < c.x0 || by < c.y0 ||
+                    bx - c.x0 >= c.w || by - c.y0 >= c.h) {
+                return false;
+            }
+            const size_t bit = (bx - c.x0) * c.h + (by - c.y0);
+            return (pvs_bits[c.offset + bit / 64] >> (bit % 64)) & 1;
+        }
+        return trace_visibility(ax, ay, bx, by);
+    }
 };
 } // end namespace maps
 
@@ -0,0 +1,193 @@
+/**
+ * @file maze_bench.cpp
+ *  BENCHMARK FOR MAZE GENERATION
+ *
+ * Runs every requested generator for every side and thread count, once on
+ * a bare layout and once in a whole Maze, which places the objects too.
+ * Prints how long the generator took and the cells it laid out per
+ * microsecond, how long the Maze took, and a hash of the grid, which has
+ * to be the same for every thread count. Only random-walk uses more than
+ * one thread. For eller the rows are also streamed on their own, without
+ * a grid to put them in, which is what a file or a chunk cache would get;
+ * that shows as eller-rows, and its hash has to match eller's.
+ *
+ * usage: maze_bench [--generators=random-walk,eller,...]
+ *                   [--sizes=101,1001,...] [--threads=1,2,...]
+ *                   [--seed=N] [--difficulty=F]
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "maze.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct options {
+    std::vector<std::string> generators;
+    std::vector<std::size_t> sizes;
+    std::vector<std::size_t> threads;
+    unsigned seed;
+    double difficulty;
+};
+
+std::vector<std::string>
+parse_names(const std::string& s)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        out.push_back(item);
+    }
+    return out;
+}
+
+std::vector<std::size_t>
+parse_list(const std::string& s)
+{
+    std::vector<std::size_t> out;
+    for (const auto& item : parse_names(s)) {
+        out.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return out;
+}
+
+options
+parse_options(int argc, char* argv[])
+{
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    options o{{}, {101, 1001, 4001}, {1}, 1, 1};
+    if (cores > 1) { o.threads.push_back(cores); }
+    for (const auto& g : maps::generators::available_generators()) {
+        o.generators.push_back(g.name);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string key = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') == std::string::npos
+            ? "" : arg.substr(arg.find('=') + 1);
+        if      (key == "--generators") { o.generators = parse_names(value); }
+        else if (key == "--sizes")      { o.sizes = parse_list(value); }
+        else if (key == "--threads")    { o.threads = parse_list(value); }
+        else if (key == "--seed")       { o.seed = std::atoi(value.c_str()); }
+        else if (key == "--difficulty") { o.difficulty = std::atof(value.c_str()); }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    for (const auto& g : o.generators) {
+        if (!maps::generators::find_generator(g.c_str()).run) {
+            std::cerr << "no generator " << g << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return o;
+}
+
+const std::uint64_t fnv_basis = 14695981039346656037ull;
+
+std::uint64_t
+fnv(std::uint64_t h, bool open)
+{
+    return (h ^ open) * 1099511628211ull;
+}
+
+/** FNV-1a over the cells, row by row. */
+template <typename Grid>
+std::uint64_t
+grid_hash(const Grid& cells, std::size_t width, std::size_t height)
+{
+    std::uint64_t h = fnv_basis;
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            h = fnv(h, cells.isOpen(x, y));
+        }
+    }
+    return h;
+}
+
+double
+seconds_since(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count();
+}
+
+void
+print(const std::string& name, std::size_t side, std::size_t threads,
+      double seconds, double maze_seconds, std::uint64_t hash)
+{
+    const double cells = double(side) * side;
+    std::cout << name << "\t" << side << "\t" << threads << "\t"
+              << seconds * 1e3 << "\t" << cells / seconds / 1e6 << "\t";
+    if (maze_seconds > 0) {
+        std::cout << maze_seconds * 1e3;
+    } else {
+        std::cout << "-";
+    }
+    std::cout << "\t" << std::hex << hash << std::dec << std::endl;
+}
+
+} // end anonymous namespace
+
+int main( int argc, char *argv[] )
+{
+    const options o = parse_options(argc, argv);
+    std::cout << "generator\tside\tthreads\tms\tcells/us\tmaze_ms\thash"
+              << std::endl;
+    for (const auto& name : o.generators) {
+        const auto how = maps::generators::find_generator(name.c_str());
+        for (auto side : o.sizes) {
+            side |= 1; // Maze only copes with odd sides
+            for (auto threads : o.threads) {
+                if (how.run != &maps::generators::random_walk &&
+                        threads != o.threads.front()) {
+                    continue; // the others only ever use one
+                }
+                // laid out the way Maze keeps its grid, see maze.hpp
+                const std::size_t stride = (side + 2 + 63) / 64;
+                std::vector<std::uint64_t> bits((side + 2) * stride, 0);
+                maps::generators::layout cells = {side, side, stride, bits.data()};
+                const maps::generators::generator_params params = {o.seed,
+                    0.75, 0.75, threads};
+                auto begin = std::chrono::steady_clock::now();
+                how.run(cells, params);
+                const double seconds = seconds_since(begin);
+
+                begin = std::chrono::steady_clock::now();
+                maps::Maze maze(side, side, o.difficulty, o.seed, how, threads);
+                const double maze_seconds = seconds_since(begin);
+                const std::uint64_t hash = grid_hash(cells, side, side);
+                if (grid_hash(maze, side, side) != hash) {
+                    std::cerr << name << " laid out a different maze in a Maze"
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                print(name, side, threads, seconds, maze_seconds, hash);
+            }
+            if (how.run == &maps::generators::eller) {
+                const auto begin = std::chrono::steady_clock::now();
+                maps::generators::eller_rows rows(side, side, o.seed);
+                std::vector<char> row;
+                std::uint64_t h = fnv_basis;
+                while (!rows.done()) {
+                    rows.next(row);
+                    for (auto open : row) { h = fnv(h, open); }
+                }
+                print("eller-rows", side, 1, seconds_since(begin), 0, h);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
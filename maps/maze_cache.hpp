@@ -0,0 +1,84 @@
+#ifndef MAZE_CACHE_HPP_GUARD
+#define MAZE_CACHE_HPP_GUARD
+/**
+ * @file maze_cache.hpp
+ * Shares generated mazes between everyone who asks for the same one.
+ *
+ * A maze is fully determined by its size, difficulty, seed and generator
+ * and never changes after it is generated, so any number of matches can
+ * run on one copy. The cache only holds weak references: a maze goes
+ * away with the last match that uses it.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "maze.hpp"
+
+#include <cassert>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace maps {
+
+class maze_cache {
+    typedef std::tuple<size_t, size_t, double, unsigned int, std::string> key;
+
+    std::mutex mutex;
+    std::map<key, std::weak_ptr<const Maze>> mazes;
+
+    public:
+    maze_cache() : mutex(), mazes() {}
+
+    maze_cache(const maze_cache&) = delete;
+    maze_cache& operator=(const maze_cache&) = delete;
+
+    /**
+     * The maze with these parameters, generated if nobody holds it. The
+     * generator has to be one of generators::available_generators().
+     */
+    std::shared_ptr<const Maze>
+    get(size_t width, size_t height, double difficulty, unsigned int seed,
+        const std::string& generator = "random-walk") {
+        const auto how = generators::find_generator(generator.c_str());
+        assert(how.run);
+        const key k(width, height, difficulty, seed, generator);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (auto maze = lookup(k)) { return maze; }
+        }
+        // generate outside the lock; if someone else was quicker, use theirs
+        auto made = std::make_shared<const Maze>(width, height, difficulty,
+                                                 seed, how);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto maze = lookup(k)) { return maze; }
+        mazes[k] = made;
+        return made;
+    }
+
+    /** Number of mazes still in use; forgets the ones that are not. */
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = mazes.begin(); it != mazes.end(); ) {
+            if (it->second.expired()) {
+                mazes.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        return mazes.size();
+    }
+
+    private:
+    std::shared_ptr<const Maze> lookup(const key& k) {
+        auto it = mazes.find(k);
+        return it == mazes.end() ? nullptr : it->second.lock();
+    }
+};
+
+} /*end namespace*/
+
+#endif
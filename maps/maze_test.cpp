@@ -6,12 +6,420 @@
  * @since 2012-05-01
  */
 
+#include "chunked_maze.hpp"
+#include "exceptions.hpp"
 #include "maze.hpp"
+#include "visibility.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** The packed grid answers like a grid of cells would, borders included. */
+static void
+test_packed_grid()
+{
+    using namespace maps;
+
+    // wide enough that rows take more than one word
+    Maze maze(131, 45, 1, 7);
+    const long w = maze.getWidth(), h = maze.getHeight();
+    size_t paths = 0;
+    for (long x = -2; x < w + 2; ++x) {
+        for (long y = -2; y < h + 2; ++y) {
+            const bool on = x >= 0 && y >= 0 && x < w && y < h;
+            if (!on) {
+                assert(!maze.isOpen(x, y));
+                continue;
+            }
+            const bool border = x == 0 || y == 0 || x == w - 1 || y == h - 1;
+            assert(maze.isOpen(x, y) == maze.isPath(x, y));
+            assert(maze.isWall(x, y) == !maze.isPath(x, y));
+            if (border) { assert(maze.isWall(x, y)); }
+            if (maze.isPath(x, y)) {
+                ++paths;
+                assert(maze.getPathType(x, y) == PathTypes::NORMAL);
+            } else if (!border) {
+                assert(maze.getWallType(x, y) == WallTypes::INNER);
+            }
+            const unsigned int n = maze.openNeighbours(x, y);
+            assert(bool(n & 1) == maze.isOpen(x + 1, y));
+            assert(bool(n & 2) == maze.isOpen(x - 1, y));
+            assert(bool(n & 4) == maze.isOpen(x, y + 1));
+            assert(bool(n & 8) == maze.isOpen(x, y - 1));
+        }
+    }
+    assert(paths > size_t(w * h) / 3);
+    // a bit per cell, and the padding out to whole words, where there
+    // used to be 32
+    assert(maze.getGridBytes() * 8 < size_t(w * h) * 3);
+}
+
+/** How many path cells can be reached from the first room. */
+static size_t
+reachable(const maps::Maze& maze)
+{
+    const size_t w = maze.getWidth(), h = maze.getHeight();
+    std::vector<char> seen(w * h, 0);
+    std::queue<std::pair<size_t, size_t>> open;
+    open.push(std::make_pair(1, 1));
+    seen[w + 1] = 1;
+    size_t reached = 0;
+    while (!open.empty()) {
+        const size_t x = open.front().first, y = open.front().second;
+        open.pop();
+        ++reached;
+        const long dx[] = {1, -1, 0, 0}, dy[] = {0, 0, 1, -1};
+        for (int d = 0; d < 4; ++d) {
+            const size_t nx = x + dx[d], ny = y + dy[d];
+            if (maze.isOpen(nx, ny) && !seen[ny * w + nx]) {
+                seen[ny * w + nx] = 1;
+                open.push(std::make_pair(nx, ny));
+            }
+        }
+    }
+    return reached;
+}
+
+/**
+ * The walls grow the same on any number of threads, and they never wall
+ * any part of the maze off, across the seams between tiles included.
+ */
+static void
+test_parallel_generation()
+{
+    using namespace maps;
+
+    Maze one(301, 257, 1, 9, 1);
+    Maze many(301, 257, 1, 9, 5);
+    Maze other(301, 257, 1, 10, 5);
+    const size_t w = one.getWidth(), h = one.getHeight();
+    size_t paths = 0, differ = 0;
+    for (size_t x = 0; x < w; ++x) {
+        for (size_t y = 0; y < h; ++y) {
+            assert(one.isPath(x, y) == many.isPath(x, y));
+            paths += one.isPath(x, y);
+            differ += one.isPath(x, y) != other.isPath(x, y);
+        }
+    }
+    assert(differ > 0);
+    assert(one.getStart() == many.getStart());
+    assert(one.getFinish() == many.getFinish());
+    assert(one.getMonsters().size() == many.getMonsters().size());
+
+    assert(reachable(one) == paths);
+}
+
+/**
+ * Every generator gives the same maze for the same seed, reaches all of
+ * it, and all but the random walk make perfect mazes: a tree over the
+ * rooms, with a link less than there are rooms. A maze remembers which
+ * of them made it, saved and loaded too. Eller's rows come out the same
+ * streamed as in a Maze.
+ */
+static void
+test_generators()
+{
+    using namespace maps;
+
+    const auto all = generators::available_generators();
+    assert(all.size() == 4);
+    assert(generators::find_generator("wilson").run == &generators::wilson);
+    assert(!generators::find_generator("prim").run);
+    for (const auto& g : all) {
+        Maze maze(61, 45, 1, 3, g);
+        Maze again(61, 45, 1, 3, g, 3);
+        assert(maze.getGenerator() == g.name);
+        std::stringstream saved;
+        maze.save(saved);
+        assert(Maze::load(saved).getGenerator() == g.name);
+        const size_t w = maze.getWidth(), h = maze.getHeight();
+        size_t paths = 0;
+        for (size_t x = 0; x < w; ++x) {
+            for (size_t y = 0; y < h; ++y) {
+                assert(maze.isPath(x, y) == again.isPath(x, y));
+                if (x == 0 || y == 0 || x + 1 == w || y + 1 == h) {
+                    assert(maze.isWall(x, y));
+                }
+                paths += maze.isPath(x, y);
+            }
+        }
+        assert(reachable(maze) == paths);
+        assert(maze.isPath(maze.getStart().first, maze.getStart().second));
+        assert(maze.isPath(maze.getFinish().first, maze.getFinish().second));
+        if (g.run != &generators::random_walk) {
+            const size_t rooms = (w / 2) * (h / 2);
+            assert(paths == 2 * rooms - 1);
+        }
+    }
+
+    Maze eller(61, 45, 1, 3, generators::find_generator("eller"));
+    generators::eller_rows rows(61, 45, 3);
+    std::vector<char> row;
+    for (size_t y = 0; y < 45; ++y) {
+        assert(!rows.done());
+        rows.next(row);
+        for (size_t x = 0; x < 61; ++x) {
+            assert(bool(row[x]) == eller.isPath(x, y));
+        }
+    }
+    assert(rows.done());
+
+    // chunks open their doors onto rooms, whichever way they are made
+    chunked_maze_params params;
+    params.chunk_size = 21;
+    params.how = generators::find_generator("backtracker");
+    chunked_maze world(params);
+    size_t doors = 0;
+    for (long y = 0; y < 21; ++y) {
+        if (world.isPath(20, y)) {
+            ++doors;
+            assert(world.isPath(19, y) && world.isPath(21, y) &&
+                    world.isPath(22, y));
+        }
+    }
+    assert(doors >= 1);
+}
+
+/**
+ * The precomputed visible sets answer exactly what line_of_sight does, and
+ * survive a save and load; a damaged file is refused.
+ */
+static void
+test_visible_sets()
+{
+    maps::Maze maze(41, 43, 1, 9);
+    assert(!maze.hasVisibility());
+    maze.precomputeVisibility(7, 3);
+    assert(maze.hasVisibility() && maze.getVisibilityRadius() == 7);
+    for (long ax = 0; ax < 41; ++ax) {
+        for (long ay = 0; ay < 43; ++ay) {
+            for (long bx = std::max(0L, ax - 8); bx < std::min(41L, ax + 9); ++bx) {
+                for (long by = std::max(0L, ay - 8); by < std::min(43L, ay + 9); ++by) {
+                    assert(maze.isVisible(ax, ay, bx, by) ==
+                           maps::line_of_sight(maze, ax, ay, bx, by));
+                }
+            }
+        }
+    }
+
+    // the result does not depend on how many threads built it
+    maps::Maze serial(41, 43, 1, 9);
+    serial.precomputeVisibility(7, 1);
+    std::ostringstream a, b;
+    maze.save(a);
+    serial.save(b);
+    assert(a.str() == b.str());
+
+    std::istringstream in(a.str());
+    maps::Maze loaded = maps::Maze::load(in);
+    assert(loaded.getWidth() == 41 && loaded.getHeight() == 43);
+    assert(loaded.getStart() == maze.getStart());
+    assert(loaded.getFinish() == maze.getFinish());
+    assert(loaded.getVisibilityBytes() == maze.getVisibilityBytes());
+    for (size_t x = 0; x < 41; ++x) {
+        for (size_t y = 0; y < 43; ++y) {
+            assert(loaded.isPath(x, y) == maze.isPath(x, y));
+            for (size_t bx = x; bx < std::min<size_t>(41, x + 5); ++bx) {
+                assert(loaded.isVisible(x, y, bx, y) == maze.isVisible(x, y, bx, y));
+            }
+        }
+    }
+    std::ostringstream again;
+    loaded.save(again);
+    assert(again.str() == a.str());
+
+    // version 2 had no generator name after the seed, and only random walks
+    std::string v2 = a.str();
+    const std::string name = maze.getGenerator();
+    v2[4] = 2;
+    v2.erase(28, 4 + name.size());
+    std::istringstream v2_in(v2);
+    maps::Maze old = maps::Maze::load(v2_in);
+    assert(old.getGenerator() == "random-walk" && old.getSeed() == 9);
+    assert(old.getStart() == maze.getStart());
+
+    std::string damaged = a.str();
+    for (size_t cut : {size_t(0), size_t(3), damaged.size() / 2, damaged.size() - 1}) {
+        std::istringstream short_in(damaged.substr(0, cut));
+        bool thrown = false;
+        try {
+            maps::Maze::load(short_in);
+        } catch (maps::err::bad_format&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // a word count or a start the rest of the file does not back up
+    const size_t cells = 41 * 43 * 12; // as saved, and as kept
+    const size_t words = (maze.getVisibilityBytes() - cells) / 8;
+    const size_t count_at = damaged.size() - words * 8 - 8;
+    const size_t start_at = count_at - cells - 4 - 16;
+    assert(static_cast<unsigned char>(damaged[count_at]) == (words & 0xff));
+    assert(static_cast<unsigned char>(damaged[start_at]) == maze.getStart().first);
+    std::string huge = damaged, off = damaged;
+    huge.replace(count_at, 8, 8, '\xff');
+    off.replace(start_at, 4, std::string("\x29\0\0\0", 4)); // x = 41
+    for (const std::string* bad : {&huge, &off}) {
+        std::istringstream bad_in(*bad);
+        bool thrown = false;
+        try {
+            maps::Maze::load(bad_in);
+        } catch (maps::err::bad_format&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // a subtype has to be one of its cell's kind, and not the usual one
+    const size_t subtypes_at = 28 + 4 + name.size() + 16 + 45 * 8;
+    auto with_subtype = [&](size_t x, size_t y, unsigned int type) {
+        std::string record;
+        for (std::uint32_t v : {std::uint32_t(1), std::uint32_t(x * 43 + y),
+                                std::uint32_t(type)}) {
+            for (int i = 0; i < 4; ++i) { record += char(v >> (8 * i)); }
+        }
+        return std::string(damaged).replace(subtypes_at, 4, record);
+    };
+    auto loads = [](const std::string& bytes) {
+        std::istringstream bytes_in(bytes);
+        try {
+            maps::Maze::load(bytes_in);
+        } catch (maps::err::bad_format&) {
+            return false;
+        }
+        return true;
+    };
+    const auto at = maze.getStart();
+    assert(loads(with_subtype(at.first, at.second, 1)));
+    std::istringstream grassy(with_subtype(at.first, at.second, 1));
+    assert(maps::Maze::load(grassy).getPathType(at.first, at.second) ==
+            maps::PathTypes::GRASSY);
+    assert(!loads(with_subtype(at.first, at.second, 0)));
+    assert(!loads(with_subtype(at.first, at.second, 7)));
+    assert(loads(with_subtype(2, 2, 0)) && maze.isWall(2, 2));
+    assert(!loads(with_subtype(2, 2, 1)));
+    assert(!loads(with_subtype(0, 5, 0)));
+}
+
+/**
+ * Chunks are the same whenever they are made, agree on the doors between
+ * them, and only the ones near actors are sure to be kept.
+ */
+static void
+test_chunked_maze()
+{
+    using namespace maps;
+
+    chunked_maze_params params;
+    params.chunk_size = 21;
+    params.seed = 11;
+    params.capacity = 4;
+    chunked_maze world(params);
+    assert(world.getChunkCount() == 0);
+    const long s = world.getChunkSize();
+    assert(s == 21);
+
+    assert(world.chunkOf(0, 0) == std::make_pair(0L, 0L));
+    assert(world.chunkOf(s - 1, s) == std::make_pair(0L, 1L));
+    assert(world.chunkOf(-1, -s) == std::make_pair(-1L, -1L));
+    assert(world.chunkOf(-s - 1, 5) == std::make_pair(-2L, 0L));
+
+    // nothing there yet, so nothing is open
+    assert(!world.isOpen(1, 1));
+
+    // the same cells however the chunks got made, negative ones included
+    chunked_maze other(params);
+    std::vector<char> seen;
+    for (long x = -2 * s; x < 2 * s; ++x) {
+        for (long y = -2 * s; y < 2 * s; ++y) {
+            seen.push_back(world.isPath(x, y));
+        }
+    }
+    size_t k = seen.size();
+    for (long x = 2 * s - 1; x >= -2 * s; --x) {
+        for (long y = 2 * s - 1; y >= -2 * s; --y) {
+            assert(other.isPath(x, y) == bool(seen[--k]));
+            assert(other.isOpen(x, y) == other.isPath(x, y));
+        }
+    }
+    assert(world.getStats().generated == 16);
+
+    // every chunk is walled in but for its doors, which both sides of
+    // the wall open together
+    for (long cx = -2; cx < 1; ++cx) {
+        for (long cy = -2; cy < 1; ++cy) {
+            size_t right = 0, up = 0;
+            for (long i = 0; i < s; ++i) {
+                const long x = cx * s + i, y = cy * s + i;
+                const long edge_x = cx * s + s - 1, edge_y = cy * s + s - 1;
+                assert(world.isPath(edge_x, y) == world.isPath(edge_x + 1, y));
+                assert(world.isPath(x, edge_y) == world.isPath(x, edge_y + 1));
+                if (world.isPath(edge_x, y)) {
+                    ++right;
+                    assert(i % 2 == 1 && world.isPath(edge_x - 1, y) &&
+                            world.isPath(edge_x + 2, y));
+                }
+                if (world.isPath(x, edge_y)) {
+                    ++up;
+                    assert(i % 2 == 1 && world.isPath(x, edge_y - 1) &&
+                            world.isPath(x, edge_y + 2));
+                }
+            }
+            assert(right >= 1 && right <= params.doors);
+            assert(up >= 1 && up <= params.doors);
+        }
+    }
+
+    // an actor far away keeps its own chunks and only the 4 most
+    // recently used others are left
+    std::vector<std::pair<double, double>> actors;
+    actors.push_back(std::make_pair(1000.5, -1000.5));
+    world.update(actors, 1);
+    const std::pair<long, long> far = world.chunkOf(1000, -1001);
+    assert(world.hasChunk(far.first, far.second));
+    assert(world.getChunkCount() == 4 + 1);
+    assert(world.getStats().evicted == 12);
+
+    // the world goes on for as long as anyone walks it, at a few chunks
+    // at a time
+    for (int step = 0; step < 50; ++step) {
+        actors[0].first += s;
+        world.update(actors, 2);
+        assert(world.getChunkCount() <= 4 + 2);
+        const std::pair<long, long> at = world.chunkOf(
+                static_cast<long>(actors[0].first), -1001);
+        assert(world.hasChunk(at.first, at.second));
+    }
+
+    // and what it throws away comes back the same
+    for (long x = -2 * s; x < 2 * s; ++x) {
+        for (long y = -2 * s; y < 2 * s; ++y) {
+            assert(other.isPath(x, y) == world.isPath(x, y));
+        }
+    }
+}
 
 int main( int argc, char *argv[] )
 {
+    (void)argc;
+    (void)argv;
     using namespace maps;
 
+    test_packed_grid();
+    test_parallel_generation();
+    test_generators();
+    test_visible_sets();
+    test_chunked_maze();
+
     auto maze = Maze(31, 13, 1);
 
     for (size_t i = 0; i < maze.getWidth(); ++i) {
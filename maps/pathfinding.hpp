@@ -0,0 +1,391 @@
+#ifndef PATHFINDING_HPP_GUARD
+#define PATHFINDING_HPP_GUARD
+/**
+ * @file pathfinding.hpp
+ * Ways through the maze, for everything that wants to get somewhere.
+ *
+ * A flow_field holds every cell's distance to one goal, in steps between
+ * 4-neighbouring path cells, found by a breadth first search from the
+ * goal. Any number of agents walk the same field by stepping to a
+ * neighbour that is closer, so a hundred monsters chasing one player cost
+ * one search, not a hundred.
+ *
+ * A goal that moves to a neighbouring cell does not need a new search.
+ * The grid is bipartite, so every distance changes by exactly one: it
+ * drops for the cells whose way to the old goal went through the new one,
+ * and grows for all the others. The field keeps the distances as stored
+ * value + bias, so only the smaller of the two sides has to be rewritten,
+ * and the bias moves for the other. In a maze a goal walking down a
+ * corridor usually has a small side behind or ahead of it.
+ *
+ * The pathfinder keeps the fields: one per fixed goal (the finish, a
+ * treasure), of which the least recently used are forgotten, and one per
+ * moving target (a player), retargeted as the target moves. It also
+ * answers single A* queries between two cells. Jump point search would
+ * not help here: the corridors are one cell wide, so there is nothing to
+ * jump over.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "maze.hpp"
+#include "visibility.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace maps {
+
+typedef std::pair<size_t, size_t> cell;
+
+class flow_field {
+    static const std::int32_t unreachable_mark =
+        std::numeric_limits<std::int32_t>::max();
+    // rebuild before the bias could run out of range
+    static const std::int32_t max_bias = 1 << 30;
+
+    std::shared_ptr<const Maze> maze;
+    cell goal;
+    std::int32_t bias;
+    std::vector<std::int32_t> stored; // by x * height + y
+    std::vector<std::uint32_t> scratch;
+    size_t touched; // cells visited by the last build or retarget
+
+    // retarget() bookkeeping; a cell is in closer if its mark is visit,
+    // in further if it is visit + 1
+    static const std::uint32_t max_visit = 0xfffffff0u;
+    std::uint32_t visit;
+    std::vector<std::uint32_t> mark;
+    std::vector<std::uint32_t> closer;
+    std::vector<std::uint32_t> further;
+
+    public:
+    static const std::uint32_t unreachable =
+        std::numeric_limits<std::uint32_t>::max();
+
+    flow_field(std::shared_ptr<const Maze> maze, cell goal)
+        : maze(maze)
+        , goal(goal)
+        , bias(0)
+        , stored(maze->getWidth() * maze->getHeight(), +unreachable_mark)
+        , scratch()
+        , touched(0)
+        , visit(0)
+        , mark()
+        , closer()
+        , further()
+    {
+        build();
+    }
+
+    cell getGoal() const { return goal; }
+    const std::shared_ptr<const Maze>& getMaze() const { return maze; }
+
+    /** Cells visited by the last search or retarget(). */
+    size_t getTouched() const { return touched; }
+
+    /** Steps from the cell to the goal, or unreachable. */
+    std::uint32_t distance(size_t x, size_t y) const {
+        std::int32_t s = stored[index(x, y)];
+        return s == unreachable_mark ? unreachable
+            : static_cast<std::uint32_t>(s + bias);
+    }
+
+    bool reachable(size_t x, size_t y) const {
+        return stored[index(x, y)] != unreachable_mark;
+    }
+
+    /**
+     * The neighbour one step closer to the goal; the cell itself at the
+     * goal or where the goal cannot be reached. Ties go to +x, -x, +y, -y
+     * in that order.
+     */
+    cell next(size_t x, size_t y) const {
+        const std::uint32_t d = distance(x, y);
+        if (d == 0 || d == unreachable) { return cell(x, y); }
+        static const long dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (auto& dir : dirs) {
+            const long nx = long(x) + dir[0], ny = long(y) + dir[1];
+            if (is_open_cell(*maze, nx, ny) && distance(nx, ny) + 1 == d) {
+                return cell(nx, ny);
+            }
+        }
+        assert(false);
+        return cell(x, y);
+    }
+
+    /**
+     * Moves the goal. A move to a neighbouring path cell is repaired in
+     * place, anything else searches again.
+     */
+    void retarget(cell to) {
+        if (to == goal) { touched = 0; return; }
+        const long dx = long(to.first) - long(goal.first);
+        const long dy = long(to.second) - long(goal.second);
+        if (std::labs(dx) + std::labs(dy) != 1 || !reachable(to.first, to.second)
+                || std::labs(bias) >= max_bias) {
+            goal = to;
+            build();
+            return;
+        }
+
+        // the cells that can climb from the new goal one step at a time in
+        // the old distances get one closer, the others one further; the
+        // others are the ones that climb from the old goal without going
+        // through the first lot. Both sets grow one distance at a time,
+        // and whichever is complete first is the one that gets rewritten.
+        const cell from = goal;
+        goal = to;
+        if (mark.empty()) { mark.assign(stored.size(), 0); }
+        if (visit >= max_visit) {
+            std::fill(mark.begin(), mark.end(), 0);
+            visit = 0;
+        }
+        visit += 2;
+        closer.assign(1, index(to.first, to.second));
+        further.assign(1, index(from.first, from.second));
+        mark[closer[0]] = visit;
+        mark[further[0]] = visit + 1;
+        size_t closer_layer = 0, further_layer = 0;
+        for (;;) {
+            if (!grow(further, further_layer, visit + 1)) {
+                for (auto c : further) { stored[c] += 2; }
+                --bias;
+                break;
+            }
+            if (!grow(closer, closer_layer, visit)) {
+                for (auto c : closer) { stored[c] -= 2; }
+                ++bias;
+                break;
+            }
+        }
+        touched = closer.size() + further.size();
+    }
+
+    private:
+    /**
+     * Adds the cells one step further from the old goal than the set's
+     * last layer that nobody has claimed yet; false if there are none.
+     */
+    bool grow(std::vector<std::uint32_t>& set, size_t& layer, std::uint32_t own) {
+        const size_t end = set.size();
+        for (size_t i = layer; i < end; ++i) {
+            const std::int32_t up = stored[set[i]] + 1;
+            for_neighbours(set[i], [&](std::uint32_t n) {
+                if (stored[n] == up && mark[n] != visit && mark[n] != visit + 1) {
+                    mark[n] = own;
+                    set.push_back(n);
+                }
+            });
+        }
+        layer = end;
+        return set.size() > end;
+    }
+
+    std::uint32_t index(size_t x, size_t y) const {
+        assert(x < maze->getWidth() && y < maze->getHeight());
+        return static_cast<std::uint32_t>(x * maze->getHeight() + y);
+    }
+
+    template <typename F>
+    void for_neighbours(std::uint32_t c, F f) const {
+        const size_t h = maze->getHeight();
+        const unsigned int open = maze->openNeighbours(c / h, c % h);
+        if (open & 1) { f(c + h); }
+        if (open & 2) { f(c - h); }
+        if (open & 4) { f(c + 1); }
+        if (open & 8) { f(c - 1); }
+    }
+
+    void build() {
+        std::fill(stored.begin(), stored.end(), +unreachable_mark);
+        bias = 0;
+        touched = 0;
+        if (!maze->isPath(goal.first, goal.second)) { return; }
+
+        scratch.clear();
+        const std::uint32_t start = index(goal.first, goal.second);
+        stored[start] = 0;
+        scratch.push_back(start);
+        for (size_t i = 0; i < scratch.size(); ++i) {
+            const std::uint32_t c = scratch[i];
+            const std::int32_t d = stored[c] + 1;
+            for_neighbours(c, [&](std::uint32_t n) {
+                if (stored[n] == unreachable_mark) {
+                    stored[n] = d;
+                    scratch.push_back(n);
+                }
+            });
+        }
+        touched = scratch.size();
+    }
+};
+
+class pathfinder {
+    struct cached_field {
+        std::shared_ptr<flow_field> field;
+        std::uint64_t used;
+    };
+
+    std::shared_ptr<const Maze> maze;
+    size_t capacity;
+    std::uint64_t uses;
+    std::map<cell, cached_field> fixed;
+    std::map<size_t, std::shared_ptr<flow_field>> moving;
+    std::uint64_t searched; // cells visited by all searches so far
+
+    // A* bookkeeping, reused between queries; a cell belongs to the
+    // current search only if its stamp is the search's
+    std::uint32_t search;
+    std::vector<std::uint32_t> stamp;
+    std::vector<std::uint32_t> cost;
+    std::vector<std::uint32_t> parent;
+
+    public:
+    /** Keeps at most capacity fields for fixed goals. */
+    explicit pathfinder(std::shared_ptr<const Maze> maze, size_t capacity = 16)
+        : maze(maze)
+        , capacity(capacity)
+        , uses(0)
+        , fixed()
+        , moving()
+        , searched(0)
+        , search(0)
+        , stamp(maze->getWidth() * maze->getHeight(), 0)
+        , cost(maze->getWidth() * maze->getHeight(), 0)
+        , parent(maze->getWidth() * maze->getHeight(), 0)
+    {}
+
+    pathfinder(const pathfinder&) = delete;
+    pathfinder& operator=(const pathfinder&) = delete;
+
+    /** The field towards a goal that does not move, shared by all asking. */
+    std::shared_ptr<const flow_field> towards(cell goal) {
+        auto it = fixed.find(goal);
+        if (it == fixed.end()) {
+            if (fixed.size() >= capacity) { evict(); }
+            it = fixed.insert(std::make_pair(goal, cached_field{
+                        std::make_shared<flow_field>(maze, goal), 0})).first;
+            searched += it->second.field->getTouched();
+        }
+        it->second.used = ++uses;
+        return it->second.field;
+    }
+
+    /**
+     * The field towards a moving target, such as a player, moved along
+     * if the target is somewhere else than last time.
+     */
+    std::shared_ptr<const flow_field> follow(size_t target, cell goal) {
+        auto& field = moving[target];
+        if (!field) {
+            field = std::make_shared<flow_field>(maze, goal);
+        } else {
+            field->retarget(goal);
+        }
+        searched += field->getTouched();
+        return field;
+    }
+
+    /** Drops the field of a target that went away. */
+    void forget(size_t target) { moving.erase(target); }
+
+    size_t getFieldCount() const { return fixed.size() + moving.size(); }
+
+    /**
+     * Cells visited by every field built or moved and every path searched
+     * so far; what the searches cost, for whoever has to keep it down.
+     */
+    std::uint64_t getSearched() const { return searched; }
+
+    /**
+     * The shortest path from one cell to another, both included, or
+     * nothing if there is none. A* with the Manhattan distance.
+     */
+    std::vector<cell> path(cell from, cell to) {
+        std::vector<cell> out;
+        if (!maze->isPath(from.first, from.second) ||
+                !maze->isPath(to.first, to.second)) {
+            return out;
+        }
+        if (++search == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            search = 1;
+        }
+
+        typedef std::pair<std::uint64_t, std::uint32_t> entry; // f, cell
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+        const size_t h = maze->getHeight();
+        const std::uint32_t start = static_cast<std::uint32_t>(
+                from.first * h + from.second);
+        const std::uint32_t goal = static_cast<std::uint32_t>(
+                to.first * h + to.second);
+        auto estimate = [&](std::uint32_t c) -> std::uint64_t {
+            return std::labs(long(c / h) - long(to.first))
+                + std::labs(long(c % h) - long(to.second));
+        };
+        // ties on f go to the larger g, which is closer to the goal
+        auto key = [](std::uint64_t f, std::uint32_t g) -> std::uint64_t {
+            return f << 32 | (0xffffffffu - g);
+        };
+
+        stamp[start] = search;
+        cost[start] = 0;
+        parent[start] = start;
+        open.push(entry(key(estimate(start), 0), start));
+        while (!open.empty()) {
+            const std::uint32_t c = open.top().second;
+            const std::uint32_t g = 0xffffffffu -
+                static_cast<std::uint32_t>(open.top().first);
+            open.pop();
+            if (g != cost[c]) { continue; } // stale entry
+            ++searched;
+            if (c == goal) { break; }
+
+            const std::uint32_t next[4] = {
+                static_cast<std::uint32_t>(c + h), c - static_cast<std::uint32_t>(h),
+                c + 1, c - 1};
+            const unsigned int open_cells = maze->openNeighbours(c / h, c % h);
+            for (int i = 0; i < 4; ++i) {
+                const std::uint32_t n = next[i];
+                if (!(open_cells >> i & 1)) { continue; }
+                if (stamp[n] == search && cost[n] <= g + 1) { continue; }
+                stamp[n] = search;
+                cost[n] = g + 1;
+                parent[n] = c;
+                open.push(entry(key(g + 1 + estimate(n), g + 1), n));
+            }
+        }
+        if (stamp[goal] != search) { return out; }
+
+        for (std::uint32_t c = goal; ; c = parent[c]) {
+            out.push_back(cell(c / h, c % h));
+            if (c == start) { break; }
+        }
+        std::reverse(out.begin(), out.end());
+        return out;
+    }
+
+    private:
+    void evict() {
+        auto oldest = fixed.begin();
+        for (auto it = fixed.begin(); it != fixed.end(); ++it) {
+            if (it->second.used < oldest->second.used) { oldest = it; }
+        }
+        if (oldest != fixed.end()) { fixed.erase(oldest); }
+    }
+};
+
+} /*end namespace*/
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef VISIBILITY_HPP_GUARD
+#define VISIBILITY_HPP_GUARD
+/**
+ * @file visibility.hpp
+ * Line of sight between maze cells.
+ *
+ * Two cells see each other if the segment between their centres only
+ * passes through path cells on the way; the end cells themselves do not
+ * count. Where the segment goes exactly through a corner, both cells
+ * beside the corner have to be open. The walk is done in integers, so
+ * a sees b exactly when b sees a.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "maze.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+
+namespace maps {
+
+/** Whether the cell is on the maze and a path. */
+inline bool
+is_open_cell(const Maze& maze, long x, long y)
+{
+    return maze.isOpen(x, y);
+}
+
+inline bool
+line_of_sight(const Maze& maze, long ax, long ay, long bx, long by)
+{
+    const long nx = std::labs(bx - ax), ny = std::labs(by - ay);
+    const long sx = bx > ax ? 1 : -1, sy = by > ay ? 1 : -1;
+
+    // after i steps in x the segment reaches the next x boundary at
+    // t = (2i + 1) / 2nx, likewise for y; comparing the two
+    // cross-multiplied keeps it exact
+    long x = ax, y = ay, i = 0, j = 0;
+    while (i < nx || j < ny) {
+        const long tx = i < nx ? (2*i + 1) * ny : -1;
+        const long ty = j < ny ? (2*j + 1) * nx : -1;
+        if (j == ny || (i < nx && tx < ty)) {
+            x += sx; ++i;
+        } else if (i == nx || ty < tx) {
+            y += sy; ++j;
+        } else {
+            if (!is_open_cell(maze, x + sx, y) || !is_open_cell(maze, x, y + sy)) {
+                return false;
+            }
+            x += sx; ++i;
+            y += sy; ++j;
+        }
+        if ((i < nx || j < ny) && !is_open_cell(maze, x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} /*end namespace*/
+
+#endif
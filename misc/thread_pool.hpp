@@ -0,0 +1,159 @@
+#ifndef THREAD_POOL_HPP_GUARD
+#define THREAD_POOL_HPP_GUARD
+/**
+ * @file thread_pool.hpp
+ * A small fork-join pool for data-parallel loops.
+ *
+ * The range is cut into fixed-size chunks that do not depend on the number
+ * of threads, so anything that is accumulated per chunk and merged in chunk
+ * order comes out the same no matter how many threads ran the loop.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utility {
+
+class thread_pool {
+    typedef void (*chunk_fn)(void* ctx, std::size_t chunk,
+                             std::size_t begin, std::size_t end);
+
+    struct job {
+        chunk_fn fn;
+        void* ctx;
+        std::size_t n;
+        std::size_t grain;
+        std::size_t chunks;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    job current;
+    std::size_t generation;
+    std::size_t busy;
+    bool stopping;
+    std::atomic<std::size_t> next_chunk;
+
+    public:
+    /** threads is the total parallelism including the calling thread;
+     *  0 means one per hardware thread. */
+    explicit thread_pool(std::size_t threads = 0)
+        : workers()
+        , mutex()
+        , wake()
+        , done()
+        , current()
+        , generation(0)
+        , busy(0)
+        , stopping(false)
+        , next_chunk(0)
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers.reserve(threads - 1);
+        for (std::size_t i = 1; i < threads; ++i) {
+            workers.push_back(std::thread(&thread_pool::worker_loop, this));
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    std::size_t size() const { return workers.size() + 1; }
+
+    static std::size_t chunk_count(std::size_t n, std::size_t grain) {
+        return (n + grain - 1) / grain;
+    }
+
+    /**
+     * Calls f(chunk, begin, end) for every grain-sized chunk of [0, n) and
+     * returns once all of them are done. The calling thread helps out.
+     * Not reentrant: f must not call back into the same pool.
+     */
+    template <typename F>
+    void parallel_for(std::size_t n, std::size_t grain, F& f) {
+        if (n == 0) { return; }
+        std::size_t chunks = chunk_count(n, grain);
+        if (workers.empty() || chunks == 1) {
+            for (std::size_t c = 0; c < chunks; ++c) {
+                f(c, c*grain, std::min(n, (c+1)*grain));
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = job{&invoke<F>, &f, n, grain, chunks};
+            next_chunk.store(0, std::memory_order_relaxed);
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        run_chunks(current);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]{ return busy == 0; });
+    }
+
+    private:
+    template <typename F>
+    static void invoke(void* ctx, std::size_t chunk,
+                       std::size_t begin, std::size_t end) {
+        (*static_cast<F*>(ctx))(chunk, begin, end);
+    }
+
+    void run_chunks(const job& j) {
+        for (;;) {
+            std::size_t c = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (c >= j.chunks) { break; }
+            j.fn(j.ctx, c, c*j.grain, std::min(j.n, (c+1)*j.grain));
+        }
+    }
+
+    void worker_loop() {
+        std::size_t seen = 0;
+        for (;;) {
+            job j;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]{ return stopping || generation != seen; });
+                if (stopping) { return; }
+                seen = generation;
+                j = current;
+            }
+            run_chunks(j);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busy == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    }
+};
+
+} // end namespace utility
+
+#endif
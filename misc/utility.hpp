@@ -8,29 +8,32 @@
  * @since 2012-05-01
  */
 
-#include <cstdlib> // for rand()
+#include <cstddef>
 
 namespace utility {
 
-int rand(unsigned int start, unsigned int end)
+/** A number in [start, end) drawn from rng (e.g. a std::mt19937). */
+template <typename Rng>
+std::size_t rand(Rng& rng, std::size_t start, std::size_t end)
 {
-    return std::rand()%(end-start)+start;
+    return rng()%(end-start)+start;
 }
 
 
-template <typename RandomAccessContainer>
-auto random_pick(const RandomAccessContainer& c) -> decltype(c[0])
+template <typename RandomAccessContainer, typename Rng>
+auto random_pick(const RandomAccessContainer& c, Rng& rng) -> decltype(c[0])
 {
-    return c[rand(0, c.size())];
+    return c[rand(rng, 0, c.size())];
 }
 
 /** Knuth Shuffle */
-template <typename Array>
-void random_shuffle(Array& a)
+template <typename Array, typename Rng>
+void random_shuffle(Array& a, Rng& rng)
 {
+    if (a.size() < 2) { return; }
     /*tuki pride random shuffle*/
     for (size_t i = a.size()-1; i > 1; i--) {
-        size_t j = rand(0, i);
+        size_t j = rand(rng, 0, i);
         // switch the ith and jth element
         auto temp = a[j];
         a[j] = a[i];
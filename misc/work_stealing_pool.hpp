@@ -0,0 +1,224 @@
+#ifndef WORK_STEALING_POOL_HPP_GUARD
+#define WORK_STEALING_POOL_HPP_GUARD
+/**
+ * @file work_stealing_pool.hpp
+ * A pool of workers running independent tasks, with work stealing.
+ *
+ * Every worker has its own deque. Tasks submitted from outside the pool are
+ * dealt out round robin, tasks submitted by a worker go to its own deque.
+ * A worker takes its newest task first and, once it runs dry, steals the
+ * oldest task of another worker, so uneven tasks even out without a
+ * central queue everyone contends on. Workers can be pinned to cores.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace utility {
+
+class work_stealing_pool {
+    public:
+    typedef void (*task_fn)(void* ctx);
+
+    private:
+    struct task {
+        task_fn fn;
+        void* ctx;
+    };
+
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+
+        worker_queue() : mutex(), tasks() {}
+    };
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::atomic<std::size_t> queued;     // submitted, not yet taken
+    std::atomic<std::size_t> sleepers;   // workers waiting for work
+    std::atomic<std::size_t> unfinished; // submitted, not yet done
+    std::atomic<std::size_t> next_queue; // round robin for outside submits
+    bool stopping;
+    bool pinned;
+
+    // which pool and worker the current thread is, if any
+    struct worker_identity {
+        const work_stealing_pool* pool;
+        std::size_t index;
+    };
+    static worker_identity& identity() {
+        static thread_local worker_identity id = {nullptr, 0};
+        return id;
+    }
+
+    public:
+    /**
+     * threads = 0 starts one worker per hardware thread. With pin_threads
+     * worker i only runs on core i modulo the number of cores (Linux only,
+     * elsewhere it is ignored).
+     */
+    explicit work_stealing_pool(std::size_t threads = 0,
+                                bool pin_threads = false)
+        : queues()
+        , workers()
+        , sleep_mutex()
+        , wake()
+        , idle()
+        , queued(0)
+        , sleepers(0)
+        , unfinished(0)
+        , next_queue(0)
+        , stopping(false)
+        , pinned(false)
+    {
+        const std::size_t cores =
+            std::max(1u, std::thread::hardware_concurrency());
+        if (threads == 0) {
+            threads = cores;
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+        }
+        workers.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers.push_back(std::thread(&work_stealing_pool::worker_loop,
+                        this, i));
+        }
+        if (pin_threads) {
+            pinned = true;
+            for (std::size_t i = 0; i < threads; ++i) {
+                pinned = pin(workers[i], i % cores) && pinned;
+            }
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    /** Finishes every task submitted so far, then stops the workers. */
+    ~work_stealing_pool() {
+        wait_idle();
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    std::size_t size() const { return workers.size(); }
+
+    /** Whether every worker was successfully pinned to its core. */
+    bool isPinned() const { return pinned; }
+
+    /** Queues fn(ctx); safe to call from any thread, workers included. */
+    void submit(task_fn fn, void* ctx) {
+        const worker_identity& me = identity();
+        std::size_t q = me.pool == this
+            ? me.index
+            : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        unfinished.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->mutex);
+            queues[q]->tasks.push_back(task{fn, ctx});
+        }
+        // pairs with worker_loop: either the worker sees the new task
+        // or we see the worker going to sleep
+        queued.fetch_add(1);
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            wake.notify_one();
+        }
+    }
+
+    /** Blocks until every submitted task has run. Not from a worker. */
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        idle.wait(lock, [this]{
+                return unfinished.load(std::memory_order_acquire) == 0; });
+    }
+
+    private:
+    static bool pin(std::thread& t, std::size_t core) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+        (void)t;
+        (void)core;
+        return false;
+#endif
+    }
+
+    /** Own newest task, else the oldest task of the next worker that has one. */
+    bool take(std::size_t self, task& out) {
+        {
+            worker_queue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                out = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t k = 1; k < queues.size(); ++k) {
+            worker_queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                out = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(std::size_t self) {
+        identity() = worker_identity{this, self};
+        task t;
+        for (;;) {
+            if (take(self, t)) {
+                queued.fetch_sub(1);
+                t.fn(t.ctx);
+                if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::lock_guard<std::mutex> lock(sleep_mutex);
+                    idle.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleepers.fetch_add(1);
+            wake.wait(lock, [this]{ return stopping || queued.load() > 0; });
+            sleepers.fetch_sub(1);
+            if (stopping && queued.load() == 0) { return; }
+        }
+    }
+};
+
+} // end namespace utility
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef CLIENT_HPP_HEADER
+#define CLIENT_HPP_HEADER
+
+/**
+ * @file client.hpp
+ * The client side of protocol.hpp, without any graphics.
+ *
+ * It says HELLO until the server welcomes it, sends commands until the
+ * server confirms them, puts snapshot fragments back together, decodes
+ * the snapshots against the ones it already has and confirms each to the
+ * server so the next delta can be encoded against it. hexit_bots runs
+ * lots of these to load a server, and net_test uses one on loopback.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "protocol.hpp"
+#include "udp_socket.hpp"
+#include "../engine/snapshot.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace net {
+
+struct client_stats {
+    std::uint64_t packets_in;
+    std::uint64_t bytes_in;
+    std::uint64_t packets_out;
+    std::uint64_t bytes_out;
+    std::uint64_t fragments;
+    std::uint64_t snapshots;   // decoded
+    std::uint64_t keyframes;   // of those, not deltas
+    std::uint64_t incomplete;  // given up on, a fragment never came
+    std::uint64_t undecodable; // the baseline was gone
+    std::uint64_t bad_packets;
+
+    client_stats()
+        : packets_in(0), bytes_in(0), packets_out(0), bytes_out(0)
+        , fragments(0), snapshots(0), keyframes(0), incomplete(0)
+        , undecodable(0), bad_packets(0)
+    {}
+};
+
+class client {
+    // as many as the server keeps, so any baseline it picks is still here
+    static const std::size_t history_size = 32;
+
+    struct decoded {
+        std::uint64_t id;
+        engine::snapshot s;
+
+        decoded() : id(0), s() {}
+    };
+
+    udp_socket socket;
+    address server;
+    std::string name;
+
+    bool welcomed;
+    bool dropped;
+    welcome_packet info;
+
+    std::uint32_t next_command;
+    std::uint32_t confirmed; // newest command the server has applied
+    input_packet input;      // commands not confirmed yet
+
+    // the snapshot being put together
+    std::uint64_t assembling;
+    std::uint64_t assembling_baseline;
+    std::uint32_t assembling_command;
+    std::uint64_t assembling_age;
+    std::vector<bool> have;
+    std::size_t missing;
+    std::vector<unsigned char> encoded;
+
+    std::vector<decoded> history; // by id % history_size
+    std::uint64_t latest;
+    std::uint32_t latest_command; // as of the newest snapshot
+    std::uint64_t latest_age;
+
+    std::vector<unsigned char> datagram;
+    std::vector<unsigned char> packet;
+    client_stats stats;
+
+    public:
+    client(const address& server, const std::string& name,
+           const address& local = address())
+        : socket(local)
+        , server(server)
+        , name(name)
+        , welcomed(false)
+        , dropped(false)
+        , info()
+        , next_command(1)
+        , confirmed(0)
+        , input()
+        , assembling(0)
+        , assembling_baseline(0)
+        , assembling_command(0)
+        , assembling_age(0)
+        , have()
+        , missing(0)
+        , encoded()
+        , history(history_size)
+        , latest(0)
+        , latest_command(0)
+        , latest_age(0)
+        , datagram()
+        , packet()
+        , stats()
+    {}
+
+    client(const client&) = delete;
+    client& operator=(const client&) = delete;
+
+    /** Says HELLO; call it until isConnected(). */
+    void connect() {
+        dropped = false;
+        write_packet(hello_packet{name}, packet);
+        send();
+    }
+
+    /** Says BYE; the server forgets the client and its actor. */
+    void disconnect() {
+        write_bye(packet);
+        send();
+        welcomed = false;
+    }
+
+    bool isConnected() const { return welcomed; }
+    /** Whether the server sent a BYE: it timed out, or the server is full. */
+    bool wasDropped() const { return dropped; }
+
+    /** What the server said in its WELCOME; only valid once connected. */
+    const welcome_packet& getWelcome() const { return info; }
+    engine::actor_handle getActor() const { return info.actor; }
+
+    /**
+     * Sends a command for the client's actor, along with every one the
+     * server has not confirmed yet.
+     *
+     * @return the command's sequence number
+     */
+    std::uint32_t command(engine::action_type type,
+                          engine::actor_handle target = engine::actor_handle(),
+                          double radius = 0) {
+        const std::uint32_t sequence = next_command++;
+        input.commands.push_back(net::command{sequence, type, target, radius});
+        sendInput();
+        return sequence;
+    }
+
+    /** Repeats the unconfirmed commands and confirms the newest snapshot. */
+    void sendInput() {
+        input.ack = latest;
+        write_packet(input, packet);
+        send();
+    }
+
+    /**
+     * Handles every datagram that has arrived, and confirms the newest
+     * snapshot if a new one was decoded.
+     *
+     * @return how many snapshots were decoded
+     */
+    std::size_t receive() {
+        std::size_t got = 0;
+        address from;
+        while (socket.receive(datagram, from)) {
+            if (from != server) { continue; }
+            ++stats.packets_in;
+            stats.bytes_in += datagram.size();
+            try {
+                got += handle();
+            } catch (engine::err::bad_format&) {
+                ++stats.bad_packets;
+            }
+        }
+        if (got) { sendInput(); }
+        return got;
+    }
+
+    /** Blocks until a datagram arrives or timeout_ms have passed. */
+    bool wait(int timeout_ms) {
+        return socket.wait(timeout_ms);
+    }
+
+    /** The newest snapshot decoded, with its id; 0 if none yet. */
+    std::uint64_t getSnapshotId() const { return latest; }
+    const engine::snapshot& getSnapshot() const {
+        return history[latest % history_size].s;
+    }
+
+    /** The newest command the server has confirmed applying. */
+    std::uint32_t getConfirmedCommand() const { return confirmed; }
+    /**
+     * The newest command applied as of the newest snapshot, and how many
+     * ticks the snapshot is past the tick it was applied in.
+     */
+    std::uint32_t getSnapshotCommand() const { return latest_command; }
+    std::uint64_t getSnapshotCommandAge() const { return latest_age; }
+    /** The commands sent but not confirmed yet, oldest first. */
+    const std::vector<net::command>& getUnconfirmed() const {
+        return input.commands;
+    }
+
+    const client_stats& getStats() const { return stats; }
+    address getAddress() const { return socket.local(); }
+
+    private:
+    void send() {
+        ++stats.packets_out;
+        stats.bytes_out += packet.size();
+        socket.send(server, packet.data(), packet.size());
+    }
+
+    std::size_t handle() {
+        engine::byte_reader r(datagram.data(), datagram.size());
+        switch (read_packet_type(r)) {
+            case protocol::WELCOME:
+                read_packet(r, info);
+                welcomed = true;
+                return 0;
+            case protocol::SNAPSHOT:
+            {
+                snapshot_fragment f;
+                read_packet(r, f);
+                return welcomed ? fragment(f) : 0;
+            }
+            case protocol::BYE:
+                welcomed = false;
+                dropped = true;
+                return 0;
+            default:
+                ++stats.bad_packets;
+                return 0;
+        }
+    }
+
+    std::size_t fragment(const snapshot_fragment& f) {
+        ++stats.fragments;
+        if (f.id <= latest || f.id < assembling) { return 0; } // too late
+        if (f.id > assembling) {
+            if (assembling > latest && missing) { ++stats.incomplete; }
+            assembling = f.id;
+            assembling_baseline = f.baseline;
+            assembling_command = f.last_command;
+            assembling_age = f.command_age;
+            have.assign(f.count, false);
+            missing = f.count;
+            encoded.assign(f.count * protocol::fragment_size, 0);
+        }
+        if (f.count != have.size() || have[f.index]) { return 0; }
+        if (f.size > protocol::fragment_size ||
+                (f.index + 1 < f.count && f.size != protocol::fragment_size)) {
+            throw engine::err::bad_format() << engine::err::reason("bad fragment");
+        }
+        std::copy(f.data, f.data + f.size,
+                encoded.begin() + f.index * protocol::fragment_size);
+        if (f.index + 1 == f.count) {
+            encoded.resize(f.index * protocol::fragment_size + f.size);
+        }
+        have[f.index] = true;
+        if (--missing) { return 0; }
+
+        const decoded* base = nullptr;
+        if (assembling_baseline) {
+            base = &history[assembling_baseline % history_size];
+            if (base->id != assembling_baseline) {
+                ++stats.undecodable;
+                return 0;
+            }
+        }
+        decoded& d = history[assembling % history_size];
+        engine::snapshot s;
+        engine::decode_snapshot(encoded.data(), encoded.size(),
+                base ? &base->s : nullptr, s);
+        d.id = assembling;
+        d.s = std::move(s);
+        latest = assembling;
+        latest_command = assembling_command;
+        latest_age = assembling_age;
+        ++stats.snapshots;
+        if (!base) { ++stats.keyframes; }
+
+        confirmed = std::max(confirmed, assembling_command);
+        auto& cmds = input.commands;
+        std::size_t done = 0;
+        while (done < cmds.size() && cmds[done].sequence <= confirmed) { ++done; }
+        cmds.erase(cmds.begin(), cmds.begin() + done);
+        return 1;
+    }
+};
+
+} /*end namespace*/
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef NET_EXCEPTIONS_HPP_HEADER
+#define NET_EXCEPTIONS_HPP_HEADER
+/**
+ * @file exceptions.hpp
+ *
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+#include <string>
+#include <boost/exception/all.hpp>
+
+namespace net {
+namespace err {
+
+    struct exception_base : virtual std::exception, virtual boost::exception {};
+    struct socket_error   : virtual exception_base {};
+    typedef boost::error_info<struct tag_reason, std::string> reason;
+    typedef boost::errinfo_errno error_number;
+
+}
+}
+
+#endif
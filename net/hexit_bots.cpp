@@ -0,0 +1,235 @@
+/**
+ * @file hexit_bots.cpp
+ *  LOAD GENERATOR FOR hexit_server
+ *
+ * Connects a number of bots to a server, each with a socket of its own
+ * so the server sees them as separate clients, and has them wander about
+ * and pick fights for a while. Every bot decodes every snapshot it gets,
+ * as a real client would. At the end it prints what the bots got: how
+ * many snapshots made it, how many were lost to a missing fragment or
+ * baseline, and the bandwidth per bot.
+ *
+ * usage: hexit_bots [--host=ADDR] [--port=N] [--bots=N] [--threads=N]
+ *                   [--seconds=F] [--input-rate=F] [--seed=N] [--json]
+ *
+ * --input-rate is commands per second per bot. The bots are split over
+ * --threads threads so the load generator is not what limits the test.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "client.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct options {
+    std::string host;
+    std::uint16_t port;
+    std::size_t bots;
+    std::size_t threads;
+    double seconds;
+    double input_rate;
+    unsigned seed;
+    bool json;
+};
+
+options
+parse_options(int argc, char* argv[])
+{
+    options o{"127.0.0.1", 7777, 100, 1, 10, 2, 1, false};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string key = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') == std::string::npos
+            ? "" : arg.substr(arg.find('=') + 1);
+        if      (key == "--host")       { o.host = value; }
+        else if (key == "--port")       { o.port = std::atoi(value.c_str()); }
+        else if (key == "--bots")       { o.bots = std::atoi(value.c_str()); }
+        else if (key == "--threads")    { o.threads = std::atoi(value.c_str()); }
+        else if (key == "--seconds")    { o.seconds = std::atof(value.c_str()); }
+        else if (key == "--input-rate") { o.input_rate = std::atof(value.c_str()); }
+        else if (key == "--seed")       { o.seed = std::atoi(value.c_str()); }
+        else if (key == "--json")       { o.json = true; }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    if (o.threads == 0 || o.input_rate <= 0) {
+        std::cerr << "--threads and --input-rate have to be positive" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return o;
+}
+
+/** Does something random; attacks whoever is close enough. */
+void
+act(net::client& bot, std::mt19937& rng)
+{
+    using engine::action_type;
+    static const action_type moves[] = {
+        action_type::START_GO_FORWARD, action_type::STOP_GO_FORWARD,
+        action_type::START_GO_BACKWARD, action_type::STOP_GO_BACKWARD,
+        action_type::START_ROTATE_LEFT, action_type::STOP_ROTATE_LEFT,
+        action_type::START_ROTATE_RIGHT, action_type::STOP_ROTATE_RIGHT};
+
+    const unsigned roll = rng() % 10;
+    if (roll < 8) {
+        bot.command(moves[rng() % 8]);
+        return;
+    }
+    if (roll == 9) {
+        bot.command(action_type::AREA_ATTACK, engine::actor_handle(), 1);
+        return;
+    }
+    const engine::snapshot& s = bot.getSnapshot();
+    const engine::snapshot_actor* me = nullptr;
+    for (const auto& a : s.actors) {
+        if (a.handle == bot.getActor()) { me = &a; }
+    }
+    if (!me) { return; }
+    for (const auto& a : s.actors) {
+        const double dx = s.position(a.x - me->x), dy = s.position(a.y - me->y);
+        if (a.handle != me->handle && dx*dx + dy*dy < 2) {
+            bot.command(action_type::ATTACK, a.handle);
+            return;
+        }
+    }
+}
+
+struct totals {
+    std::size_t connected;
+    std::size_t dropped;
+    net::client_stats stats;
+
+    totals() : connected(0), dropped(0), stats() {}
+};
+
+/** Runs its bots until the time is up and adds up what they got. */
+void
+run_bots(const options& o, std::size_t first, std::size_t count, totals& out)
+{
+    typedef std::chrono::steady_clock clock;
+    const net::address server = net::address::parse(o.host, o.port);
+    std::mt19937 rng(o.seed + static_cast<unsigned>(first));
+    std::exponential_distribution<double> gap(o.input_rate);
+
+    std::vector<std::unique_ptr<net::client>> bots;
+    std::vector<clock::time_point> next;
+    const auto start = clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        bots.emplace_back(new net::client(server,
+                    "bot" + std::to_string(first + i)));
+        next.push_back(start);
+    }
+
+    const auto stop = start + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(o.seconds));
+    while (clock::now() < stop) {
+        const auto now = clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            net::client& bot = *bots[i];
+            bot.receive();
+            if (now < next[i]) { continue; }
+            if (!bot.isConnected()) {
+                bot.connect();
+                next[i] = now + std::chrono::milliseconds(200);
+                continue;
+            }
+            act(bot, rng);
+            next[i] = now + std::chrono::duration_cast<clock::duration>(
+                    std::chrono::duration<double>(gap(rng)));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    out = totals();
+    for (auto& bot : bots) {
+        if (bot->isConnected()) { ++out.connected; }
+        if (bot->wasDropped()) { ++out.dropped; }
+        const net::client_stats& s = bot->getStats();
+        out.stats.packets_in  += s.packets_in;
+        out.stats.bytes_in    += s.bytes_in;
+        out.stats.packets_out += s.packets_out;
+        out.stats.bytes_out   += s.bytes_out;
+        out.stats.fragments   += s.fragments;
+        out.stats.snapshots   += s.snapshots;
+        out.stats.keyframes   += s.keyframes;
+        out.stats.incomplete  += s.incomplete;
+        out.stats.undecodable += s.undecodable;
+        out.stats.bad_packets += s.bad_packets;
+        bot->disconnect();
+    }
+}
+
+} // end anonymous namespace
+
+int main( int argc, char *argv[] )
+{
+    options o = parse_options(argc, argv);
+
+    std::vector<totals> parts(o.threads);
+    std::vector<std::thread> threads;
+    std::size_t first = 0;
+    for (std::size_t t = 0; t < o.threads; ++t) {
+        std::size_t count = o.bots / o.threads + (t < o.bots % o.threads);
+        threads.emplace_back(run_bots, std::cref(o), first, count,
+                std::ref(parts[t]));
+        first += count;
+    }
+    for (auto& t : threads) { t.join(); }
+
+    totals all;
+    for (const auto& p : parts) {
+        all.connected += p.connected;
+        all.dropped += p.dropped;
+        all.stats.bytes_in    += p.stats.bytes_in;
+        all.stats.bytes_out   += p.stats.bytes_out;
+        all.stats.snapshots   += p.stats.snapshots;
+        all.stats.keyframes   += p.stats.keyframes;
+        all.stats.incomplete  += p.stats.incomplete;
+        all.stats.undecodable += p.stats.undecodable;
+        all.stats.bad_packets += p.stats.bad_packets;
+    }
+    const double bots = o.bots ? double(o.bots) : 1;
+    const net::client_stats& s = all.stats;
+
+    if (o.json) {
+        std::cout << "{\"bots\": " << o.bots
+                  << ", \"connected\": " << all.connected
+                  << ", \"dropped\": " << all.dropped
+                  << ", \"seconds\": " << o.seconds
+                  << ", \"snapshots_per_bot_s\": " << s.snapshots / bots / o.seconds
+                  << ", \"keyframes\": " << s.keyframes
+                  << ", \"incomplete\": " << s.incomplete
+                  << ", \"undecodable\": " << s.undecodable
+                  << ", \"bad_packets\": " << s.bad_packets
+                  << ", \"kbit_in_per_bot\": " << s.bytes_in * 8e-3 / bots / o.seconds
+                  << ", \"kbit_out_per_bot\": " << s.bytes_out * 8e-3 / bots / o.seconds
+                  << "}" << std::endl;
+    } else {
+        std::cout << "bots\tconnected\tdropped\tsnap/s\tkeyframes\tincomplete"
+                     "\tundecodable\tkbit_in/s\tkbit_out/s" << std::endl;
+        std::cout << o.bots << "\t"
+                  << all.connected << "\t"
+                  << all.dropped << "\t"
+                  << s.snapshots / bots / o.seconds << "\t"
+                  << s.keyframes << "\t"
+                  << s.incomplete << "\t"
+                  << s.undecodable << "\t"
+                  << s.bytes_in * 8e-3 / bots / o.seconds << "\t"
+                  << s.bytes_out * 8e-3 / bots / o.seconds << std::endl;
+    }
+    return EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
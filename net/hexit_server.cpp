@@ -0,0 +1,224 @@
+/**
+ * @file hexit_server.cpp
+ *  HEADLESS AUTHORITATIVE SERVER
+ *
+ * Runs an engine in real time and serves it over UDP (see server.hpp and
+ * protocol.hpp). Every report interval it prints how many clients there
+ * are, what a tick cost and how much went over the wire, and from that
+ * how many clients one core could keep up with at this load.
+ *
+ * usage: hexit_server [--port=N] [--bind=ADDR] [--maze=N] [--seed=N]
+ *                     [--rate=N] [--snapshot-rate=N] [--threads=N]
+ *                     [--timeout=F] [--max-clients=N] [--position-bits=N]
+ *                     [--radius=F] [--visibility] [--seconds=F]
+ *                     [--report=F] [--json]
+ *
+ * --rate is ticks per second, --snapshot-rate snapshots per second, which
+ * is rounded to a whole number of ticks. --radius is how far clients see,
+ * in cells; --visibility precomputes the maze's visible sets for that
+ * first. --seconds=0 runs until interrupted.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "server.hpp"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+
+struct options {
+    std::uint16_t port;
+    std::string bind;
+    std::size_t maze;
+    unsigned seed;
+    double rate;
+    double snapshot_rate;
+    std::size_t threads;
+    double timeout;
+    std::size_t max_clients;
+    unsigned position_bits;
+    double radius;
+    bool visibility;
+    double seconds;
+    double report;
+    bool json;
+};
+
+options
+parse_options(int argc, char* argv[])
+{
+    options o{7777, "0.0.0.0", 101, 1, 60, 20, 1, 5, 1024, 8, 12, false,
+        0, 1, false};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string key = arg.substr(0, arg.find('='));
+        std::string value = arg.find('=') == std::string::npos
+            ? "" : arg.substr(arg.find('=') + 1);
+        if      (key == "--port")          { o.port = std::atoi(value.c_str()); }
+        else if (key == "--bind")          { o.bind = value; }
+        else if (key == "--maze")          { o.maze = std::atoi(value.c_str()); }
+        else if (key == "--seed")          { o.seed = std::atoi(value.c_str()); }
+        else if (key == "--rate")          { o.rate = std::atof(value.c_str()); }
+        else if (key == "--snapshot-rate") { o.snapshot_rate = std::atof(value.c_str()); }
+        else if (key == "--threads")       { o.threads = std::atoi(value.c_str()); }
+        else if (key == "--timeout")       { o.timeout = std::atof(value.c_str()); }
+        else if (key == "--max-clients")   { o.max_clients = std::atoi(value.c_str()); }
+        else if (key == "--position-bits") { o.position_bits = std::atoi(value.c_str()); }
+        else if (key == "--radius")        { o.radius = std::atof(value.c_str()); }
+        else if (key == "--visibility")    { o.visibility = true; }
+        else if (key == "--seconds")       { o.seconds = std::atof(value.c_str()); }
+        else if (key == "--report")        { o.report = std::atof(value.c_str()); }
+        else if (key == "--json")          { o.json = true; }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    if (o.rate <= 0 || o.snapshot_rate <= 0 || o.report <= 0 ||
+            o.position_bits > 24) {
+        std::cerr << "--rate, --snapshot-rate and --report have to be positive"
+                     " and --position-bits at most 24" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return o;
+}
+
+double
+cpu_seconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+net::server* running = nullptr;
+
+extern "C" void
+on_signal(int)
+{
+    if (running) { running->stop(); }
+}
+
+/** Prints what happened since the last report, and starts over. */
+class reporter {
+    const options& o;
+    double cpu;
+    std::chrono::steady_clock::time_point wall;
+
+    public:
+    explicit reporter(const options& o)
+        : o(o)
+        , cpu(cpu_seconds())
+        , wall(std::chrono::steady_clock::now())
+    {}
+
+    void operator()(net::server& s) {
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds =
+            std::chrono::duration<double>(now - wall).count();
+        const double used = cpu_seconds() - cpu;
+        wall = now;
+        cpu += used;
+
+        const net::server_stats& st = s.getStats();
+        const std::size_t clients = s.getClientCount();
+        const double ticks = st.ticks ? double(st.ticks) : 1;
+        const double busy = st.busy_ns() * 1e-9 / seconds; // of one core
+        // the share of a core each client costs, with the fixed part of a
+        // tick spread over them, gives how many fit into a whole core
+        const double per_core = clients && busy > 0 ? clients / busy : 0;
+
+        if (o.json) {
+            std::cout << "{\"clients\": " << clients
+                      << ", \"actors\": " << s.getEngine().getActorCount()
+                      << ", \"seconds\": " << seconds
+                      << ", \"ticks\": " << st.ticks
+                      << ", \"tick_us\": " << st.busy_ns() * 1e-3 / ticks
+                      << ", \"receive_us\": " << st.receive_ns * 1e-3 / ticks
+                      << ", \"simulate_us\": " << st.simulate_ns * 1e-3 / ticks
+                      << ", \"interest_us\": " << st.interest_ns * 1e-3 / ticks
+                      << ", \"encode_us\": " << st.encode_ns * 1e-3 / ticks
+                      << ", \"send_us\": " << st.send_ns * 1e-3 / ticks
+                      << ", \"cpu\": " << used / seconds
+                      << ", \"snapshots\": " << st.snapshots
+                      << ", \"keyframes\": " << st.keyframes
+                      << ", \"kbit_out\": " << st.bytes_out * 8e-3 / seconds
+                      << ", \"kbit_in\": " << st.bytes_in * 8e-3 / seconds
+                      << ", \"bytes_per_snapshot\": "
+                      << (st.snapshots ? double(st.bytes_out) / st.snapshots : 0)
+                      << ", \"send_drops\": " << st.send_drops
+                      << ", \"bad_packets\": " << st.bad_packets
+                      << ", \"clients_per_core\": " << per_core
+                      << "}" << std::endl;
+        } else {
+            std::cout << "clients " << clients
+                      << " ticks " << st.ticks
+                      << " tick_us " << st.busy_ns() * 1e-3 / ticks
+                      << " (sim " << st.simulate_ns * 1e-3 / ticks
+                      << " interest " << st.interest_ns * 1e-3 / ticks
+                      << " encode " << st.encode_ns * 1e-3 / ticks
+                      << " send " << st.send_ns * 1e-3 / ticks
+                      << " recv " << st.receive_ns * 1e-3 / ticks
+                      << ") cpu " << used / seconds
+                      << " snapshots " << st.snapshots
+                      << " keyframes " << st.keyframes
+                      << " kbit_out/s " << st.bytes_out * 8e-3 / seconds
+                      << " kbit_in/s " << st.bytes_in * 8e-3 / seconds
+                      << " drops " << st.send_drops
+                      << " clients/core " << per_core
+                      << std::endl;
+        }
+        s.resetStats();
+    }
+};
+
+} // end anonymous namespace
+
+int main( int argc, char *argv[] )
+{
+    options o = parse_options(argc, argv);
+    std::size_t side = o.maze | 1; // Maze only copes with odd sides
+
+    auto maze = std::make_shared<maps::Maze>(side, side, 1, o.seed);
+    if (o.visibility) {
+        maze->precomputeVisibility(
+                static_cast<unsigned>(std::ceil(o.radius)));
+    }
+
+    net::server_params params;
+    params.local = net::address::parse(o.bind, o.port);
+    params.dt = 1 / o.rate;
+    params.snapshot_every = std::max<std::uint64_t>(1,
+            static_cast<std::uint64_t>(std::llround(o.rate / o.snapshot_rate)));
+    params.timeout = o.timeout;
+    params.max_clients = o.max_clients;
+    params.precision.position_bits = o.position_bits;
+    params.interest.radius = o.radius;
+    params.seed = o.seed;
+
+    net::server s(maze, params, o.threads);
+    std::cerr << "hexit_server on " << s.getAddress().str()
+              << ", maze " << side << "x" << side
+              << ", " << o.rate << " ticks/s, a snapshot every "
+              << params.snapshot_every << " ticks" << std::endl;
+
+    running = &s;
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    reporter report(o);
+    s.run(o.seconds, std::ref(report), o.report);
+    running = nullptr;
+    return EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
@@ -0,0 +1,277 @@
+/**
+ * @file net_test.cpp
+ *  TEST FILE FOR THE SERVER AND ITS PROTOCOL
+ *
+ * Runs a server and its clients in one thread over loopback, stepping
+ * them by hand.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "client.hpp"
+#include "prediction.hpp"
+#include "protocol.hpp"
+#include "server.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+static const double TAU = 2*M_PI;
+
+/** Lets the datagrams in flight arrive and be handled, then ticks. */
+static void
+step(net::server& s, std::vector<net::client*> clients, std::size_t ticks = 1)
+{
+    for (std::size_t t = 0; t < ticks; ++t) {
+        s.receive();
+        s.tick();
+        for (auto c : clients) {
+            c->wait(5);
+            c->receive();
+        }
+    }
+    s.receive();
+}
+
+static const engine::snapshot_actor*
+find(const engine::snapshot& s, engine::actor_handle h)
+{
+    for (const auto& a : s.actors) {
+        if (a.handle == h) { return &a; }
+    }
+    return nullptr;
+}
+
+void
+test_protocol()
+{
+    net::input_packet in;
+    in.ack = 17;
+    in.commands.push_back(net::command{5, engine::action_type::START_GO_FORWARD,
+            engine::actor_handle(), 0});
+    in.commands.push_back(net::command{6, engine::action_type::ATTACK,
+            engine::actor_handle(3, 2), 0});
+    in.commands.push_back(net::command{7, engine::action_type::AREA_ATTACK,
+            engine::actor_handle(), 1.5});
+    std::vector<unsigned char> data;
+    net::write_packet(in, data);
+
+    engine::byte_reader r(data.data(), data.size());
+    assert(net::read_packet_type(r) == net::protocol::INPUT);
+    net::input_packet out;
+    net::read_packet(r, out);
+    assert(r.done());
+    assert(out.ack == 17 && out.commands.size() == 3);
+    assert(out.commands[0].sequence == 5);
+    assert(out.commands[1].sequence == 6);
+    assert(out.commands[1].target == engine::actor_handle(3, 2));
+    assert(out.commands[2].sequence == 7 && out.commands[2].radius == 1.5);
+
+    net::write_fragment_header(net::snapshot_fragment{9, 8, 7, 4, 1, 3,
+            nullptr, 0}, data);
+    data.push_back(42);
+    engine::byte_reader fr(data.data(), data.size());
+    assert(net::read_packet_type(fr) == net::protocol::SNAPSHOT);
+    net::snapshot_fragment f;
+    net::read_packet(fr, f);
+    assert(f.id == 9 && f.baseline == 8 && f.last_command == 7);
+    assert(f.command_age == 4);
+    assert(f.index == 1 && f.count == 3 && f.size == 1 && *f.data == 42);
+
+    // a baseline newer than the snapshot makes no sense
+    net::write_fragment_header(net::snapshot_fragment{9, 9, 0, 0, 0, 1,
+            nullptr, 0}, data);
+    engine::byte_reader bad(data.data(), data.size());
+    net::read_packet_type(bad);
+    bool threw = false;
+    try { net::read_packet(bad, f); } catch (engine::err::bad_format&) { threw = true; }
+    assert(threw);
+
+    data.assign(3, 'x');
+    engine::byte_reader junk(data.data(), data.size());
+    threw = false;
+    try { net::read_packet_type(junk); } catch (engine::err::bad_format&) { threw = true; }
+    assert(threw);
+}
+
+void
+test_loopback()
+{
+    auto maze = std::make_shared<const maps::Maze>(31, 31, 1, 3);
+    net::server_params params;
+    params.local = net::address::loopback(0);
+    params.timeout = 0.5;
+    params.snapshot_every = 2;
+    net::server s(maze, params);
+    const net::address at = net::address::loopback(s.getAddress().port);
+
+    net::client a(at, "alice", net::address::loopback(0));
+    net::client b(at, "bob", net::address::loopback(0));
+    a.connect();
+    b.connect();
+    step(s, {&a, &b});
+    assert(a.isConnected() && b.isConnected());
+    assert(s.getClientCount() == 2);
+    assert(a.getActor() != b.getActor());
+    assert(s.actorOf(a.getAddress()) == a.getActor());
+    assert(a.getWelcome().maze_seed == 3 && a.getWelcome().snapshot_every == 2);
+    assert(a.getWelcome().maze_generator == maze->getGenerator());
+
+    // a repeated HELLO gets the same actor back
+    a.connect();
+    step(s, {&a, &b});
+    assert(s.getClientCount() == 2);
+    assert(s.actorOf(a.getAddress()) == a.getActor());
+
+    step(s, {&a, &b}, 4);
+    assert(a.getSnapshotId() != 0);
+    const engine::snapshot_actor* me = find(a.getSnapshot(), a.getActor());
+    assert(me);
+    engine::actor truth = s.getEngine().getActor(a.getActor());
+    assert(std::fabs(a.getSnapshot().position(me->x) - truth.position.x()) < 1./256);
+    assert(std::fabs(a.getSnapshot().position(me->y) - truth.position.y()) < 1./256);
+    assert(me->speed == 0 && me->health == 100);
+
+    // commands get applied once and confirmed
+    const std::uint32_t go = a.command(engine::action_type::START_GO_FORWARD);
+    a.sendInput(); // a repeat, which has to be ignored
+    step(s, {&a, &b}, 4);
+    assert(s.getStats().commands == 1);
+    assert(a.getConfirmedCommand() == go && a.getUnconfirmed().empty());
+    me = find(a.getSnapshot(), a.getActor());
+    assert(me && me->speed == 2);
+
+    // nothing gets lost on loopback, so only the first snapshot is a
+    // keyframe and the rest are deltas
+    step(s, {&a, &b}, 20);
+    assert(a.getStats().keyframes == 1);
+    assert(a.getStats().snapshots >= 10);
+    assert(a.getStats().incomplete == 0 && a.getStats().undecodable == 0);
+
+    // a crowd around b makes its snapshots span several fragments
+    truth = s.getEngine().getActor(b.getActor());
+    for (int i = 0; i < 1500; ++i) {
+        s.getEngine().addActor(engine::actor("",
+                    truth.position + osg::Vec2d(0.001 * (i % 30), 0.001 * (i / 30)),
+                    i * 0.1, 100,
+                    engine::actor_properties{1, TAU/4, 1, 0.5, 100}));
+    }
+    const std::uint64_t fragments = b.getStats().fragments;
+    const std::uint64_t snapshots = b.getStats().snapshots;
+    step(s, {&a, &b}, 2);
+    assert(b.getStats().snapshots == snapshots + 1);
+    assert(b.getStats().fragments - fragments > 1);
+    assert(b.getSnapshot().actors.size() > 1500);
+
+    // garbage is counted and ignored
+    net::udp_socket raw(net::address::loopback(0));
+    const unsigned char junk[] = {'H', 'X', 1, 99};
+    raw.send(at, junk, sizeof(junk));
+    step(s, {&a, &b});
+    assert(s.getStats().bad_packets == 1);
+
+    // b goes quiet and gets dropped; a keeps confirming snapshots
+    const std::size_t timeout_ticks = 0.5 / params.dt + 1;
+    for (std::size_t t = 0; t <= timeout_ticks; ++t) {
+        step(s, {&a});
+    }
+    assert(s.getClientCount() == 1);
+    assert(!s.getEngine().hasActor(b.getActor()));
+    b.wait(5);
+    b.receive();
+    assert(b.wasDropped() && !b.isConnected());
+
+    // and can come back as someone new
+    b.connect();
+    step(s, {&a, &b});
+    assert(b.isConnected() && s.getClientCount() == 2);
+
+    a.disconnect();
+    step(s, {&b});
+    assert(s.getClientCount() == 1);
+    assert(s.getStats().left == 2);
+}
+
+void
+test_prediction()
+{
+    auto maze = std::make_shared<const maps::Maze>(31, 31, 1, 5);
+    net::server_params params;
+    params.local = net::address::loopback(0);
+    params.snapshot_every = 3;
+    net::server s(maze, params);
+    net::client c(net::address::loopback(s.getAddress().port), "carol",
+            net::address::loopback(0));
+    c.connect();
+    step(s, {&c});
+    assert(c.isConnected());
+
+    net::predictor p(c, maze);
+    // the server only gets to its datagrams after its tick, so commands
+    // reach it a tick after they were applied here and the prediction is
+    // a tick ahead of what the snapshots show
+    auto frame = [&]() {
+        p.tick();
+        s.tick();
+        s.receive();
+        c.wait(1);
+        c.receive();
+        p.update();
+    };
+    for (int i = 0; i < 6; ++i) { frame(); }
+    assert(p.hasActor());
+
+    using engine::action_type;
+    const action_type script[] = {
+        action_type::START_GO_FORWARD, action_type::START_ROTATE_LEFT,
+        action_type::STOP_ROTATE_LEFT, action_type::START_ROTATE_RIGHT,
+        action_type::STOP_GO_FORWARD, action_type::START_GO_BACKWARD,
+        action_type::STOP_ROTATE_RIGHT, action_type::STOP_GO_BACKWARD};
+    for (const auto a : script) {
+        const osg::Vec2d before = p.getActor().position;
+        p.command(a);
+        assert(p.getPending() > 0);
+        frame();
+        if (a == action_type::START_GO_FORWARD) {
+            // the prediction moves in the very next tick
+            assert(p.getActor().position != before);
+        }
+        for (int i = 0; i < 6; ++i) { frame(); }
+    }
+    for (int i = 0; i < 10; ++i) { frame(); }
+
+    // with a steady latency every command lines up with the tick the
+    // server applied it in, and the prediction is only ever off by the
+    // snapshots' quantization
+    const net::prediction_stats& st = p.getStats();
+    assert(st.reconciles > 20);
+    assert(st.replayed > 0);
+    assert(st.mispredicted == 0);
+    assert(p.getPending() == 0);
+    const engine::actor truth = s.getEngine().getActor(c.getActor());
+    assert((p.getActor().position - truth.position).length() < 0.01);
+
+    // the server moving the actor behind the client's back is corrected
+    // with the next snapshot
+    s.getEngine().placeActor(c.getActor(), truth.position + osg::Vec2d(0.5, 0),
+            truth.direction, 0, 0);
+    for (int i = 0; i < 7; ++i) { frame(); }
+    assert(st.mispredicted == 1 && st.last_error < 0.01);
+    assert(std::fabs(st.max_error - 0.5) < 0.01);
+    assert((p.getActor().position - truth.position - osg::Vec2d(0.5, 0)).length()
+            < 0.01);
+}
+
+int main( int argc, char *argv[] )
+{
+    (void)argc;
+    (void)argv;
+    test_protocol();
+    test_loopback();
+    test_prediction();
+    return EXIT_SUCCESS;
+}               /* ----------  end of function main  ---------- */
@@ -0,0 +1,257 @@
+#ifndef PREDICTION_HPP_HEADER
+#define PREDICTION_HPP_HEADER
+
+/**
+ * @file prediction.hpp
+ * Client-side prediction of the client's own actor.
+ *
+ * Waiting a round trip for the server to say that the actor started
+ * moving feels sluggish, so the predictor runs a local engine with just
+ * that actor in it and applies the movement commands there straight
+ * away, while they are also sent to the server. Attacks are only sent:
+ * whether they hit is up to the server.
+ *
+ * Every command sent is kept in a ring together with the local tick it
+ * was applied in, until a snapshot confirms it. When a snapshot comes in
+ * the predictor reconciles: it puts its actor where the snapshot has it,
+ * works out which local tick that state belongs to from the last command
+ * the snapshot includes and how many ticks the server ran since, and
+ * simulates forward to the current tick again, applying the commands the
+ * server had not seen yet in the ticks they were first applied in. With
+ * one actor in the engine a tick is a few hundred nanoseconds, so even
+ * replaying the whole ring costs next to nothing within a frame.
+ *
+ * The local tick rate has to match the server's. A predicted pose from
+ * every tick is kept as well, to measure how far off the prediction was.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "client.hpp"
+#include "../engine/engine.hpp"
+#include "../engine/snapshot.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace net {
+
+/** How reconciliation has gone since the predictor was made. */
+struct prediction_stats {
+    std::uint64_t reconciles;
+    std::uint64_t replayed;      // ticks simulated again
+    std::uint64_t dropped;       // commands that fell out of a full ring
+    double last_error;           // cells between prediction and server
+    double max_error;
+    std::uint64_t mispredicted;  // reconciles more than tolerance off
+
+    prediction_stats()
+        : reconciles(0), replayed(0), dropped(0)
+        , last_error(0), max_error(0), mispredicted(0)
+    {}
+};
+
+class predictor {
+    // commands and poses are kept this many ticks, a power of two; at 60
+    // ticks per second that is a round trip of a good four seconds
+    static const std::size_t ring_size = 256;
+
+    // snapshot positions are quantized; closer than this is no error
+    static constexpr double tolerance = 0.01;
+
+    struct input {
+        std::uint32_t sequence;
+        std::uint64_t tick; // local tick it was applied in
+        engine::action_type type;
+    };
+
+    struct pose {
+        std::uint64_t tick;
+        double x;
+        double y;
+    };
+
+    client& c;
+    std::unique_ptr<engine::engine> local;
+    engine::actor_handle me; // in the local engine
+    std::uint64_t ticks;     // predicted; replays do not count
+
+    input inputs[ring_size]; // unconfirmed, from first to last
+    std::size_t first;
+    std::size_t count;
+    std::uint64_t confirmed_tick; // local tick of the newest confirmed one
+
+    pose poses[ring_size]; // by tick % ring_size
+    std::uint64_t seen;    // newest snapshot reconciled to
+
+    prediction_stats stats;
+
+    public:
+    /** The client has to be connected already; the maze is the server's. */
+    predictor(client& c, std::shared_ptr<const maps::Maze> maze)
+        : c(c)
+        , local(new engine::engine(maze))
+        , me()
+        , ticks(0)
+        , inputs()
+        , first(0)
+        , count(0)
+        , confirmed_tick(0)
+        , poses()
+        , seen(0)
+        , stats()
+    {
+        assert(c.isConnected());
+        local->setTimeStep(c.getWelcome().dt);
+    }
+
+    predictor(const predictor&) = delete;
+    predictor& operator=(const predictor&) = delete;
+
+    /**
+     * Sends a command and, if it moves the actor, applies it locally.
+     *
+     * @return the command's sequence number
+     */
+    std::uint32_t command(engine::action_type type,
+                          engine::actor_handle target = engine::actor_handle(),
+                          double radius = 0) {
+        const std::uint32_t sequence = c.command(type, target, radius);
+        if (count == ring_size) {
+            // the server has not confirmed anything in a long while;
+            // forget the oldest rather than stop predicting
+            first = (first + 1) % ring_size;
+            --count;
+            ++stats.dropped;
+        }
+        inputs[(first + count++) % ring_size] =
+            input{sequence, ticks, type};
+        if (me.valid()) { apply(type); }
+        return sequence;
+    }
+
+    /** Advances the prediction by one tick. */
+    void tick() {
+        local->simulate();
+        ++ticks;
+        remember();
+    }
+
+    /**
+     * Reconciles with the client's newest snapshot if there is a new one;
+     * call it after client::receive().
+     *
+     * @return whether there was one
+     */
+    bool update() {
+        if (c.getSnapshotId() == seen) { return false; }
+        seen = c.getSnapshotId();
+        const engine::snapshot& s = c.getSnapshot();
+        const engine::snapshot_actor* server = nullptr;
+        for (const auto& a : s.actors) {
+            if (a.handle == c.getActor()) { server = &a; }
+        }
+        if (!server) { return true; } // not in there yet
+        reconcile(s, *server);
+        return true;
+    }
+
+    /** The predicted state of the actor; only valid once hasActor(). */
+    engine::actor getActor() const { return local->getActor(me); }
+    bool hasActor() const { return me.valid(); }
+
+    /** Ticks simulated locally so far. */
+    std::uint64_t getTick() const { return ticks; }
+    /** Commands sent but not confirmed yet. */
+    std::size_t getPending() const { return count; }
+
+    const prediction_stats& getStats() const { return stats; }
+
+    private:
+    void apply(engine::action_type type) {
+        if (type == engine::action_type::ATTACK ||
+                type == engine::action_type::AREA_ATTACK) {
+            return;
+        }
+        local->applyAction(engine::timed_action{local->getCurrentTime(), me,
+                engine::actor_handle(), type, 0});
+    }
+
+    void remember() {
+        if (!me.valid()) { return; }
+        const engine::actor a = local->getActor(me);
+        poses[ticks % ring_size] = pose{ticks, a.position.x(), a.position.y()};
+    }
+
+    void reconcile(const engine::snapshot& s, const engine::snapshot_actor& server) {
+        ++stats.reconciles;
+        const std::uint64_t now = ticks;
+
+        // let go of what the server has confirmed, noting when the newest
+        // of it was applied here
+        const std::uint32_t done = c.getSnapshotCommand();
+        while (count && inputs[first].sequence <= done) {
+            if (inputs[first].sequence == done) {
+                confirmed_tick = inputs[first].tick;
+            }
+            first = (first + 1) % ring_size;
+            --count;
+        }
+
+        // the snapshot is the state after the confirmed command had been
+        // in for so many ticks. Before the first one there is nothing to
+        // line it up with; that only matters once there are commands the
+        // server has not seen, and then the prediction is all there is.
+        if (!done && count && me.valid()) { return; }
+        std::uint64_t base = done
+            ? confirmed_tick + c.getSnapshotCommandAge() : now;
+        base = std::min(base, now);
+        if (now - base >= ring_size) { base = now - (ring_size - 1); }
+
+        const double x = s.position(server.x), y = s.position(server.y);
+        if (me.valid() && poses[base % ring_size].tick == base) {
+            const pose& p = poses[base % ring_size];
+            stats.last_error = std::hypot(p.x - x, p.y - y);
+            stats.max_error = std::max(stats.max_error, stats.last_error);
+            if (stats.last_error > tolerance) { ++stats.mispredicted; }
+        }
+
+        if (!me.valid()) {
+            engine::actor a(server.name, osg::Vec2d(x, y),
+                    s.direction(server.direction), server.health, server.limits);
+            me = local->addActor(a);
+        }
+        local->placeActor(me, osg::Vec2d(x, y), s.direction(server.direction),
+                server.speed, server.angular_velocity);
+
+        // back to the base tick, with the actor as the server has it, and
+        // forward again. The engine's own clock runs on through replays;
+        // movement does not depend on it.
+        std::size_t next = 0;
+        for (std::uint64_t t = base; t <= now; ++t) {
+            while (next < count && inputs[(first + next) % ring_size].tick <= t) {
+                apply(inputs[(first + next) % ring_size].type);
+                ++next;
+            }
+            if (t == now) { break; }
+            step_again(t + 1);
+        }
+    }
+
+    /** One tick of the replay, which has to end up as tick t. */
+    void step_again(std::uint64_t t) {
+        local->simulate();
+        ++stats.replayed;
+        const engine::actor a = local->getActor(me);
+        poses[t % ring_size] = pose{t, a.position.x(), a.position.y()};
+    }
+};
+
+} /*end namespace*/
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef PROTOCOL_HPP_HEADER
+#define PROTOCOL_HPP_HEADER
+
+/**
+ * @file protocol.hpp
+ * The datagrams hexit_server and its clients exchange.
+ *
+ * Every datagram starts with the magic, the protocol version and a packet
+ * type, followed by the packet's fields written with engine::byte_writer.
+ *
+ *  - HELLO, client to server: asks for an actor. Sent again until the
+ *    WELCOME arrives.
+ *  - WELCOME, server to client: the actor, the map, the tick length and
+ *    how often snapshots come. Sent again for every repeated HELLO.
+ *  - INPUT, client to server: the newest snapshot the client has decoded,
+ *    which the server then encodes against, and every command the server
+ *    has not confirmed yet. Commands are numbered, so repeats are ignored
+ *    and a lost INPUT costs nothing as long as a later one arrives.
+ *  - SNAPSHOT, server to client: one fragment of an encoded snapshot of
+ *    what the client's actor can see (engine::encode_snapshot), as a delta
+ *    against the baseline snapshot or a keyframe if that is 0. The header
+ *    also confirms the last command applied, and says how many ticks the
+ *    snapshot is past the one it was applied in, which is what a client
+ *    needs to line its prediction up with the server. A snapshot can only
+ *    be decoded once all its fragments are in.
+ *  - BYE, either way: the client is leaving, or is being dropped.
+ *
+ * The server stamps commands with its own clock when it gets them; a
+ * client has no say in when its commands happen.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "../engine/binary_io.hpp"
+#include "../engine/engine.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace net {
+
+namespace protocol {
+    static const unsigned char magic[2] = {'H', 'X'};
+    static const std::uint64_t version = 2;
+
+    // snapshot bytes per fragment, so that a fragment with its headers
+    // fits into the smallest MTU on the way without IP fragmentation
+    static const std::size_t fragment_size = 1200;
+    // fragments per snapshot, which bounds a snapshot at about 300 kB
+    static const std::size_t max_fragments = 256;
+    // commands per INPUT; a client with more unconfirmed ones waits
+    static const std::size_t max_commands = 64;
+
+    enum packet_type : unsigned char {
+        HELLO    = 1,
+        WELCOME  = 2,
+        INPUT    = 3,
+        SNAPSHOT = 4,
+        BYE      = 5
+    };
+} // end namespace protocol
+
+struct hello_packet {
+    std::string name;
+
+    explicit hello_packet(const std::string& name = "")
+        : name(name)
+    {}
+};
+
+struct welcome_packet {
+    engine::actor_handle actor;
+    std::uint64_t maze_width;
+    std::uint64_t maze_height;
+    double maze_difficulty;
+    std::uint64_t maze_seed;
+    std::string maze_generator;
+    double dt;
+    std::uint64_t snapshot_every; // ticks between snapshots
+
+    welcome_packet(engine::actor_handle actor = engine::actor_handle(),
+                   std::uint64_t maze_width = 0,
+                   std::uint64_t maze_height = 0,
+                   double maze_difficulty = 0,
+                   std::uint64_t maze_seed = 0,
+                   const std::string& maze_generator = "",
+                   double dt = 0,
+                   std::uint64_t snapshot_every = 0)
+        : actor(actor)
+        , maze_width(maze_width)
+        , maze_height(maze_height)
+        , maze_difficulty(maze_difficulty)
+        , maze_seed(maze_seed)
+        , maze_generator(maze_generator)
+        , dt(dt)
+        , snapshot_every(snapshot_every)
+    {}
+};
+
+/** An action a client wants its actor to take. */
+struct command {
+    std::uint32_t sequence; // from 1, one up for every command
+    engine::action_type type;
+    engine::actor_handle target; // only for ATTACK
+    double radius;               // only for AREA_ATTACK
+
+    command(std::uint32_t sequence = 0,
+            engine::action_type type = engine::action_type::STOP_GO_FORWARD,
+            engine::actor_handle target = engine::actor_handle(),
+            double radius = 0)
+        : sequence(sequence)
+        , type(type)
+        , target(target)
+        , radius(radius)
+    {}
+};
+
+struct input_packet {
+    std::uint64_t ack; // newest snapshot decoded, 0 if none
+    std::vector<command> commands; // oldest first
+
+    input_packet()
+        : ack(0)
+        , commands()
+    {}
+};
+
+struct snapshot_fragment {
+    std::uint64_t id;       // from 1, one up for every snapshot sent
+    std::uint64_t baseline; // the id encoded against, 0 for a keyframe
+    std::uint32_t last_command; // newest command applied
+    std::uint64_t command_age;  // ticks simulated since it was applied
+    std::uint32_t index;
+    std::uint32_t count;
+    const unsigned char* data; // into the datagram
+    std::size_t size;
+};
+
+namespace detail {
+    inline engine::byte_writer
+    begin_packet(std::vector<unsigned char>& out, protocol::packet_type t) {
+        out.clear();
+        engine::byte_writer w(out);
+        for (unsigned char m : protocol::magic) { w.u8(m); }
+        w.varint(protocol::version);
+        w.u8(t);
+        return w;
+    }
+
+    inline void
+    write_handle(engine::byte_writer& w, engine::actor_handle h) {
+        w.varint(h.index);
+        w.varint(h.generation);
+    }
+
+    inline engine::actor_handle
+    read_handle(engine::byte_reader& r) {
+        std::uint32_t index = static_cast<std::uint32_t>(r.varint());
+        return engine::actor_handle(index, static_cast<std::uint32_t>(r.varint()));
+    }
+
+    inline std::uint32_t
+    read_u32(engine::byte_reader& r) {
+        std::uint64_t v = r.varint();
+        if (v > 0xffffffffu) {
+            throw engine::err::bad_format() << engine::err::reason("field too large");
+        }
+        return static_cast<std::uint32_t>(v);
+    }
+} // end namespace detail
+
+/**
+ * Checks the magic and the version and returns the packet type, leaving
+ * r at the first field. Throws engine::err::bad_format if the datagram is
+ * not one of ours.
+ */
+inline protocol::packet_type
+read_packet_type(engine::byte_reader& r)
+{
+    unsigned char m[sizeof(protocol::magic)];
+    r.bytes(m, sizeof(m));
+    if (!std::equal(m, m + sizeof(m), protocol::magic)) {
+        throw engine::err::bad_format() << engine::err::reason("not a hexit packet");
+    }
+    if (r.varint() != protocol::version) {
+        throw engine::err::bad_format()
+            << engine::err::reason("unsupported protocol version");
+    }
+    unsigned char t = r.u8();
+    if (t < protocol::HELLO || t > protocol::BYE) {
+        throw engine::err::bad_format() << engine::err::reason("unknown packet type");
+    }
+    return static_cast<protocol::packet_type>(t);
+}
+
+inline void
+write_packet(const hello_packet& p, std::vector<unsigned char>& out)
+{
+    engine::byte_writer w = detail::begin_packet(out, protocol::HELLO);
+    w.string(p.name);
+}
+
+inline void
+read_packet(engine::byte_reader& r, hello_packet& p)
+{
+    p.name = r.string();
+}
+
+inline void
+write_packet(const welcome_packet& p, std::vector<unsigned char>& out)
+{
+    engine::byte_writer w = detail::begin_packet(out, protocol::WELCOME);
+    detail::write_handle(w, p.actor);
+    w.varint(p.maze_width);
+    w.varint(p.maze_height);
+    w.f64(p.maze_difficulty);
+    w.varint(p.maze_seed);
+    w.string(p.maze_generator);
+    w.f64(p.dt);
+    w.varint(p.snapshot_every);
+}
+
+inline void
+read_packet(engine::byte_reader& r, welcome_packet& p)
+{
+    p.actor = detail::read_handle(r);
+    p.maze_width = r.varint();
+    p.maze_height = r.varint();
+    p.maze_difficulty = r.f64();
+    p.maze_seed = r.varint();
+    p.maze_generator = r.string();
+    p.dt = r.f64();
+    p.snapshot_every = r.varint();
+}
+
+inline void
+write_packet(const input_packet& p, std::vector<unsigned char>& out)
+{
+    engine::byte_writer w = detail::begin_packet(out, protocol::INPUT);
+    w.varint(p.ack);
+    const std::size_t n = std::min(p.commands.size(), +protocol::max_commands);
+    w.varint(n);
+    // numbered from the first one on, so only that one carries its number
+    if (n) { w.varint(p.commands[0].sequence); }
+    for (std::size_t i = 0; i < n; ++i) {
+        const command& c = p.commands[i];
+        w.u8(static_cast<unsigned char>(c.type));
+        if (c.type == engine::action_type::ATTACK) {
+            detail::write_handle(w, c.target);
+        } else if (c.type == engine::action_type::AREA_ATTACK) {
+            w.f64(c.radius);
+        }
+    }
+}
+
+inline void
+read_packet(engine::byte_reader& r, input_packet& p)
+{
+    p.ack = r.varint();
+    const std::uint64_t n = r.varint();
+    if (n > protocol::max_commands) {
+        throw engine::err::bad_format() << engine::err::reason("too many commands");
+    }
+    p.commands.resize(n);
+    std::uint32_t sequence = n ? detail::read_u32(r) : 0;
+    for (auto& c : p.commands) {
+        c.sequence = sequence++;
+        unsigned char t = r.u8();
+        if (t > static_cast<unsigned char>(engine::action_type::AREA_ATTACK)) {
+            throw engine::err::bad_format() << engine::err::reason("unknown action");
+        }
+        c.type = static_cast<engine::action_type>(t);
+        c.target = engine::actor_handle();
+        c.radius = 0;
+        if (c.type == engine::action_type::ATTACK) {
+            c.target = detail::read_handle(r);
+        } else if (c.type == engine::action_type::AREA_ATTACK) {
+            c.radius = r.f64();
+        }
+    }
+}
+
+/** Appends the headers of a fragment to out; the data goes after them. */
+inline void
+write_fragment_header(const snapshot_fragment& f, std::vector<unsigned char>& out)
+{
+    engine::byte_writer w = detail::begin_packet(out, protocol::SNAPSHOT);
+    w.varint(f.id);
+    w.varint(f.baseline);
+    w.varint(f.last_command);
+    w.varint(f.command_age);
+    w.varint(f.index);
+    w.varint(f.count);
+}
+
+/** f.data points into the datagram r reads from. */
+inline void
+read_packet(engine::byte_reader& r, snapshot_fragment& f)
+{
+    f.id = r.varint();
+    f.baseline = r.varint();
+    f.last_command = detail::read_u32(r);
+    f.command_age = r.varint();
+    f.index = detail::read_u32(r);
+    f.count = detail::read_u32(r);
+    if (f.count == 0 || f.count > protocol::max_fragments || f.index >= f.count
+            || f.id == 0 || f.baseline >= f.id) {
+        throw engine::err::bad_format() << engine::err::reason("bad fragment");
+    }
+    f.size = r.remaining();
+    f.data = f.size ? r.position() : nullptr;
+}
+
+inline void
+write_bye(std::vector<unsigned char>& out)
+{
+    detail::begin_packet(out, protocol::BYE);
+}
+
+} /*end namespace*/
+
+#endif
@@ -0,0 +1,478 @@
+#ifndef SERVER_HPP_HEADER
+#define SERVER_HPP_HEADER
+
+/**
+ * @file server.hpp
+ * An authoritative engine behind a UDP socket.
+ *
+ * The server owns the engine; clients only send commands (protocol.hpp)
+ * and get told what happened. Every client that says HELLO gets an actor
+ * on a random path cell, and every snapshot_every ticks a snapshot of
+ * what that actor can see (engine::interest_manager), quantized to the
+ * server's snapshot_precision. Snapshots go out as deltas against the
+ * newest one the client has confirmed, or as a keyframe if the server no
+ * longer remembers it, cut into fragments that each fit a datagram.
+ *
+ * All of it runs on one thread: receive() handles whatever has arrived,
+ * tick() simulates and broadcasts, and run() does both in real time. The
+ * engine can still use more threads of its own for simulate().
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "protocol.hpp"
+#include "udp_socket.hpp"
+#include "../engine/engine.hpp"
+#include "../engine/interest.hpp"
+#include "../engine/snapshot.hpp"
+#include "../misc/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace net {
+
+struct server_params {
+    address local;                // where to listen; port 0 picks one
+    double dt;                    // tick length in seconds
+    std::uint64_t snapshot_every; // ticks between snapshots
+    double timeout;               // seconds of silence before a client is dropped
+    std::size_t max_clients;
+    engine::snapshot_precision precision;
+    engine::interest_params interest;
+    engine::actor_properties player; // what a client's actor can do
+    double max_area_radius;       // area attacks are capped to this
+    unsigned int seed;            // for where actors start
+
+    server_params()
+        : local()
+        , dt(1./60)
+        , snapshot_every(3)
+        , timeout(5)
+        , max_clients(1024)
+        , precision(8, 10)
+        , interest()
+        , player(engine::actor_properties{2, engine::TAU/2, 10, 0.5, 100})
+        , max_area_radius(2)
+        , seed(1)
+    {}
+};
+
+/** What the server has done since the stats were last reset. */
+struct server_stats {
+    std::uint64_t ticks;
+    std::uint64_t snapshots;     // sent, one per client per broadcast
+    std::uint64_t keyframes;     // of those, not deltas
+    std::uint64_t fragments;
+    std::uint64_t packets_in;
+    std::uint64_t bytes_in;
+    std::uint64_t packets_out;
+    std::uint64_t bytes_out;     // UDP payload only
+    std::uint64_t send_drops;    // datagrams the kernel had no room for
+    std::uint64_t bad_packets;
+    std::uint64_t commands;
+    std::uint64_t joined;
+    std::uint64_t left;          // said BYE or timed out
+
+    std::uint64_t receive_ns;
+    std::uint64_t simulate_ns;
+    std::uint64_t interest_ns;
+    std::uint64_t encode_ns;     // filtering and encoding snapshots
+    std::uint64_t send_ns;
+
+    server_stats()
+        : ticks(0), snapshots(0), keyframes(0), fragments(0)
+        , packets_in(0), bytes_in(0), packets_out(0), bytes_out(0)
+        , send_drops(0), bad_packets(0), commands(0), joined(0), left(0)
+        , receive_ns(0), simulate_ns(0), interest_ns(0), encode_ns(0)
+        , send_ns(0)
+    {}
+
+    /** Time spent working, as opposed to waiting for the next tick. */
+    std::uint64_t busy_ns() const {
+        return receive_ns + simulate_ns + interest_ns + encode_ns + send_ns;
+    }
+};
+
+class server {
+    typedef std::chrono::steady_clock clock;
+
+    // snapshots a client can still be sent deltas against
+    static const std::size_t history_size = 32;
+
+    struct sent_view {
+        std::uint64_t id;
+        engine::snapshot view;
+
+        sent_view() : id(0), view() {}
+    };
+
+    struct client {
+        address from;
+        engine::actor_handle actor;
+        std::uint64_t last_heard;   // tick
+        std::uint32_t last_command; // newest applied
+        std::uint64_t command_tick; // the tick it was queued after
+        std::uint64_t acked;        // newest snapshot it has decoded
+        std::vector<sent_view> history; // by id % history_size
+    };
+
+    server_params params;
+    std::unique_ptr<engine::engine> e;
+    udp_socket socket;
+    engine::interest_manager interest;
+    std::mt19937 rng;
+    std::vector<std::pair<std::size_t, std::size_t>> spawn_cells;
+    std::uint64_t timeout_ticks;
+
+    std::unordered_map<address, std::size_t, address_hash> by_address;
+    std::vector<std::unique_ptr<client>> clients; // null where removed
+    std::size_t live;
+
+    std::uint64_t next_snapshot;
+    engine::snapshot full;
+    engine::snapshot view;
+    std::vector<engine::actor_snapshot> poses;
+    std::vector<unsigned char> datagram;
+    std::vector<unsigned char> packet;
+    std::vector<unsigned char> encoded;
+    input_packet input;
+
+    server_stats stats;
+    std::atomic<bool> stopping;
+
+    public:
+    server(std::shared_ptr<const maps::Maze> maze,
+           server_params params = server_params(),
+           std::size_t threads = 1)
+        : params(params)
+        , e(new engine::engine(maze,
+                    std::make_shared<utility::thread_pool>(threads)))
+        , socket(params.local)
+        , interest(maze, params.interest)
+        , rng(params.seed)
+        , spawn_cells()
+        , timeout_ticks(0)
+        , by_address()
+        , clients()
+        , live(0)
+        , next_snapshot(1)
+        , full()
+        , view()
+        , poses()
+        , datagram()
+        , packet()
+        , encoded()
+        , input()
+        , stats()
+        , stopping(false)
+    {
+        assert(params.snapshot_every > 0);
+        e->setTimeStep(params.dt);
+        timeout_ticks = static_cast<std::uint64_t>(
+                std::ceil(params.timeout / e->getTimeStep()));
+        for (std::size_t x = 1; x < maze->getWidth(); ++x) {
+            for (std::size_t y = 1; y < maze->getHeight(); ++y) {
+                if (maze->isPath(x, y)) {
+                    spawn_cells.push_back(std::make_pair(x, y));
+                }
+            }
+        }
+        assert(!spawn_cells.empty());
+        socket.setBufferSizes(1 << 22);
+    }
+
+    server(const server&) = delete;
+    server& operator=(const server&) = delete;
+
+    /** Where the server listens, with the port filled in. */
+    address getAddress() const { return socket.local(); }
+
+    /** Actors can be added and removed between ticks, e.g. monsters. */
+    engine::engine& getEngine() { return *e; }
+    const engine::engine& getEngine() const { return *e; }
+
+    std::size_t getClientCount() const { return live; }
+
+    /** The actor of the client at the given address, invalid if none. */
+    engine::actor_handle actorOf(const address& a) const {
+        auto it = by_address.find(a);
+        return it == by_address.end()
+            ? engine::actor_handle() : clients[it->second]->actor;
+    }
+
+    const server_stats& getStats() const { return stats; }
+    void resetStats() { stats = server_stats(); }
+
+    /** Handles every datagram that has arrived. */
+    void receive() {
+        const auto start = clock::now();
+        address from;
+        while (socket.receive(datagram, from)) {
+            ++stats.packets_in;
+            stats.bytes_in += datagram.size();
+            try {
+                handle(from);
+            } catch (engine::err::bad_format&) {
+                ++stats.bad_packets;
+            }
+        }
+        stats.receive_ns += since(start);
+    }
+
+    /**
+     * Runs one tick, drops the clients that have gone quiet and sends
+     * snapshots if they are due.
+     */
+    void tick() {
+        auto start = clock::now();
+        e->simulate();
+        ++stats.ticks;
+        stats.simulate_ns += since(start);
+
+        for (std::size_t c = 0; c < clients.size(); ++c) {
+            if (clients[c] &&
+                    e->getTick() - clients[c]->last_heard > timeout_ticks) {
+                drop(c, true);
+            }
+        }
+        if (e->getTick() % params.snapshot_every == 0) {
+            broadcast();
+        }
+    }
+
+    /**
+     * Runs ticks in real time until seconds have passed (0: until stop()),
+     * handling datagrams as they come in between. report is called with
+     * the server every report_every seconds.
+     */
+    void run(double seconds,
+             std::function<void(server&)> report = nullptr,
+             double report_every = 1) {
+        typedef std::chrono::duration<double> secs;
+        const auto start = clock::now();
+        const auto dt = std::chrono::duration_cast<clock::duration>(
+                secs(e->getTimeStep()));
+        auto next_tick = start + dt;
+        auto next_report = start + std::chrono::duration_cast<clock::duration>(
+                secs(report_every));
+        while (!stopping.load(std::memory_order_relaxed)) {
+            const auto now = clock::now();
+            if (seconds > 0 && now - start >= secs(seconds)) { break; }
+            receive();
+            if (now >= next_tick) {
+                tick();
+                next_tick += dt;
+                if (clock::now() - next_tick > 5 * dt) {
+                    next_tick = clock::now(); // fell behind; do not catch up
+                }
+            }
+            if (report && now >= next_report) {
+                report(*this);
+                next_report += std::chrono::duration_cast<clock::duration>(
+                        secs(report_every));
+            }
+            const auto wait = std::chrono::duration_cast<
+                std::chrono::milliseconds>(next_tick - clock::now()).count();
+            if (wait > 0) {
+                socket.wait(static_cast<int>(wait));
+            }
+        }
+    }
+
+    /** Makes run() return; safe from any thread or a signal handler. */
+    void stop() {
+        stopping.store(true, std::memory_order_relaxed);
+    }
+
+    private:
+    static std::uint64_t since(clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - start).count();
+    }
+
+    void send(const address& to, const std::vector<unsigned char>& data) {
+        ++stats.packets_out;
+        stats.bytes_out += data.size();
+        if (!socket.send(to, data.data(), data.size())) {
+            ++stats.send_drops;
+        }
+    }
+
+    void handle(const address& from) {
+        engine::byte_reader r(datagram.data(), datagram.size());
+        protocol::packet_type type = read_packet_type(r);
+        auto known = by_address.find(from);
+        if (known == by_address.end()) {
+            if (type == protocol::HELLO) {
+                hello_packet hello;
+                read_packet(r, hello);
+                join(from, hello);
+            } else if (type == protocol::INPUT) {
+                // dropped a while ago; tell it to start over
+                write_bye(packet);
+                send(from, packet);
+            }
+            return;
+        }
+
+        client& c = *clients[known->second];
+        c.last_heard = e->getTick();
+        switch (type) {
+            case protocol::HELLO:
+                welcome(c); // the first one got lost
+                break;
+            case protocol::INPUT:
+                read_packet(r, input);
+                if (input.ack > c.acked && input.ack < next_snapshot) {
+                    c.acked = input.ack;
+                }
+                for (const auto& cmd : input.commands) {
+                    if (cmd.sequence > c.last_command) {
+                        apply(c, cmd);
+                    }
+                }
+                break;
+            case protocol::BYE:
+                drop(known->second, false);
+                break;
+            default:
+                ++stats.bad_packets;
+        }
+    }
+
+    void join(const address& from, const hello_packet& hello) {
+        if (live >= params.max_clients) {
+            write_bye(packet);
+            send(from, packet);
+            return;
+        }
+        auto cell = spawn_cells[rng() % spawn_cells.size()];
+        std::uniform_real_distribution<double> turn(0, engine::TAU);
+        engine::actor a(hello.name.substr(0, 32),
+                osg::Vec2d(cell.first + 0.5, cell.second + 0.5),
+                turn(rng), params.player.health, params.player);
+        a.speed = 0;
+        engine::actor_handle h = e->addActor(a);
+        interest.addObserver(h);
+
+        std::size_t slot = 0;
+        while (slot < clients.size() && clients[slot]) { ++slot; }
+        if (slot == clients.size()) { clients.push_back(nullptr); }
+        clients[slot].reset(new client{from, h, e->getTick(), 0, 0, 0,
+                std::vector<sent_view>(history_size)});
+        by_address[from] = slot;
+        ++live;
+        ++stats.joined;
+        welcome(*clients[slot]);
+    }
+
+    void welcome(const client& c) {
+        auto maze = e->getMaze();
+        write_packet(welcome_packet{c.actor,
+                maze->getWidth(), maze->getHeight(), maze->getDifficulty(),
+                maze->getSeed(), maze->getGenerator(), e->getTimeStep(),
+                params.snapshot_every},
+                packet);
+        send(c.from, packet);
+    }
+
+    /** quiet: it timed out, so it gets a BYE in case it is still there. */
+    void drop(std::size_t slot, bool quiet) {
+        client& c = *clients[slot];
+        if (quiet) {
+            write_bye(packet);
+            send(c.from, packet);
+        }
+        interest.removeObserver(c.actor);
+        e->removeActor(c.actor);
+        by_address.erase(c.from);
+        clients[slot].reset();
+        --live;
+        ++stats.left;
+    }
+
+    void apply(client& c, const command& cmd) {
+        c.last_command = cmd.sequence;
+        c.command_tick = e->getTick();
+        ++stats.commands;
+        if (!e->hasActor(c.actor) || e->getActor(c.actor).health <= 0) {
+            return; // the dead only watch
+        }
+        double radius = 0;
+        if (cmd.type == engine::action_type::AREA_ATTACK) {
+            radius = std::min(std::max(cmd.radius, 0.), params.max_area_radius);
+            if (!(radius >= 0)) { radius = 0; } // NaN
+        }
+        e->queueAction(engine::timed_action{e->getCurrentTime(), c.actor,
+                cmd.target, cmd.type, radius});
+    }
+
+    void broadcast() {
+        const std::uint64_t id = next_snapshot++;
+
+        auto start = clock::now();
+        engine::take_snapshot(*e, full, params.precision);
+        e->captureSnapshot(poses);
+        interest.update(poses);
+        stats.interest_ns += since(start);
+
+        for (auto& slot : clients) {
+            if (!slot) { continue; }
+            client& c = *slot;
+
+            start = clock::now();
+            engine::filter_snapshot(full, interest.interestOf(c.actor), view);
+            sent_view& base = c.history[c.acked % history_size];
+            const bool delta = c.acked && base.id == c.acked;
+            encoded.clear();
+            engine::encode_snapshot(view, delta ? &base.view : nullptr, encoded);
+            sent_view& mine = c.history[id % history_size];
+            mine.id = id;
+            std::swap(mine.view, view);
+            stats.encode_ns += since(start);
+
+            start = clock::now();
+            ++stats.snapshots;
+            if (!delta) { ++stats.keyframes; }
+            const std::size_t count =
+                (encoded.size() + protocol::fragment_size - 1) / protocol::fragment_size;
+            if (count > protocol::max_fragments) {
+                continue; // sees too much to send; it keeps the last one
+            }
+            for (std::size_t f = 0; f < count; ++f) {
+                const std::size_t begin = f * protocol::fragment_size;
+                const std::size_t end =
+                    std::min(encoded.size(), begin + protocol::fragment_size);
+                write_fragment_header(snapshot_fragment{id,
+                        delta ? c.acked : 0, c.last_command,
+                        e->getTick() - c.command_tick,
+                        static_cast<std::uint32_t>(f),
+                        static_cast<std::uint32_t>(count), nullptr, 0},
+                        packet);
+                packet.insert(packet.end(),
+                        encoded.begin() + begin, encoded.begin() + end);
+                send(c.from, packet);
+                ++stats.fragments;
+            }
+            stats.send_ns += since(start);
+        }
+    }
+};
+
+} /*end namespace*/
+
+#endif
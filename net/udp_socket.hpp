@@ -0,0 +1,210 @@
+#ifndef UDP_SOCKET_HPP_HEADER
+#define UDP_SOCKET_HPP_HEADER
+
+/**
+ * @file udp_socket.hpp
+ * A non-blocking IPv4 UDP socket on top of the POSIX calls.
+ *
+ * send() and receive() never block: a datagram that does not fit into
+ * the kernel's buffers is dropped, as it could be anywhere on the way,
+ * and receive() returns false when nothing is waiting. wait() blocks
+ * until something arrives or the timeout runs out. Anything else going
+ * wrong throws err::socket_error with errno attached.
+ *
+ * @author Gašper Ažman, gasper.azman@gmail.com
+ * @since 2026-10-16
+ */
+
+#include "exceptions.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace net {
+
+/** An IPv4 address and port, in host byte order. */
+struct address {
+    std::uint32_t host;
+    std::uint16_t port;
+
+    address(std::uint32_t host = 0, std::uint16_t port = 0)
+        : host(host)
+        , port(port)
+    {}
+
+    /** Parses a dotted quad; throws err::socket_error if it is not one. */
+    static address parse(const std::string& host, std::uint16_t port) {
+        in_addr a;
+        if (inet_pton(AF_INET, host.c_str(), &a) != 1) {
+            throw err::socket_error()
+                << err::reason("not an IPv4 address: " + host);
+        }
+        return address(ntohl(a.s_addr), port);
+    }
+
+    static address loopback(std::uint16_t port) {
+        return address(INADDR_LOOPBACK, port);
+    }
+
+    std::string str() const {
+        char buffer[INET_ADDRSTRLEN];
+        in_addr a;
+        a.s_addr = htonl(host);
+        inet_ntop(AF_INET, &a, buffer, sizeof(buffer));
+        return std::string(buffer) + ":" + std::to_string(port);
+    }
+
+    sockaddr_in sockaddr() const {
+        sockaddr_in s;
+        std::memset(&s, 0, sizeof(s));
+        s.sin_family = AF_INET;
+        s.sin_addr.s_addr = htonl(host);
+        s.sin_port = htons(port);
+        return s;
+    }
+
+    bool operator==(const address& o) const {
+        return host == o.host && port == o.port;
+    }
+    bool operator!=(const address& o) const { return !(*this == o); }
+};
+
+struct address_hash {
+    std::size_t operator()(const address& a) const {
+        return std::hash<std::uint64_t>()(
+                (std::uint64_t(a.host) << 16) | a.port);
+    }
+};
+
+class udp_socket {
+    int fd;
+
+    public:
+    /** Binds to the given address; port 0 lets the system pick one. */
+    explicit udp_socket(const address& local = address())
+        : fd(::socket(AF_INET, SOCK_DGRAM, 0))
+    {
+        if (fd < 0) { fail("socket"); }
+        const int flags = ::fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            close_and_fail("fcntl");
+        }
+        const sockaddr_in s = local.sockaddr();
+        if (::bind(fd, reinterpret_cast<const ::sockaddr*>(&s), sizeof(s)) < 0) {
+            close_and_fail("bind");
+        }
+    }
+
+    udp_socket(const udp_socket&) = delete;
+    udp_socket& operator=(const udp_socket&) = delete;
+
+    ~udp_socket() {
+        ::close(fd);
+    }
+
+    /** The address the socket is bound to, with the port filled in. */
+    address local() const {
+        sockaddr_in s;
+        socklen_t size = sizeof(s);
+        if (::getsockname(fd, reinterpret_cast<::sockaddr*>(&s), &size) < 0) {
+            fail("getsockname");
+        }
+        return address(ntohl(s.sin_addr.s_addr), ntohs(s.sin_port));
+    }
+
+    /** Asks for kernel buffers of the given size; the kernel may cap them. */
+    void setBufferSizes(int bytes) {
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+    }
+
+    /** @return false if the datagram was dropped for lack of buffer space */
+    bool send(const address& to, const unsigned char* data, std::size_t size) {
+        const sockaddr_in s = to.sockaddr();
+        for (;;) {
+            ssize_t sent = ::sendto(fd, data, size, 0,
+                    reinterpret_cast<const ::sockaddr*>(&s), sizeof(s));
+            if (sent >= 0) { return true; }
+            if (errno == EINTR) { continue; }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                return false;
+            }
+            // a peer that went away shows up here on some systems
+            if (errno == ECONNREFUSED) { return false; }
+            fail("sendto");
+        }
+    }
+
+    /**
+     * Reads one waiting datagram into buffer, which is resized to fit it.
+     *
+     * @return false if nothing is waiting
+     */
+    bool receive(std::vector<unsigned char>& buffer, address& from) {
+        buffer.resize(max_datagram);
+        for (;;) {
+            sockaddr_in s;
+            socklen_t size = sizeof(s);
+            ssize_t got = ::recvfrom(fd, buffer.data(), buffer.size(), 0,
+                    reinterpret_cast<::sockaddr*>(&s), &size);
+            if (got >= 0) {
+                buffer.resize(got);
+                from = address(ntohl(s.sin_addr.s_addr), ntohs(s.sin_port));
+                return true;
+            }
+            if (errno == EINTR || errno == ECONNREFUSED) { continue; }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                buffer.clear();
+                return false;
+            }
+            fail("recvfrom");
+        }
+    }
+
+    /**
+     * Blocks until a datagram is waiting or timeout_ms have passed.
+     *
+     * @return whether one is waiting
+     */
+    bool wait(int timeout_ms) {
+        pollfd p;
+        p.fd = fd;
+        p.events = POLLIN;
+        p.revents = 0;
+        int ready = ::poll(&p, 1, timeout_ms);
+        if (ready < 0 && errno != EINTR) { fail("poll"); }
+        return ready > 0;
+    }
+
+    static const std::size_t max_datagram = 65536;
+
+    private:
+    [[noreturn]] void fail(const char* call) const {
+        throw err::socket_error()
+            << err::reason(std::string(call) + ": " + std::strerror(errno))
+            << err::error_number(errno);
+    }
+
+    [[noreturn]] void close_and_fail(const char* call) {
+        int e = errno;
+        ::close(fd);
+        errno = e;
+        fail(call);
+    }
+};
+
+} /*end namespace*/
+
+#endif